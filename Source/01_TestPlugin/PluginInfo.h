@@ -1,13 +1,13 @@
-#pragma once
-
-#define PLUGIN_NAME "01_TestPlugin"
-
-#define PluginLog PluginLog_01_TestPlugin
-
-inline const char* GetGraphicAPIName() { return "D3D11"; }
-
-inline const char* GetUrhoVersion() { return "Unversioned"; }
-
-inline const char* GetCompilerID() { return "MSVC"; }
-
-inline const char* GetCompilerVersion() { return "19.13.26129.0"; }
\ No newline at end of file
+#pragma once
+
+#define PLUGIN_NAME "01_TestPlugin"
+
+#define PluginLog PluginLog_01_TestPlugin
+
+inline constexpr const char* GetGraphicAPIName() { return "D3D11"; }
+
+inline constexpr const char* GetUrhoVersion() { return "Unversioned"; }
+
+inline constexpr const char* GetCompilerID() { return "MSVC"; }
+
+inline constexpr const char* GetCompilerVersion() { return "19.13.26129.0"; }
\ No newline at end of file
@@ -1,47 +1,180 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#include "../Core/Thread.h"
-
-#include "PluginApplication.h"
-
-PluginApplication::PluginApplication(Context* context) :
-	Object(context)
-{
-	// Create special plugin log (see PluginLog.h to know why)
-	auto* pluginLog = new PluginLog(context_);
-
-	// ToDo: (bug here)
-	// Problem to Register on the subsystem because macro URHO3D_OBJECT create bug id on Type
-	// and conflic with other log from other plugin
-	//context_->RegisterSubsystem(pluginLog);
-
-	// Assume this class is create on main thread
-	Thread::SetMainThread();
-
-	// Copy data from main log and init new file
-	auto* log = GetSubsystem<Log>();
-	pluginLog->SetLevel(log->GetLevel());
-	pluginLog->SetQuiet(log->IsQuiet());
-	pluginLog->Open(PLUGIN_NAME + String(".log"));
-
-}
\ No newline at end of file
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Timer.h"
+#include "../Core/Profiler.h"
+#include "../Core/ProcessUtils.h"
+
+#include "PluginApplication.h"
+
+/// Runtime of the instance the calling thread runs plugin code for.
+static thread_local PluginRuntime* currentRuntime = nullptr;
+
+/// Event handler attributing the time spent in the wrapped handler to the plugin.
+class PluginEventHandler : public EventHandler
+{
+public:
+	/// Construct with the runtime of the subscribing instance.
+	PluginEventHandler(EventHandler* handler, PluginRuntime* runtime) :
+		EventHandler(handler->GetReceiver(), handler->GetUserData()),
+		handler_(handler),
+		runtime_(runtime)
+	{
+	}
+
+	/// Invoke wrapped handler, record its time and credit its allocations to the plugin.
+	void Invoke(VariantMap& eventData) override
+	{
+		// The handler may unsubscribe itself, which deletes this wrapper: nothing of it is read after the call
+		PluginRuntime* runtime = runtime_;
+		const StringHash eventType = GetEventType();
+		handler_->SetSenderAndEventType(GetSender(), eventType);
+
+		if (!runtime)
+		{
+			handler_->Invoke(eventData);
+			return;
+		}
+
+		// Memory allocated by the handler is credited to the plugin, its logs go to the plugin log of the instance
+		PluginRuntimeBinding binding(runtime);
+		const unsigned previousOwner = runtime->BeginMemoryScope();
+		if (!runtime->profiling_)
+		{
+			handler_->Invoke(eventData);
+			runtime->EndMemoryScope(previousOwner);
+			return;
+		}
+
+#ifdef URHO3D_PROFILING
+		AutoProfileBlock profileBlock(GetReceiver()->GetSubsystem<Profiler>(), PLUGIN_NAME);
+#endif
+		HiresTimer timer;
+		handler_->Invoke(eventData);
+		runtime->RecordTime(eventType, timer.GetUSec(false));
+		runtime->EndMemoryScope(previousOwner);
+	}
+
+	/// Return a unique copy of the event handler.
+	EventHandler* Clone() const override
+	{
+		return new PluginEventHandler(handler_->Clone(), runtime_);
+	}
+
+private:
+	/// Wrapped handler.
+	UniquePtr<EventHandler> handler_;
+	/// Runtime of the subscribing instance.
+	PluginRuntime* runtime_;
+};
+
+/// Log ring of the calling thread on the plugin log channel.
+struct PluginLogThreadRing
+{
+	/// Ring, valid for the channel only.
+	PluginLogRing* ring_ = nullptr;
+	/// Channel of the ring.
+	unsigned channel_ = 0;
+};
+
+static thread_local PluginLogThreadRing logThreadRing;
+static thread_local PluginLogRecord logFallbackRecord;
+
+PluginLogRecord* PluginLog::BeginRecord(int level, const char* format)
+{
+	PluginRuntime* runtime = currentRuntime;
+	if (!runtime)
+	{
+		// No player log writer, format and print immediately
+		logFallbackRecord.Reset(level, format);
+		return &logFallbackRecord;
+	}
+
+	if (level != LOG_RAW && level < runtime->logLevel_)
+		return nullptr;
+
+	if (!logThreadRing.ring_ || logThreadRing.channel_ != runtime->logChannel_)
+	{
+		logThreadRing.ring_ = runtime->AcquireLogRing();
+		logThreadRing.channel_ = runtime->logChannel_;
+		if (!logThreadRing.ring_)
+			return nullptr;
+	}
+
+	PluginLogRecord* record = logThreadRing.ring_->BeginWrite();
+	if (record)
+		record->Reset(level, format);
+	return record;
+}
+
+void PluginLog::EndRecord(PluginLogRecord& record)
+{
+	if (&record == &logFallbackRecord)
+	{
+		String message = FormatPluginLogRecord(record);
+		if (record.level_ != LOG_RAW)
+			message = "[" PLUGIN_NAME "] " + message;
+		PrintUnicodeLine(message, record.level_ == LOG_ERROR);
+		return;
+	}
+
+	logThreadRing.ring_->EndWrite();
+}
+
+PluginApplication::PluginApplication(Context* context) :
+	Object(context),
+	runtime_(currentRuntime)
+{
+}
+
+PluginRuntime* PluginApplication::BindRuntime(PluginRuntime* runtime)
+{
+	PluginRuntime* previous = currentRuntime;
+	currentRuntime = runtime;
+	return previous;
+}
+
+PluginRuntime* PluginApplication::GetCurrentRuntime()
+{
+	return currentRuntime;
+}
+
+void PluginApplication::SubscribeToEvent(StringHash eventType, EventHandler* handler)
+{
+	Object::SubscribeToEvent(eventType, new PluginEventHandler(handler, runtime_));
+}
+
+void PluginApplication::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler* handler)
+{
+	Object::SubscribeToEvent(sender, eventType, new PluginEventHandler(handler, runtime_));
+}
+
+unsigned PluginApplication::SubmitTask(PluginTaskFunction function, void* data, const PODVector<unsigned>& dependencies)
+{
+	if (!runtime_)
+	{
+		function(data);
+		return 0;
+	}
+
+	return runtime_->SubmitTask(function, data, dependencies.Buffer(), dependencies.Size());
+}
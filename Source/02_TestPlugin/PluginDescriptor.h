@@ -0,0 +1,209 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// This file is shared between the player and the plugins and must stay identical in both.
+
+#pragma once
+
+#include "../Core/Context.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+class Serializer;
+class Deserializer;
+}
+
+using namespace Urho3D;
+
+/// Version of the descriptor layout. Increment on any change of the plugin ABI.
+#define PLUGIN_DESCRIPTOR_VERSION 12
+
+class PluginLogRing;
+class PluginRing;
+class PluginRuntime;
+enum PluginRingMode : unsigned;
+
+/// Function run by a plugin task on any thread.
+typedef void(*PluginTaskFunction)(void* data);
+
+/// Function called every frame on a plugin instance with the frame time step.
+typedef void(*PluginFrameFunction)(void* instance, float timeStep);
+
+/// Function making a runtime current on the calling thread and returning the previous one.
+typedef PluginRuntime*(*PluginBindFunction)(PluginRuntime* runtime);
+
+/// Slot of a service interface version, owned by the player. Its address stays valid until the player exits, the
+/// service is null while no loaded plugin publishes it.
+struct PluginServiceSlot
+{
+	/// Published service, cast to the interface type.
+	std::atomic<void*> service_;
+};
+
+/// Services the player provides to a plugin instance. Each instance gets its own runtime.
+class PluginRuntime
+{
+public:
+	/// Destruct.
+	virtual ~PluginRuntime() { }
+
+	/// Record time spent in plugin code for a section (an event type or an entry point).
+	virtual void RecordTime(StringHash section, long long elapsedUSec) = 0;
+
+	/// Submit task running on any thread once the tasks it depends on are complete and return its id.
+	/// Call on the main thread. Tasks submitted during a frame are all complete before E_POSTUPDATE.
+	virtual unsigned SubmitTask(PluginTaskFunction function, void* data, const unsigned* dependencies, unsigned numDependencies) = 0;
+
+	/// Return log ring for the calling thread on the plugin log channel. Written by this thread only.
+	virtual PluginLogRing* AcquireLogRing() = 0;
+
+	/// Return blackboard slot shared by all plugins, created zeroed on first request. Its address stays valid until
+	/// the player exits. Return null if the slot exists with another size or alignment.
+	virtual void* AcquireBlackboardSlot(const char* name, unsigned size, unsigned alignment) = 0;
+
+	/// Return blackboard ring shared by all plugins, created on first request. Its address stays valid until the
+	/// player exits. Return null if the ring exists with another element size, capacity or mode.
+	virtual PluginRing* AcquireBlackboardRing(const char* name, unsigned elementSize, unsigned capacity, PluginRingMode mode) = 0;
+
+	/// Return slot of a service interface version, created empty on first request. Its address stays valid until the
+	/// player exits.
+	virtual PluginServiceSlot* AcquireServiceSlot(const char* name, unsigned version) = 0;
+
+	/// Publish service interface implemented by the plugin, revoked when the plugin is unloaded or hot reloaded.
+	/// Return false if another plugin publishes it already.
+	virtual bool PublishService(const char* name, unsigned version, void* service) = 0;
+
+	/// Allocate zeroed memory from the plugin arena, freed all at once when the plugin is unloaded. Thread-safe.
+	virtual void* AllocateArena(unsigned size, unsigned alignment) = 0;
+
+	/// Credit the allocations of the calling thread to the plugin and return the previous owner, to restore with
+	/// EndMemoryScope.
+	virtual unsigned BeginMemoryScope() = 0;
+
+	/// Restore the owner of the allocations of the calling thread.
+	virtual void EndMemoryScope(unsigned previousOwner) = 0;
+
+	/// Profiling flag, time is recorded only when set.
+	bool profiling_ = false;
+	/// Unique id of the plugin log channel.
+	unsigned logChannel_ = 0;
+	/// Minimum level of the messages kept on the plugin log channel.
+	int logLevel_ = 0;
+};
+
+/// Plugin descriptor flags.
+enum PluginFlags : unsigned
+{
+	/// Setup and Start only touch the plugin own state and may run on a worker thread, concurrently with the
+	/// other plugins of the same dependency level. They must not subscribe to events, submit tasks nor use subsystems.
+	PLUGIN_THREAD_SAFE_INIT = 1
+};
+
+/// Per-frame hooks of the plugin application, called directly by the player instead of through event dispatch.
+enum PluginHook
+{
+	/// Called on E_UPDATE.
+	PLUGIN_HOOK_UPDATE = 0,
+	/// Called on E_POSTUPDATE, once the plugin tasks of the frame are complete.
+	PLUGIN_HOOK_POSTUPDATE,
+	/// Called on E_ENDFRAME.
+	PLUGIN_HOOK_ENDFRAME,
+	MAX_PLUGIN_HOOKS
+};
+
+/// Table of plugin entry points returned by the exported GetPluginDescriptor function. The library may be loaded by
+/// several player Contexts of the process, each one creating its own instance of the plugin application: entry points
+/// take the instance returned by CreatePluginApplication and keep no process-wide state.
+struct PluginDescriptor
+{
+	/// Descriptor layout version, always first to be checked before anything else.
+	unsigned version_;
+	/// ABI fingerprint of the plugin build.
+	unsigned long long abiFingerprint_;
+	/// Plugin name.
+	const char* name_;
+	/// Null terminated list of the plugins to set up and start before this one, or null.
+	const char* const* dependencies_;
+	/// Combination of PluginFlags.
+	unsigned flags_;
+
+	/// Adjust engine parameters before the engine is initialized. No plugin application exists yet.
+	void(*Configure)(VariantMap& parameters);
+
+	/// Construct plugin application on the Context with the runtime of the instance, and return the instance.
+	void*(*CreatePluginApplication)(Context* context, PluginRuntime* runtime);
+	void(*DestroyPluginApplication)(void* instance);
+
+	void(*Setup)(void* instance, VariantMap& parameters);
+	void(*Start)(void* instance);
+	void(*Stop)(void* instance);
+	void(*OnScriptBinding)(void* instance, const char*, void*);
+
+	/// Save state before the plugin is replaced by a rebuilt library.
+	void(*SaveState)(void* instance, Serializer& dest);
+	/// Restore state saved by the replaced plugin.
+	void(*RestoreState)(void* instance, Deserializer& source);
+
+	/// Per-frame hooks by PluginHook, null if not overridden by the plugin application.
+	PluginFrameFunction frameHooks_[MAX_PLUGIN_HOOKS];
+
+	/// Make the runtime of an instance current on the calling thread before running one of its tasks, and return the
+	/// previous one to restore afterward. Entry points and event handlers make it current by themselves.
+	PluginBindFunction BindRuntime;
+};
+
+/// Name of the exported function returning the plugin descriptor.
+#define PLUGIN_DESCRIPTOR_FUNCTION "GetPluginDescriptor"
+
+/// Compile-time FNV-1a hash of a string.
+constexpr unsigned long long HashPluginABIString(const char* str, unsigned long long hash = 14695981039346656037ULL)
+{
+	return *str ? HashPluginABIString(str + 1, (hash ^ (unsigned char)*str) * 1099511628211ULL) : hash;
+}
+
+/// Compile-time FNV-1a hash step of a value.
+constexpr unsigned long long HashPluginABIValue(unsigned long long value, unsigned long long hash)
+{
+	return (hash ^ value) * 1099511628211ULL;
+}
+
+/// Return ABI fingerprint from build informations and the size of structures crossing the plugin boundary.
+constexpr unsigned long long GetPluginABIFingerprint(const char* urhoVersion, const char* compilerID,
+	const char* compilerVersion, const char* graphicAPI)
+{
+	return
+		HashPluginABIValue(PLUGIN_DESCRIPTOR_VERSION,
+		HashPluginABIValue(sizeof(PluginDescriptor),
+		HashPluginABIValue(sizeof(PluginRuntime),
+		HashPluginABIValue(sizeof(Object),
+		HashPluginABIValue(sizeof(VariantMap),
+		HashPluginABIValue(sizeof(Variant),
+		HashPluginABIValue(sizeof(StringHash),
+		HashPluginABIValue(sizeof(String),
+		HashPluginABIValue(sizeof(void*),
+		HashPluginABIString(graphicAPI,
+		HashPluginABIString(compilerVersion,
+		HashPluginABIString(compilerID,
+		HashPluginABIString(urhoVersion)))))))))))));
+}
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+#include "../Core/Object.h"
+
+/// Sent in the player to forward data to a plugin running in a PluginHost process, then sent again in the host
+/// process with the same parameters. Parameters must be serializable.
+URHO3D_EVENT(E_PLUGINHOSTINPUT, PluginHostInput)
+{
+	URHO3D_PARAM(P_PLUGIN, Plugin);                // String, name of the hosted plugin
+}
+
+/// Sent by a plugin running in a PluginHost process to forward data to the player, then sent again in the player
+/// during E_POSTUPDATE with the same parameters and the plugin name.
+URHO3D_EVENT(E_PLUGINHOSTOUTPUT, PluginHostOutput)
+{
+	URHO3D_PARAM(P_PLUGIN, Plugin);                // String, name of the hosted plugin
+}
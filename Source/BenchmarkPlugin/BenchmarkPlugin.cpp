@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "BenchmarkPlugin.h"
+#include "BenchmarkPluginEvents.h"
+
+URHO3D_DEFINE_PLUGIN_APPLICATION(BenchmarkPlugin)
+
+BenchmarkPlugin::BenchmarkPlugin(Context* context) :
+	PluginApplication(context),
+	numCalls_(0)
+{
+	SubscribeToEvent(E_BENCHMARKPLUGIN, URHO3D_HANDLER(BenchmarkPlugin, HandleBenchmarkEvent));
+}
+
+void BenchmarkPlugin::HandleBenchmarkEvent(StringHash eventType, VariantMap& eventData)
+{
+	using namespace BenchmarkPluginEvent;
+
+	Variant& count = eventData[P_COUNT];
+	count = count.GetInt() + 1;
+}
+
+void BenchmarkPlugin::Setup(VariantMap& parameters)
+{
+	++numCalls_;
+}
+
+void BenchmarkPlugin::Start()
+{
+	++numCalls_;
+}
+
+void BenchmarkPlugin::Stop()
+{
+	++numCalls_;
+}
+
+void BenchmarkPlugin::OnScriptBinding(const char* scriptTypeName, void* scriptContext)
+{
+	++numCalls_;
+}
+
+void BenchmarkPlugin::OnUpdate(float timeStep)
+{
+	++numCalls_;
+}
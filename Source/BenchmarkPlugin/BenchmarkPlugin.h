@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "PluginApplication.h"
+
+/// Synthetic plugin doing no work, loaded many times by PluginBenchmark to measure the cost of the plugin loader,
+/// of the entry points fan-out and of event dispatch into plugin code.
+class BenchmarkPlugin : public PluginApplication
+{
+	URHO3D_OBJECT(BenchmarkPlugin, PluginApplication);
+
+public:
+
+	BenchmarkPlugin(Context* context);
+
+	/// Setup and Start touch nothing shared, they can run concurrently with other plugins.
+	static unsigned GetPluginFlags() { return PLUGIN_THREAD_SAFE_INIT; }
+
+	void Setup(VariantMap& parameters) override;
+
+	void Start() override;
+
+	void Stop() override;
+
+	void OnScriptBinding(const char* scriptTypeName, void* scriptContext) override;
+
+	void OnUpdate(float timeStep) override;
+
+	void HandleBenchmarkEvent(StringHash eventType, VariantMap& eventData);
+
+private:
+	/// Number of entry point calls.
+	unsigned numCalls_;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#define PLUGIN_NAME "BenchmarkPlugin"
+
+#define PluginLog PluginLog_BenchmarkPlugin
+
+inline constexpr const char* GetGraphicAPIName() { return "D3D11"; }
+
+inline constexpr const char* GetUrhoVersion() { return "Unversioned"; }
+
+inline constexpr const char* GetCompilerID() { return "MSVC"; }
+
+inline constexpr const char* GetCompilerVersion() { return "19.13.26129.0"; }
\ No newline at end of file
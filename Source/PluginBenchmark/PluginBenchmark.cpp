@@ -0,0 +1,351 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#include <cstdio>
+
+#include "../BenchmarkPlugin/BenchmarkPluginEvents.h"
+#include "PluginBenchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+/// Version of the report format, increased when a result is renamed or its meaning changes.
+static const unsigned REPORT_VERSION = 1;
+/// Operations timed together by the batched benchmarks, so one microsecond of a batch is one nanosecond per operation.
+static const unsigned BATCH_SIZE = 1000;
+/// Synthetic plugin library name.
+static const char* SYNTHETIC_PLUGIN_NAME = "BenchmarkPlugin";
+
+URHO3D_DEFINE_APPLICATION_MAIN(PluginBenchmark);
+
+PluginBenchmark::PluginBenchmark(Context* context) :
+	Application(context),
+	iterations_(1000),
+	numPlugins_(64)
+{
+	plugin_ = new Plugin(context_);
+	context_->RegisterSubsystem(plugin_);
+}
+
+void PluginBenchmark::Setup()
+{
+	const Vector<String>& arguments = GetArguments();
+	for (unsigned i = 0; i < arguments.Size(); ++i)
+	{
+		if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+		{
+			String argument = arguments[i].Substring(1).ToLower();
+			String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+			if (argument == "iterations")
+				iterations_ = Max(ToUInt(value), 1U);
+			else if (argument == "plugins")
+				numPlugins_ = Max(ToUInt(value), 1U);
+			else if (argument == "plugindir")
+				pluginDir_ = AddTrailingSlash(GetInternalPath(value));
+			else if (argument == "output")
+				outputFileName_ = value;
+			else if (argument == "help")
+			{
+				ErrorExit(
+					"Usage: PluginBenchmark [options]\n\n"
+					"Measures the plugin loader and the dispatch paths into plugins, then prints a JSON report.\n\n"
+					"Options:\n"
+					"-iterations <num> Operations or batches of 1000 operations measured per benchmark, 1000 by default\n"
+					"-plugins <num> Synthetic plugins loaded for the lookup, fan-out and dispatch benchmarks, 64 by default\n"
+					"-plugindir <dir> Directory of the plugin libraries, the program directory by default\n"
+					"-output <file> Write the report to a file instead of the standard output\n",
+					EXIT_SUCCESS);
+				return;
+			}
+		}
+	}
+
+	if (pluginDir_.Empty())
+		pluginDir_ = GetSubsystem<FileSystem>()->GetProgramDir();
+
+	// Nothing to render or play, and no resources
+	engineParameters_[EP_HEADLESS] = true;
+	engineParameters_[EP_SOUND] = false;
+	engineParameters_[EP_RESOURCE_PATHS] = String::EMPTY;
+	engineParameters_[EP_RESOURCE_PREFIX_PATHS] = String::EMPTY;
+	engineParameters_[EP_LOG_NAME] = String::EMPTY;
+	engineParameters_[EP_LOG_LEVEL] = LOG_WARNING;
+}
+
+void PluginBenchmark::Start()
+{
+	// Libraries are loaded and unloaded alone first, then the synthetic plugins stay loaded for the other benchmarks
+	bool succeeded = BenchmarkLoadUnload("01_TestPlugin") && BenchmarkLoadUnload("02_TestPlugin") &&
+		BenchmarkLoadUnload(SYNTHETIC_PLUGIN_NAME) && LoadSyntheticPlugins();
+	if (succeeded)
+	{
+		BenchmarkIsLoaded();
+		BenchmarkFanOut();
+		succeeded = BenchmarkDispatch();
+	}
+	if (succeeded)
+		BenchmarkBlackboardRing();
+	UnloadSyntheticPlugins();
+
+	if (!succeeded)
+	{
+		ErrorExit();
+		return;
+	}
+
+	const String report = GetReport();
+	if (outputFileName_.Empty())
+		PrintLine(report);
+	else
+	{
+		FILE* file = fopen(outputFileName_.CString(), "w");
+		if (!file)
+		{
+			ErrorExit("Failed to write benchmark report " + outputFileName_);
+			return;
+		}
+
+		fputs(report.CString(), file);
+		fclose(file);
+	}
+
+	engine_->Exit();
+}
+
+bool PluginBenchmark::BenchmarkLoadUnload(const String& name)
+{
+	FrameHistogram loadTimes;
+	FrameHistogram unloadTimes;
+	FrameHistogram roundTripTimes;
+	HiresTimer timer;
+
+	for (unsigned i = 0; i < iterations_; ++i)
+	{
+		timer.Reset();
+		if (!plugin_->Load(pluginDir_ + name))
+		{
+			URHO3D_LOGERROR("Failed to load plugin " + pluginDir_ + name);
+			return false;
+		}
+		const long long loadTime = timer.GetUSec(true);
+		// Unload only queues closing of the library, wait for it so the whole teardown is timed
+		plugin_->Unload(name);
+		plugin_->UpdateRetired(true);
+		const long long unloadTime = timer.GetUSec(false);
+
+		loadTimes.Record(loadTime);
+		unloadTimes.Record(unloadTime);
+		roundTripTimes.Record(loadTime + unloadTime);
+	}
+
+	AddResult("load/" + name, "usec", loadTimes);
+	AddResult("unload/" + name, "usec", unloadTimes);
+	AddResult("loadUnload/" + name, "usec", roundTripTimes);
+	return true;
+}
+
+bool PluginBenchmark::LoadSyntheticPlugins()
+{
+	if (!plugin_->Load(pluginDir_ + SYNTHETIC_PLUGIN_NAME))
+	{
+		URHO3D_LOGERROR("Failed to load plugin " + pluginDir_ + SYNTHETIC_PLUGIN_NAME);
+		return false;
+	}
+	syntheticNames_.Push(SYNTHETIC_PLUGIN_NAME);
+
+	// The same library opened again would be shared, each copy is a distinct plugin
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	const String& libraryPath = plugin_->pluginObjects_[SYNTHETIC_PLUGIN_NAME].path_;
+	const String copyDir = fileSystem->GetAppPreferencesDir("urho3d", "pluginbenchmark");
+	for (unsigned i = 1; i < numPlugins_; ++i)
+	{
+		const String name = ToString("%s_%u", SYNTHETIC_PLUGIN_NAME, i);
+		const String copyPath = copyDir + name + GetExtension(libraryPath);
+		if (!fileSystem->Copy(libraryPath, copyPath))
+			return false;
+		syntheticCopies_.Push(copyPath);
+
+		if (!plugin_->Load(copyPath))
+		{
+			URHO3D_LOGERROR("Failed to load plugin " + copyPath);
+			return false;
+		}
+		syntheticNames_.Push(name);
+	}
+
+	return true;
+}
+
+void PluginBenchmark::UnloadSyntheticPlugins()
+{
+	plugin_->UnloadAll();
+	syntheticNames_.Clear();
+
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	for (const String& copyPath : syntheticCopies_)
+		fileSystem->Delete(copyPath);
+	syntheticCopies_.Clear();
+}
+
+void PluginBenchmark::BenchmarkIsLoaded()
+{
+	Vector<String> unknownNames;
+	for (unsigned i = 0; i < syntheticNames_.Size(); ++i)
+		unknownNames.Push(ToString("UnknownPlugin_%u", i));
+
+	FrameHistogram hitTimes;
+	FrameHistogram missTimes;
+	HiresTimer timer;
+	unsigned numFound = 0;
+
+	for (unsigned i = 0; i < iterations_; ++i)
+	{
+		timer.Reset();
+		for (unsigned j = 0; j < BATCH_SIZE; ++j)
+			numFound += plugin_->IsLoaded(syntheticNames_[j % syntheticNames_.Size()]);
+		hitTimes.Record(timer.GetUSec(true));
+
+		for (unsigned j = 0; j < BATCH_SIZE; ++j)
+			numFound += plugin_->IsLoaded(unknownNames[j % unknownNames.Size()]);
+		missTimes.Record(timer.GetUSec(false));
+	}
+
+	if (numFound != iterations_ * BATCH_SIZE)
+		URHO3D_LOGWARNINGF("IsLoaded found %u plugins instead of %u", numFound, iterations_ * BATCH_SIZE);
+
+	AddResult("isLoaded/hit", "nsec", hitTimes);
+	AddResult("isLoaded/miss", "nsec", missTimes);
+}
+
+void PluginBenchmark::BenchmarkFanOut()
+{
+	FrameHistogram setupTimes;
+	FrameHistogram startTimes;
+	FrameHistogram scriptBindingTimes;
+	HiresTimer timer;
+
+	for (unsigned i = 0; i < iterations_; ++i)
+	{
+		VariantMap parameters;
+		timer.Reset();
+		plugin_->Setup(parameters);
+		setupTimes.Record(timer.GetUSec(true));
+		plugin_->Start();
+		startTimes.Record(timer.GetUSec(true));
+		plugin_->OnScriptBinding("PluginBenchmark", nullptr);
+		scriptBindingTimes.Record(timer.GetUSec(false));
+
+		// Bindings are kept to replay them to plugins loaded later, do not let them pile up
+		plugin_->scriptBindings_.Clear();
+	}
+
+	AddResult("fanOut/Setup", "usec", setupTimes);
+	AddResult("fanOut/Start", "usec", startTimes);
+	AddResult("fanOut/OnScriptBinding", "usec", scriptBindingTimes);
+}
+
+bool PluginBenchmark::BenchmarkDispatch()
+{
+	using namespace BenchmarkPluginEvent;
+
+	VariantMap& eventData = GetEventDataMap();
+	eventData[P_COUNT] = 0;
+	SendEvent(E_BENCHMARKPLUGIN, eventData);
+	if (eventData[P_COUNT].GetInt() != (int)syntheticNames_.Size())
+	{
+		URHO3D_LOGERRORF("Event reached %d plugins instead of %u", eventData[P_COUNT].GetInt(), syntheticNames_.Size());
+		return false;
+	}
+
+	FrameHistogram dispatchTimes;
+	HiresTimer timer;
+
+	for (unsigned i = 0; i < iterations_; ++i)
+	{
+		timer.Reset();
+		for (unsigned j = 0; j < BATCH_SIZE; ++j)
+			SendEvent(E_BENCHMARKPLUGIN, eventData);
+		dispatchTimes.Record(timer.GetUSec(false));
+	}
+
+	AddResult("dispatch/event", "nsec", dispatchTimes);
+
+	// Same fan-out through the update hook, called directly
+	FrameHistogram hookTimes;
+	for (unsigned i = 0; i < iterations_; ++i)
+	{
+		timer.Reset();
+		for (unsigned j = 0; j < BATCH_SIZE; ++j)
+			plugin_->RunFrameHooks(PLUGIN_HOOK_UPDATE, 1.0f / 60.0f);
+		hookTimes.Record(timer.GetUSec(false));
+	}
+
+	AddResult("dispatch/updateHook", "nsec", hookTimes);
+	return true;
+}
+
+void PluginBenchmark::BenchmarkBlackboardRing()
+{
+	// Element the size of a transform
+	const unsigned elementSize = 48;
+	PluginRing* ring = plugin_->GetBlackboard()->AcquireRing("PluginBenchmark", elementSize, BATCH_SIZE, PLUGIN_RING_SPSC);
+	unsigned char element[elementSize] = { 0 };
+
+	FrameHistogram pushPopTimes;
+	HiresTimer timer;
+
+	for (unsigned i = 0; i < iterations_; ++i)
+	{
+		timer.Reset();
+		for (unsigned j = 0; j < BATCH_SIZE; ++j)
+			ring->Push(element);
+		for (unsigned j = 0; j < BATCH_SIZE; ++j)
+			ring->Pop(element);
+		pushPopTimes.Record(timer.GetUSec(false));
+	}
+
+	AddResult("blackboard/ringPushPop", "nsec", pushPopTimes);
+}
+
+void PluginBenchmark::AddResult(const String& name, const char* unit, const FrameHistogram& histogram)
+{
+	results_.Push(ToString("{\"name\":\"%s\",\"unit\":\"%s\",", name.CString(), unit) + histogram.GetReport() + "}");
+}
+
+String PluginBenchmark::GetReport() const
+{
+	String report = ToString("{\"version\":%u,\"iterations\":%u,\"batchSize\":%u,\"plugins\":%u,\"results\":[",
+		REPORT_VERSION, iterations_, BATCH_SIZE, numPlugins_);
+	for (unsigned i = 0; i < results_.Size(); ++i)
+		report += (i ? ",\n" : "\n") + results_[i];
+	report += "\n]}\n";
+	return report;
+}
@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+
+#include "../Urho3DPlayer/Benchmark.h"
+#include "../Urho3DPlayer/Plugin.h"
+
+using namespace Urho3D;
+
+/// Measures the plugin loader and the dispatch paths into plugin code, with the test plugins and copies of a
+/// synthetic plugin, then exits with a JSON report.
+class PluginBenchmark : public Application
+{
+	URHO3D_OBJECT(PluginBenchmark, Application);
+
+public:
+	/// Construct.
+	explicit PluginBenchmark(Context* context);
+
+	/// Setup a headless engine and parse the options.
+	void Setup() override;
+	/// Run the benchmarks and exit.
+	void Start() override;
+
+private:
+	/// Measure Load and Unload round trip of a plugin.
+	bool BenchmarkLoadUnload(const String& name);
+	/// Load the synthetic plugin and copies of its library under unique names.
+	bool LoadSyntheticPlugins();
+	/// Unload the synthetic plugins and delete the library copies.
+	void UnloadSyntheticPlugins();
+	/// Measure IsLoaded lookups of loaded and unknown plugins.
+	void BenchmarkIsLoaded();
+	/// Measure Setup, Start and OnScriptBinding fan-out to the loaded plugins.
+	void BenchmarkFanOut();
+	/// Measure event dispatch and update hook calls to the loaded plugins.
+	bool BenchmarkDispatch();
+	/// Measure element copies through a blackboard ring.
+	void BenchmarkBlackboardRing();
+	/// Add result to the report.
+	void AddResult(const String& name, const char* unit, const FrameHistogram& histogram);
+	/// Return report as JSON.
+	String GetReport() const;
+
+	/// Plugin loader.
+	SharedPtr<Plugin> plugin_;
+	/// Directory of the plugin libraries.
+	String pluginDir_;
+	/// Report file name, empty to print the report.
+	String outputFileName_;
+	/// Number of measured operations or batches per benchmark.
+	unsigned iterations_;
+	/// Number of synthetic plugins loaded.
+	unsigned numPlugins_;
+	/// Names of the loaded synthetic plugins.
+	Vector<String> syntheticNames_;
+	/// Library copies of the synthetic plugin.
+	Vector<String> syntheticCopies_;
+	/// Results as JSON objects.
+	Vector<String> results_;
+};
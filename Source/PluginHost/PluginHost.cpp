@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#include <thread>
+
+#include "../Urho3DPlayer/PluginHostEvents.h"
+#include "PluginHost.h"
+
+#include <Urho3D/DebugNew.h>
+
+/// Idle time in microseconds during which the host spins for the next frame of the player before sleeping.
+static const long long SPIN_TIME = 2000;
+/// Interval in milliseconds between checks that the player is still running while idle.
+static const unsigned PLAYER_CHECK_INTERVAL = 500;
+
+URHO3D_DEFINE_APPLICATION_MAIN(PluginHost);
+
+PluginHost::PluginHost(Context* context) :
+	Application(context),
+	frameNumber_(0),
+	started_(false),
+	stopped_(false)
+{
+	plugin_ = new Plugin(context_);
+	context_->RegisterSubsystem(plugin_);
+}
+
+void PluginHost::Setup()
+{
+	String channelName;
+	const Vector<String>& arguments = GetArguments();
+	for (unsigned i = 0; i + 1 < arguments.Size(); ++i)
+	{
+		const String argument = arguments[i].ToLower();
+		if (argument == "-channel")
+			channelName = arguments[i + 1];
+		else if (argument == "-plugin")
+			pluginName_ = arguments[i + 1];
+	}
+
+	if (channelName.Empty() || pluginName_.Empty())
+	{
+		ErrorExit(
+			"Usage: PluginHost -channel <name> -plugin <name>\n\n"
+			"Runs a plugin isolated from the player main loop. Launched by Urho3DPlayer with -pluginhost <name>.\n");
+		return;
+	}
+
+	// The host shares the terminal of the player, so it only logs to its own file
+	engineParameters_[EP_LOG_NAME] = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "logs") +
+		GetFileName(pluginName_) + ".host.log";
+	engineParameters_[EP_LOG_QUIET] = true;
+	if (!engineParameters_.Contains(EP_RESOURCE_PREFIX_PATHS))
+		engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";../share/Resources;../share/Urho3D/Resources";
+
+	if (!channel_.Open(channelName))
+	{
+		ErrorExit("Failed to open plugin host channel " + channelName);
+		return;
+	}
+
+	Vector<String> names;
+	names.Push(pluginName_);
+	plugin_->Configure(names, engineParameters_);
+
+	// Whatever the plugin configures, the host has no window nor audio and its frames are paced by the player
+	engineParameters_[EP_HEADLESS] = true;
+	engineParameters_[EP_SOUND] = false;
+	engineParameters_[EP_FRAME_LIMITER] = false;
+}
+
+void PluginHost::Start()
+{
+	// Outputs sent while the plugin sets up are forwarded too
+	SubscribeToEvent(E_PLUGINHOSTOUTPUT, URHO3D_HANDLER(PluginHost, HandleOutput));
+
+	Vector<String> names;
+	names.Push(pluginName_);
+	plugin_->LoadAll(names);
+	if (plugin_->Empty())
+	{
+		channel_.Send(PLUGIN_HOST_FAILED);
+		ErrorExit("Failed to load plugin " + pluginName_);
+		return;
+	}
+
+	// The host stays headless, so the engine is not reinitialized
+	VariantMap parameters;
+	plugin_->Setup(parameters);
+	if (!parameters.Empty())
+		URHO3D_LOGDEBUG("Engine parameters set by Setup of the plugin are ignored in the plugin host");
+
+	channel_.Send(PLUGIN_HOST_READY);
+	SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(PluginHost, HandleEndFrame));
+	WaitForFrame();
+}
+
+void PluginHost::Stop()
+{
+	Shutdown();
+}
+
+bool PluginHost::WaitForFrame()
+{
+	HiresTimer idleTimer;
+	Timer playerCheckTimer;
+	for (;;)
+	{
+		const PluginHostMessage* message = channel_.BeginReceive();
+		if (!message)
+		{
+			if (idleTimer.GetUSec(false) < SPIN_TIME)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (playerCheckTimer.GetMSec(false) >= PLAYER_CHECK_INTERVAL)
+			{
+				playerCheckTimer.Reset();
+				if (!channel_.IsPlayerAlive())
+				{
+					URHO3D_LOGERROR("Player exited without stopping the plugin host");
+					Shutdown();
+					engine_->Exit();
+					return false;
+				}
+			}
+
+			Time::Sleep(1);
+			continue;
+		}
+
+		idleTimer.Reset();
+		switch (message->type_)
+		{
+		case PLUGIN_HOST_EVENT:
+			{
+				VariantMap eventData;
+				const bool valid = PluginHostChannel::ReadEvent(*message, eventData);
+				channel_.EndReceive();
+				if (valid)
+					SendEvent(E_PLUGINHOSTINPUT, eventData);
+			}
+			break;
+
+		case PLUGIN_HOST_START:
+			channel_.EndReceive();
+			if (!started_)
+			{
+				plugin_->Start();
+				started_ = true;
+			}
+			channel_.Send(PLUGIN_HOST_STARTED);
+			break;
+
+		case PLUGIN_HOST_FRAME:
+			frameNumber_ = message->frameNumber_;
+			engine_->SetNextTimeStep(message->timeStep_);
+			channel_.EndReceive();
+			return true;
+
+		case PLUGIN_HOST_STOP:
+			channel_.EndReceive();
+			Shutdown();
+			channel_.Send(PLUGIN_HOST_STOPPED);
+			engine_->Exit();
+			return false;
+
+		default:
+			channel_.EndReceive();
+			break;
+		}
+	}
+}
+
+void PluginHost::Shutdown()
+{
+	if (stopped_)
+		return;
+
+	if (started_)
+		plugin_->Stop();
+	plugin_->UnloadAll();
+	stopped_ = true;
+}
+
+void PluginHost::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+	if (stopped_)
+		return;
+
+	channel_.Send(PLUGIN_HOST_FRAME_DONE, frameNumber_);
+	WaitForFrame();
+}
+
+void PluginHost::HandleOutput(StringHash eventType, VariantMap& eventData)
+{
+	if (!channel_.SendEvent(eventData))
+		URHO3D_LOGWARNING("Output of plugin \"" + pluginName_ + "\" dropped, the player is too far behind");
+}
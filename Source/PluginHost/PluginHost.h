@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+
+#include "../Urho3DPlayer/Plugin.h"
+#include "../Urho3DPlayer/PluginHostChannel.h"
+
+using namespace Urho3D;
+
+/// Process running one plugin isolated from the player main loop, launched by the player with -pluginhost. The
+/// plugin is set up at launch, then started, run one frame per player frame with its time step, and stopped as the
+/// player tells through the shared memory channel. Events are forwarded with E_PLUGINHOSTINPUT and
+/// E_PLUGINHOSTOUTPUT.
+class PluginHost : public Application
+{
+	URHO3D_OBJECT(PluginHost, Application);
+
+public:
+	/// Construct.
+	explicit PluginHost(Context* context);
+
+	/// Parse the options, open the channel and configure the plugin.
+	void Setup() override;
+	/// Load and set up the plugin, then wait for the player.
+	void Start() override;
+	/// Unload the plugin if the player did not stop it.
+	void Stop() override;
+
+private:
+	/// Handle messages of the player until the next frame. Return false if the host is exiting.
+	bool WaitForFrame();
+	/// Stop and unload the plugin.
+	void Shutdown();
+	/// Handle end frame to complete the frame and wait for the next one.
+	void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+	/// Handle output event of the plugin to forward it to the player.
+	void HandleOutput(StringHash eventType, VariantMap& eventData);
+
+	/// Plugin loader.
+	SharedPtr<Plugin> plugin_;
+	/// Shared memory with the player.
+	PluginHostChannel channel_;
+	/// Name of the hosted plugin.
+	String pluginName_;
+	/// Player frame being run.
+	unsigned frameNumber_;
+	/// Flag whether the plugin is started.
+	bool started_;
+	/// Flag whether the plugin is stopped and unloaded.
+	bool stopped_;
+};
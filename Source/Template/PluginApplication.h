@@ -1,123 +1,337 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#pragma once
-
-#include "../Core/Context.h"
-
-#include "PluginLog.h"
-
-using namespace Urho3D;
-
-class PluginApplication : public Object
-{
-	URHO3D_OBJECT(PluginApplication, Object);
-
-public:
-
-	PluginApplication(Context* context);
-
-	virtual void Setup(VariantMap& parameters) { }
-
-	virtual void Start() { }
-
-	virtual void Stop() { }
-
-	virtual void OnScriptBinding(const char* scriptTypeName, void* scriptContext) { }
-};
-
-#ifdef __cplusplus  
-#define START_EXPORT extern "C" { 
-#define END_IMPORT } 
-#else
-#define START_EXPORT
-#define END_IMPORT 
-#endif
-
-#ifdef WIN32
-#define PLUGIN_EXPORT __declspec(dllexport)
-#else
-#define PLUGIN_EXPORT 
-#endif
-
-#define URHO3D_DEFINE_PLUGIN_APPLICATION(className, urhoVersion, compilatorName, compilatorVersion, OSVersion, graphicAPI) \
-START_EXPORT \
-\
-PluginApplication* pluginApp; \
-\
-	PLUGIN_EXPORT const char* GetUrhoCompatibleVersion(void) \
-	{ \
-		return urhoVersion; \
-	} \
-\
-	PLUGIN_EXPORT const char* GetCompatibleCompilatorName(void) \
-	{ \
-		return compilatorName; \
-	} \
-\
-	PLUGIN_EXPORT const char* GetCompatibleCompilatorVersion(void) \
-	{ \
-		return compilatorVersion; \
-	} \
-\
-	PLUGIN_EXPORT const char* GetCompatibleOSVersion(void) \
-	{ \
-		return OSVersion; \
-	} \
-\
-PLUGIN_EXPORT const char* GetCompatibleGraphicAPI(void) \
-	{ \
-		return graphicAPI; \
-	} \
-\
-PLUGIN_EXPORT void CreatePluginApplication(Context* context) \
-	{ \
-		pluginApp = new className(context); \
-	} \
-\
-PLUGIN_EXPORT void DestroyPluginApplication(Context* context) \
-	{ \
-		delete pluginApp; \
-		pluginApp = nullptr; \
-	} \
-\
-PLUGIN_EXPORT void Setup(VariantMap& parameters) \
-	{ \
-		pluginApp->Setup(parameters); \
-	} \
-\
-PLUGIN_EXPORT void Start(void) \
-	{ \
-		pluginApp->Start(); \
-	} \
-\
-PLUGIN_EXPORT void Stop(void) \
-	{ \
-		pluginApp->Stop(); \
-	} \
-\
-PLUGIN_EXPORT void OnScriptBinding(const char* scriptTypeName, void* scriptContext) \
-	{ \
-		pluginApp->OnScriptBinding(scriptTypeName, scriptContext); \
-	} \
-\
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/Context.h"
+#include "../IO/Serializer.h"
+#include "../IO/Deserializer.h"
+
+#include "PluginDescriptor.h"
+#include "PluginLog.h"
+#include "PluginRing.h"
+
+#include <type_traits>
+
+using namespace Urho3D;
+
+/// Declare name and version of a service interface, an abstract class shared by the plugins implementing and using
+/// it. Increment the version on any change of the interface, users of another version do not get the service.
+#define URHO3D_PLUGIN_SERVICE(typeName, version) \
+	static const char* GetServiceName() { return #typeName; } \
+	static unsigned GetServiceVersion() { return version; }
+
+/// Handle to service interface T published by another plugin, resolved once to its slot in the player. Calling the
+/// service costs a load of the slot and a virtual call.
+template <class T> class PluginService
+{
+public:
+	/// Construct unresolved.
+	PluginService() = default;
+
+	/// Construct with the slot of the service.
+	explicit PluginService(PluginServiceSlot* slot) :
+		slot_(slot)
+	{
+	}
+
+	/// Return service, or null while no loaded plugin publishes it. Check on every use, the service is revoked when
+	/// its plugin is unloaded or hot reloaded.
+	T* Get() const { return slot_ ? static_cast<T*>(slot_->service_.load(std::memory_order_acquire)) : nullptr; }
+
+	/// Return service.
+	T* operator ->() const { return Get(); }
+
+	/// Return whether the service is published.
+	explicit operator bool() const { return Get() != nullptr; }
+
+private:
+	/// Slot of the service in the player.
+	PluginServiceSlot* slot_ = nullptr;
+};
+
+class PluginApplication : public Object
+{
+	URHO3D_OBJECT(PluginApplication, Object);
+
+public:
+
+	/// Construct with the runtime current on the calling thread, the one of the instance being created.
+	PluginApplication(Context* context);
+
+	virtual void Setup(VariantMap& parameters) { }
+
+	virtual void Start() { }
+
+	virtual void Stop() { }
+
+	virtual void OnScriptBinding(const char* scriptTypeName, void* scriptContext) { }
+
+	/// Called every frame on E_UPDATE. Only overridden hooks are called, directly by the player, which is cheaper
+	/// than subscribing to the event.
+	virtual void OnUpdate(float timeStep) { }
+
+	/// Called every frame on E_POSTUPDATE, once the plugin tasks of the frame are complete.
+	virtual void OnPostUpdate(float timeStep) { }
+
+	/// Called every frame on E_ENDFRAME.
+	virtual void OnEndFrame(float timeStep) { }
+
+	/// Save state handed to the new instance when the library is hot reloaded.
+	virtual void OnSaveState(Serializer& dest) { }
+
+	/// Restore state saved by the previous instance when the library is hot reloaded.
+	virtual void OnRestoreState(Deserializer& source) { }
+
+	using Object::SubscribeToEvent;
+
+	/// Subscribe to an event that can be sent by any sender. Time spent in the handler is attributed to the plugin.
+	void SubscribeToEvent(StringHash eventType, EventHandler* handler);
+
+	/// Subscribe to a specific sender's event. Time spent in the handler is attributed to the plugin.
+	void SubscribeToEvent(Object* sender, StringHash eventType, EventHandler* handler);
+
+	/// Submit task running on any thread once the tasks it depends on are complete and return its id.
+	/// Call from the main thread, for example on E_UPDATE. Tasks of the frame are all complete before E_POSTUPDATE.
+	unsigned SubmitTask(PluginTaskFunction function, void* data = nullptr, const PODVector<unsigned>& dependencies = PODVector<unsigned>());
+
+	/// Return blackboard slot holding a T shared with the other plugins, zeroed when created. Acquire it once, at
+	/// Start for example, and keep the pointer: the address stays valid until the player exits. Return null if the
+	/// slot exists with another layout or if there is no player.
+	template <class T> T* AcquireSlot(const char* name)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Blackboard slots hold plain data only");
+		return runtime_ ? static_cast<T*>(runtime_->AcquireBlackboardSlot(name, sizeof(T), alignof(T))) : nullptr;
+	}
+
+	/// Return blackboard ring of T elements shared with the other plugins. Elements are written and read in place
+	/// with BeginWrite/EndWrite and BeginRead/EndRead, by a single consumer and one or several producers depending
+	/// on the mode. The address stays valid until the player exits. Return null if the ring exists with another
+	/// layout or if there is no player.
+	template <class T> PluginRing* AcquireRing(const char* name, unsigned capacity, PluginRingMode mode = PLUGIN_RING_SPSC)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Blackboard rings hold plain data only");
+		static_assert(alignof(T) <= PLUGIN_RING_ELEMENT_OFFSET, "Blackboard ring elements are aligned up to 16 bytes");
+		return runtime_ ? runtime_->AcquireBlackboardRing(name, sizeof(T), capacity, mode) : nullptr;
+	}
+
+	/// Return handle to service interface T, declared with URHO3D_PLUGIN_SERVICE. Get it once, at Start for example,
+	/// and keep the handle: it follows the plugin publishing the service as it is loaded, unloaded or reloaded.
+	template <class T> PluginService<T> GetService()
+	{
+		return PluginService<T>(runtime_ ? runtime_->AcquireServiceSlot(T::GetServiceName(), T::GetServiceVersion()) : nullptr);
+	}
+
+	/// Publish service interface T implemented by this plugin, to the other plugins. The service must stay valid until
+	/// the plugin application is destroyed. Return false if another plugin publishes it already or if there is no
+	/// player.
+	template <class T> bool PublishService(T* service)
+	{
+		return runtime_ ? runtime_->PublishService(T::GetServiceName(), T::GetServiceVersion(), service) : false;
+	}
+
+	/// Allocate zeroed memory from the arena of the current instance, freed all at once when the plugin is unloaded
+	/// and kept across hot reloads. Objects built there are never destructed. Return null if there is no player.
+	static void* AllocateArena(unsigned size, unsigned alignment = 16)
+	{
+		PluginRuntime* runtime = GetCurrentRuntime();
+		return runtime ? runtime->AllocateArena(size, alignment) : nullptr;
+	}
+
+	/// Adjust engine parameters before the engine is initialized, so it starts with the final settings. Hide in the
+	/// derived class to override. Runs before the plugin application is constructed and must not use subsystems.
+	static void Configure(VariantMap& parameters) { }
+
+	/// Return null terminated list of the plugins to set up and start before this one. Hide in the derived class
+	/// to declare dependencies.
+	static const char* const* GetPluginDependencies() { return nullptr; }
+
+	/// Return combination of PluginFlags. Hide in the derived class to declare PLUGIN_THREAD_SAFE_INIT.
+	static unsigned GetPluginFlags() { return 0; }
+
+	/// Return runtime of this instance, provided by the player.
+	PluginRuntime* GetRuntime() const { return runtime_; }
+
+	/// Make runtime current on the calling thread and return the previous one. Logs and arena allocations go to the
+	/// current runtime, the one of the instance the calling code runs for.
+	static PluginRuntime* BindRuntime(PluginRuntime* runtime);
+
+	/// Return runtime current on the calling thread.
+	static PluginRuntime* GetCurrentRuntime();
+
+private:
+	/// Runtime of this instance.
+	PluginRuntime* runtime_;
+};
+
+/// Helper making the runtime of an instance current on the calling thread during a scope.
+class PluginRuntimeBinding
+{
+public:
+	/// Construct and make the runtime current.
+	explicit PluginRuntimeBinding(PluginRuntime* runtime) :
+		previous_(PluginApplication::BindRuntime(runtime))
+	{
+	}
+
+	/// Destruct and restore the previous runtime.
+	~PluginRuntimeBinding() { PluginApplication::BindRuntime(previous_); }
+
+private:
+	/// Runtime current before the scope.
+	PluginRuntime* previous_;
+};
+
+#ifdef __cplusplus  
+#define START_EXPORT extern "C" { 
+#define END_IMPORT } 
+#else
+#define START_EXPORT
+#define END_IMPORT 
+#endif
+
+#ifdef WIN32
+#define PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define PLUGIN_EXPORT 
+#endif
+
+/// Return the hook function if the plugin application overrides the hook, or null so the player skips the plugin.
+#define URHO3D_PLUGIN_HOOK(className, hook, function) \
+	(std::is_same<decltype(&className::hook), decltype(&PluginApplication::hook)>::value ? nullptr : function)
+
+#define URHO3D_DEFINE_PLUGIN_APPLICATION(className) \
+static void PluginConfigure(VariantMap& parameters) \
+	{ \
+		className::Configure(parameters); \
+	} \
+\
+static void* PluginCreateApplication(Context* context, PluginRuntime* runtime) \
+	{ \
+		PluginRuntimeBinding binding(runtime); \
+		return static_cast<PluginApplication*>(new className(context)); \
+	} \
+\
+static void PluginDestroyApplication(void* instance) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		delete app; \
+	} \
+\
+static void PluginSetup(void* instance, VariantMap& parameters) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->Setup(parameters); \
+	} \
+\
+static void PluginStart(void* instance) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->Start(); \
+	} \
+\
+static void PluginStop(void* instance) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->Stop(); \
+	} \
+\
+static void PluginOnScriptBinding(void* instance, const char* scriptTypeName, void* scriptContext) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->OnScriptBinding(scriptTypeName, scriptContext); \
+	} \
+\
+static void PluginSaveState(void* instance, Serializer& dest) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->OnSaveState(dest); \
+	} \
+\
+static void PluginRestoreState(void* instance, Deserializer& source) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->OnRestoreState(source); \
+	} \
+\
+static void PluginUpdate(void* instance, float timeStep) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->OnUpdate(timeStep); \
+	} \
+\
+static void PluginPostUpdate(void* instance, float timeStep) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->OnPostUpdate(timeStep); \
+	} \
+\
+static void PluginEndFrame(void* instance, float timeStep) \
+	{ \
+		PluginApplication* app = static_cast<PluginApplication*>(instance); \
+		PluginRuntimeBinding binding(app->GetRuntime()); \
+		app->OnEndFrame(timeStep); \
+	} \
+\
+START_EXPORT \
+\
+PLUGIN_EXPORT const PluginDescriptor* GetPluginDescriptor(void) \
+	{ \
+		static constexpr unsigned long long abiFingerprint = \
+			GetPluginABIFingerprint(GetUrhoVersion(), GetCompilerID(), GetCompilerVersion(), GetGraphicAPIName()); \
+\
+		static const PluginDescriptor descriptor = \
+		{ \
+			PLUGIN_DESCRIPTOR_VERSION, \
+			abiFingerprint, \
+			PLUGIN_NAME, \
+			className::GetPluginDependencies(), \
+			className::GetPluginFlags(), \
+			PluginConfigure, \
+			PluginCreateApplication, \
+			PluginDestroyApplication, \
+			PluginSetup, \
+			PluginStart, \
+			PluginStop, \
+			PluginOnScriptBinding, \
+			PluginSaveState, \
+			PluginRestoreState, \
+			{ \
+				URHO3D_PLUGIN_HOOK(className, OnUpdate, PluginUpdate), \
+				URHO3D_PLUGIN_HOOK(className, OnPostUpdate, PluginPostUpdate), \
+				URHO3D_PLUGIN_HOOK(className, OnEndFrame, PluginEndFrame) \
+			}, \
+			PluginApplication::BindRuntime \
+		}; \
+		return &descriptor; \
+	} \
+\
 END_IMPORT 
\ No newline at end of file
@@ -1,70 +1,119 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#pragma once
-
-#include "../IO/Log.h"
-#include "PluginInfo.h"
-
-using namespace Urho3D;
-
-// Special hack log system
-// The reason for this class it is local static logging work only on the main application.
-class PluginLog : public Log
-{
-	URHO3D_OBJECT(PluginLog, Log);
-
-public:
-
-	explicit PluginLog(Context* context) :
-		Log(context)
-	{
-	}
-};
-
-// Redefine macro logging on this special context 
-#ifdef URHO3D_LOGGING
-#undef URHO3D_LOGTRACE
-#undef URHO3D_LOGDEBUG
-#undef URHO3D_LOGINFO
-#undef URHO3D_LOGWARNING
-#undef URHO3D_LOGERROR
-#undef URHO3D_LOGRAW
-#undef URHO3D_LOGTRACEF
-#undef URHO3D_LOGDEBUGF
-#undef URHO3D_LOGINFOF
-#undef URHO3D_LOGWARNINGF
-#undef URHO3D_LOGERRORF
-#undef URHO3D_LOGRAWF
-#define URHO3D_LOGTRACE(message) PluginLog::Write(Urho3D::LOG_TRACE, message)
-#define URHO3D_LOGDEBUG(message) PluginLog::Write(Urho3D::LOG_DEBUG, message)
-#define URHO3D_LOGINFO(message) PluginLog::Write(Urho3D::LOG_INFO, message)
-#define URHO3D_LOGWARNING(message) PluginLog::Write(Urho3D::LOG_WARNING, message)
-#define URHO3D_LOGERROR(message) PluginLog::Write(Urho3D::LOG_ERROR, message)
-#define URHO3D_LOGRAW(message) PluginLog::WriteRaw(message)
-#define URHO3D_LOGTRACEF(format, ...) PluginLog::Write(Urho3D::LOG_TRACE, Urho3D::ToString(format, ##__VA_ARGS__))
-#define URHO3D_LOGDEBUGF(format, ...) PluginLog::Write(Urho3D::LOG_DEBUG, Urho3D::ToString(format, ##__VA_ARGS__))
-#define URHO3D_LOGINFOF(format, ...) PluginLog::Write(Urho3D::LOG_INFO, Urho3D::ToString(format, ##__VA_ARGS__))
-#define URHO3D_LOGWARNINGF(format, ...) PluginLog::Write(Urho3D::LOG_WARNING, Urho3D::ToString(format, ##__VA_ARGS__))
-#define URHO3D_LOGERRORF(format, ...) PluginLog::Write(Urho3D::LOG_ERROR, Urho3D::ToString(format, ##__VA_ARGS__))
-#define URHO3D_LOGRAWF(format, ...) PluginLog::WriteRaw(Urho3D::ToString(format, ##__VA_ARGS__))
-#endif
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../IO/Log.h"
+#include "PluginInfo.h"
+#include "PluginLogBuffer.h"
+
+using namespace Urho3D;
+
+// Minimum level of the messages compiled in the plugin, with the values of the Urho3D log levels
+// (0 trace, 1 debug, 2 info, 3 warning, 4 error). Logging macros below this level expand to nothing.
+#ifndef PLUGIN_LOG_MIN_LEVEL
+#define PLUGIN_LOG_MIN_LEVEL 0
+#endif
+
+// Plugin logging. Call sites only record the format and the raw arguments in a ring of the calling thread,
+// the player log writer thread formats them and writes them to the plugin log file.
+class PluginLog
+{
+public:
+	/// Write a message.
+	static void Write(int level, const String& message)
+	{
+		PluginLogRecord* record = BeginRecord(level, nullptr);
+		if (!record)
+			return;
+		record->AddText(message.CString(), message.Length());
+		EndRecord(*record);
+	}
+
+	/// Write a message formatted later by the log writer.
+	template <class... Args> static void WriteFormat(int level, const char* format, const Args&... args)
+	{
+		PluginLogRecord* record = BeginRecord(level, format);
+		if (!record)
+			return;
+		record->AddAll(args...);
+		EndRecord(*record);
+	}
+
+	/// Write a message without prefix.
+	static void WriteRaw(const String& message) { Write(LOG_RAW, message); }
+
+private:
+	/// Return message to fill, or null if filtered or dropped.
+	static PluginLogRecord* BeginRecord(int level, const char* format);
+	/// Publish filled message.
+	static void EndRecord(PluginLogRecord& record);
+};
+
+// Redefine macro logging on the plugin log
+#ifdef URHO3D_LOGGING
+#undef URHO3D_LOGTRACE
+#undef URHO3D_LOGDEBUG
+#undef URHO3D_LOGINFO
+#undef URHO3D_LOGWARNING
+#undef URHO3D_LOGERROR
+#undef URHO3D_LOGRAW
+#undef URHO3D_LOGTRACEF
+#undef URHO3D_LOGDEBUGF
+#undef URHO3D_LOGINFOF
+#undef URHO3D_LOGWARNINGF
+#undef URHO3D_LOGERRORF
+#undef URHO3D_LOGRAWF
+#if PLUGIN_LOG_MIN_LEVEL <= 0
+#define URHO3D_LOGTRACE(message) PluginLog::Write(Urho3D::LOG_TRACE, message)
+#define URHO3D_LOGTRACEF(format, ...) PluginLog::WriteFormat(Urho3D::LOG_TRACE, format, ##__VA_ARGS__)
+#else
+#define URHO3D_LOGTRACE(message) ((void)0)
+#define URHO3D_LOGTRACEF(...) ((void)0)
+#endif
+#if PLUGIN_LOG_MIN_LEVEL <= 1
+#define URHO3D_LOGDEBUG(message) PluginLog::Write(Urho3D::LOG_DEBUG, message)
+#define URHO3D_LOGDEBUGF(format, ...) PluginLog::WriteFormat(Urho3D::LOG_DEBUG, format, ##__VA_ARGS__)
+#else
+#define URHO3D_LOGDEBUG(message) ((void)0)
+#define URHO3D_LOGDEBUGF(...) ((void)0)
+#endif
+#if PLUGIN_LOG_MIN_LEVEL <= 2
+#define URHO3D_LOGINFO(message) PluginLog::Write(Urho3D::LOG_INFO, message)
+#define URHO3D_LOGINFOF(format, ...) PluginLog::WriteFormat(Urho3D::LOG_INFO, format, ##__VA_ARGS__)
+#else
+#define URHO3D_LOGINFO(message) ((void)0)
+#define URHO3D_LOGINFOF(...) ((void)0)
+#endif
+#if PLUGIN_LOG_MIN_LEVEL <= 3
+#define URHO3D_LOGWARNING(message) PluginLog::Write(Urho3D::LOG_WARNING, message)
+#define URHO3D_LOGWARNINGF(format, ...) PluginLog::WriteFormat(Urho3D::LOG_WARNING, format, ##__VA_ARGS__)
+#else
+#define URHO3D_LOGWARNING(message) ((void)0)
+#define URHO3D_LOGWARNINGF(...) ((void)0)
+#endif
+#define URHO3D_LOGERROR(message) PluginLog::Write(Urho3D::LOG_ERROR, message)
+#define URHO3D_LOGERRORF(format, ...) PluginLog::WriteFormat(Urho3D::LOG_ERROR, format, ##__VA_ARGS__)
+#define URHO3D_LOGRAW(message) PluginLog::WriteRaw(message)
+#define URHO3D_LOGRAWF(format, ...) PluginLog::WriteFormat(Urho3D::LOG_RAW, format, ##__VA_ARGS__)
+#endif
@@ -0,0 +1,369 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// This file is shared between the player and the plugins and must stay identical in both.
+
+#pragma once
+
+#include "../Container/Str.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+using namespace Urho3D;
+
+/// Maximum number of arguments of a deferred log message.
+static const unsigned PLUGIN_LOG_MAX_ARGUMENTS = 8;
+/// Size of the text storage of a deferred log message, for the string arguments or the whole message. Longer text
+/// is cut and ends with an ellipsis.
+static const unsigned PLUGIN_LOG_TEXT_SIZE = 384;
+/// Number of messages a log ring can hold, must be a power of two.
+static const unsigned PLUGIN_LOG_RING_SIZE = 256;
+
+/// Type of a deferred log message argument.
+enum PluginLogArgumentType : unsigned char
+{
+	PLA_INT = 0,
+	PLA_UINT,
+	PLA_DOUBLE,
+	PLA_POINTER,
+	PLA_STRING,
+	PLA_BOOL
+};
+
+/// Argument of a deferred log message, recorded raw.
+struct PluginLogArgument
+{
+	/// Type.
+	PluginLogArgumentType type_;
+
+	union
+	{
+		/// Signed integer value.
+		long long int_;
+		/// Unsigned integer value.
+		unsigned long long uint_;
+		/// Floating point value.
+		double double_;
+		/// Pointer value.
+		const void* pointer_;
+		/// Offset of a string value in the message text storage.
+		unsigned textOffset_;
+	};
+};
+
+/// Log message recorded by a plugin and formatted later by the player log writer.
+struct PluginLogRecord
+{
+	/// Start a message. A null format means the text storage holds the whole message.
+	void Reset(int level, const char* format)
+	{
+		level_ = level;
+		format_ = format;
+		numArguments_ = 0;
+		textLength_ = 0;
+		text_[0] = 0;
+	}
+
+	/// Copy text to the text storage, truncated with an ellipsis if full, and return its offset.
+	unsigned AddText(const char* text, unsigned length)
+	{
+		const unsigned offset = textLength_;
+		const unsigned available = PLUGIN_LOG_TEXT_SIZE - 1 - textLength_;
+		if (length > available)
+		{
+			const unsigned kept = available > 3 ? available - 3 : 0;
+			memcpy(text_ + textLength_, text, kept);
+			memcpy(text_ + textLength_ + kept, "...", available - kept);
+			length = available;
+		}
+		else
+			memcpy(text_ + textLength_, text, length);
+
+		textLength_ += length;
+		text_[textLength_] = 0;
+		if (textLength_ < PLUGIN_LOG_TEXT_SIZE - 1)
+			++textLength_;
+
+		return offset;
+	}
+
+	/// Add an argument.
+	PluginLogArgument* AddArgument(PluginLogArgumentType type)
+	{
+		if (numArguments_ >= PLUGIN_LOG_MAX_ARGUMENTS)
+			return nullptr;
+
+		PluginLogArgument* argument = &arguments_[numArguments_++];
+		argument->type_ = type;
+		return argument;
+	}
+
+	void Add(bool value) { if (PluginLogArgument* a = AddArgument(PLA_BOOL)) a->int_ = value; }
+	void Add(char value) { if (PluginLogArgument* a = AddArgument(PLA_INT)) a->int_ = value; }
+	void Add(int value) { if (PluginLogArgument* a = AddArgument(PLA_INT)) a->int_ = value; }
+	void Add(long value) { if (PluginLogArgument* a = AddArgument(PLA_INT)) a->int_ = value; }
+	void Add(long long value) { if (PluginLogArgument* a = AddArgument(PLA_INT)) a->int_ = value; }
+	void Add(unsigned char value) { if (PluginLogArgument* a = AddArgument(PLA_UINT)) a->uint_ = value; }
+	void Add(unsigned short value) { if (PluginLogArgument* a = AddArgument(PLA_UINT)) a->uint_ = value; }
+	void Add(short value) { if (PluginLogArgument* a = AddArgument(PLA_INT)) a->int_ = value; }
+	void Add(unsigned value) { if (PluginLogArgument* a = AddArgument(PLA_UINT)) a->uint_ = value; }
+	void Add(unsigned long value) { if (PluginLogArgument* a = AddArgument(PLA_UINT)) a->uint_ = value; }
+	void Add(unsigned long long value) { if (PluginLogArgument* a = AddArgument(PLA_UINT)) a->uint_ = value; }
+	void Add(float value) { if (PluginLogArgument* a = AddArgument(PLA_DOUBLE)) a->double_ = value; }
+	void Add(double value) { if (PluginLogArgument* a = AddArgument(PLA_DOUBLE)) a->double_ = value; }
+	void Add(const void* value) { if (PluginLogArgument* a = AddArgument(PLA_POINTER)) a->pointer_ = value; }
+	void Add(const char* value)
+	{
+		if (!value)
+			value = "(null)";
+		if (PluginLogArgument* a = AddArgument(PLA_STRING))
+			a->textOffset_ = AddText(value, (unsigned)strlen(value));
+	}
+	void Add(char* value) { Add((const char*)value); }
+	void Add(const String& value)
+	{
+		if (PluginLogArgument* a = AddArgument(PLA_STRING))
+			a->textOffset_ = AddText(value.CString(), value.Length());
+	}
+	template <class T> typename std::enable_if<std::is_enum<T>::value>::type Add(T value) { Add((long long)value); }
+	template <class T> void Add(T* value) { Add((const void*)value); }
+
+	/// Add all arguments.
+	void AddAll() { }
+	template <class T, class... Args> void AddAll(const T& value, const Args&... args)
+	{
+		Add(value);
+		AddAll(args...);
+	}
+
+	/// Log level.
+	int level_;
+	/// Format string, a literal in plugin memory.
+	const char* format_;
+	/// Number of arguments.
+	unsigned numArguments_;
+	/// Used text storage.
+	unsigned textLength_;
+	/// Arguments.
+	PluginLogArgument arguments_[PLUGIN_LOG_MAX_ARGUMENTS];
+	/// Text storage.
+	char text_[PLUGIN_LOG_TEXT_SIZE];
+};
+
+/// Lock-free ring of log messages written by one thread and read by the log writer thread.
+class PluginLogRing
+{
+public:
+	/// Construct.
+	PluginLogRing() :
+		head_(0),
+		tail_(0),
+		dropped_(0)
+	{
+	}
+
+	/// Return the next free message to fill, or null if the ring is full and the message is dropped.
+	PluginLogRecord* BeginWrite()
+	{
+		const unsigned head = head_.load(std::memory_order_relaxed);
+		if (head - tail_.load(std::memory_order_acquire) >= PLUGIN_LOG_RING_SIZE)
+		{
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		return &records_[head & (PLUGIN_LOG_RING_SIZE - 1)];
+	}
+
+	/// Publish the message filled after BeginWrite.
+	void EndWrite() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	/// Return the oldest message to read, or null if the ring is empty.
+	const PluginLogRecord* BeginRead()
+	{
+		const unsigned tail = tail_.load(std::memory_order_relaxed);
+		if (tail == head_.load(std::memory_order_acquire))
+			return nullptr;
+		return &records_[tail & (PLUGIN_LOG_RING_SIZE - 1)];
+	}
+
+	/// Release the message read after BeginRead.
+	void EndRead() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	/// Return and reset the number of dropped messages.
+	unsigned TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+private:
+	/// Index of the next message to write.
+	std::atomic<unsigned> head_;
+	/// Index of the next message to read.
+	std::atomic<unsigned> tail_;
+	/// Number of messages dropped because the ring was full.
+	std::atomic<unsigned> dropped_;
+	/// Messages.
+	PluginLogRecord records_[PLUGIN_LOG_RING_SIZE];
+};
+
+/// Return argument as signed integer.
+inline long long GetPluginLogInt(const PluginLogArgument& argument)
+{
+	return argument.type_ == PLA_DOUBLE ? (long long)argument.double_ : argument.int_;
+}
+
+/// Return argument as floating point.
+inline double GetPluginLogDouble(const PluginLogArgument& argument)
+{
+	switch (argument.type_)
+	{
+	case PLA_DOUBLE: return argument.double_;
+	case PLA_UINT: return (double)argument.uint_;
+	default: return (double)argument.int_;
+	}
+}
+
+/// Format a deferred log message. Support the printf conversions and the Urho3D ones (%b for bool).
+inline String FormatPluginLogRecord(const PluginLogRecord& record)
+{
+	if (!record.format_)
+		return String(record.text_);
+
+	String result;
+	unsigned argumentIndex = 0;
+	const char* c = record.format_;
+
+	while (*c)
+	{
+		if (*c != '%')
+		{
+			const char* start = c;
+			while (*c && *c != '%')
+				++c;
+			result.Append(start, (unsigned)(c - start));
+			continue;
+		}
+
+		if (c[1] == '%')
+		{
+			result += '%';
+			c += 2;
+			continue;
+		}
+
+		// Copy flags, width and precision, the length modifier is given by the recorded argument type
+		char spec[32];
+		unsigned length = 0;
+		bool isLong = false;
+		spec[length++] = *c++;
+		while (*c && strchr("-+ #0123456789.", *c))
+		{
+			if (length < sizeof spec - 4)
+				spec[length++] = *c;
+			++c;
+		}
+		while (*c && strchr("hlLqjzt", *c))
+			isLong |= *c++ == 'l';
+
+		// A lone %l is unsigned long in Urho3D format
+		char conversion;
+		if (isLong && (!*c || !strchr("diucxXofFeEgGaApbs", *c)))
+			conversion = 'u';
+		else
+			conversion = *c ? *c++ : 0;
+		if (!conversion || argumentIndex >= record.numArguments_)
+			break;
+
+		const PluginLogArgument& argument = record.arguments_[argumentIndex++];
+		char buffer[128];
+		buffer[0] = 0;
+
+		switch (conversion)
+		{
+		case 'd':
+		case 'i':
+		case 'c':
+			spec[length++] = conversion == 'c' ? 'c' : 'l';
+			if (conversion != 'c')
+			{
+				spec[length++] = 'l';
+				spec[length++] = 'd';
+			}
+			spec[length] = 0;
+			if (conversion == 'c')
+				snprintf(buffer, sizeof buffer, spec, (int)GetPluginLogInt(argument));
+			else
+				snprintf(buffer, sizeof buffer, spec, GetPluginLogInt(argument));
+			break;
+
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			spec[length++] = 'l';
+			spec[length++] = 'l';
+			spec[length++] = conversion;
+			spec[length] = 0;
+			snprintf(buffer, sizeof buffer, spec, (unsigned long long)GetPluginLogInt(argument));
+			break;
+
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			spec[length++] = conversion;
+			spec[length] = 0;
+			snprintf(buffer, sizeof buffer, spec, GetPluginLogDouble(argument));
+			break;
+
+		case 'p':
+			snprintf(buffer, sizeof buffer, "%p", argument.pointer_);
+			break;
+
+		case 'b':
+			result += argument.int_ ? "true" : "false";
+			break;
+
+		case 's':
+			if (argument.type_ == PLA_STRING)
+				result += record.text_ + argument.textOffset_;
+			else if (argument.type_ == PLA_BOOL)
+				result += argument.int_ ? "true" : "false";
+			break;
+
+		default:
+			// Unknown conversion, keep it as is
+			result += '%';
+			result += conversion;
+			break;
+		}
+
+		result += buffer;
+	}
+
+	return result;
+}
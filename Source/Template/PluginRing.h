@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+// This file is shared between the player and the plugins and must stay identical in both.
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+/// Producers allowed on a plugin ring. There is always a single consumer.
+enum PluginRingMode : unsigned
+{
+	/// Single producer, single consumer.
+	PLUGIN_RING_SPSC = 0,
+	/// Multiple producers, single consumer.
+	PLUGIN_RING_MPSC
+};
+
+/// Offset of the element in a ring cell, after its sequence number. Elements can be aligned up to this.
+static const unsigned PLUGIN_RING_ELEMENT_OFFSET = 16;
+
+/// Bounded ring of fixed size elements shared between plugins through the player blackboard. Elements are written
+/// and read in place: the memory follows the ring object and is allocated once by the player, so its address is
+/// stable. Each cell carries a sequence number telling whether it is free or published, so producers never wait
+/// for each other and the consumer never waits for producers still writing later cells.
+class PluginRing
+{
+public:
+	/// Construct in memory of GetMemorySize() bytes aligned on 64 bytes. Capacity must be a power of two.
+	PluginRing(unsigned elementSize, unsigned capacity, PluginRingMode mode) :
+		elementSize_(elementSize),
+		capacity_(capacity),
+		stride_((PLUGIN_RING_ELEMENT_OFFSET + elementSize + PLUGIN_RING_ELEMENT_OFFSET - 1) & ~(PLUGIN_RING_ELEMENT_OFFSET - 1)),
+		mode_(mode),
+		writePosition_(0),
+		readPosition_(0)
+	{
+		for (unsigned i = 0; i < capacity_; ++i)
+			new(GetCell(i)) std::atomic<unsigned>(i);
+	}
+
+	/// Return memory needed by a ring, including the ring object.
+	static unsigned GetMemorySize(unsigned elementSize, unsigned capacity)
+	{
+		const unsigned stride = (PLUGIN_RING_ELEMENT_OFFSET + elementSize + PLUGIN_RING_ELEMENT_OFFSET - 1) &
+			~(PLUGIN_RING_ELEMENT_OFFSET - 1);
+		return (unsigned)sizeof(PluginRing) + stride * capacity;
+	}
+
+	/// Reserve the next element to write in place, or return null if the ring is full. Publish it with EndWrite and
+	/// the returned position.
+	void* BeginWrite(unsigned& position)
+	{
+		unsigned writePosition = writePosition_.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			std::atomic<unsigned>* sequence = GetCell(writePosition & (capacity_ - 1));
+			const int difference = (int)(sequence->load(std::memory_order_acquire) - writePosition);
+			if (difference < 0)
+				return nullptr;
+
+			if (difference == 0)
+			{
+				if (mode_ == PLUGIN_RING_SPSC)
+				{
+					writePosition_.store(writePosition + 1, std::memory_order_relaxed);
+					break;
+				}
+				if (writePosition_.compare_exchange_weak(writePosition, writePosition + 1, std::memory_order_relaxed))
+					break;
+			}
+			else
+				writePosition = writePosition_.load(std::memory_order_relaxed);
+		}
+
+		position = writePosition;
+		return GetElement(writePosition);
+	}
+
+	/// Publish the element written after BeginWrite.
+	void EndWrite(unsigned position)
+	{
+		GetCell(position & (capacity_ - 1))->store(position + 1, std::memory_order_release);
+	}
+
+	/// Return the oldest published element to read in place, or null if there is none. Consumer only.
+	const void* BeginRead()
+	{
+		const unsigned readPosition = readPosition_.load(std::memory_order_relaxed);
+		const int difference = (int)(GetCell(readPosition & (capacity_ - 1))->load(std::memory_order_acquire) - (readPosition + 1));
+		return difference < 0 ? nullptr : GetElement(readPosition);
+	}
+
+	/// Release the element read after BeginRead, making its cell free for the producers. Consumer only.
+	void EndRead()
+	{
+		const unsigned readPosition = readPosition_.load(std::memory_order_relaxed);
+		GetCell(readPosition & (capacity_ - 1))->store(readPosition + capacity_, std::memory_order_release);
+		readPosition_.store(readPosition + 1, std::memory_order_relaxed);
+	}
+
+	/// Copy an element into the ring. Return false if the ring is full.
+	bool Push(const void* element)
+	{
+		unsigned position;
+		void* destination = BeginWrite(position);
+		if (!destination)
+			return false;
+		memcpy(destination, element, elementSize_);
+		EndWrite(position);
+		return true;
+	}
+
+	/// Copy the oldest element out of the ring. Return false if the ring is empty. Consumer only.
+	bool Pop(void* element)
+	{
+		const void* source = BeginRead();
+		if (!source)
+			return false;
+		memcpy(element, source, elementSize_);
+		EndRead();
+		return true;
+	}
+
+	/// Return element size.
+	unsigned GetElementSize() const { return elementSize_; }
+	/// Return number of elements the ring can hold.
+	unsigned GetCapacity() const { return capacity_; }
+	/// Return producers mode.
+	PluginRingMode GetMode() const { return mode_; }
+
+private:
+	/// Return sequence number of a cell.
+	std::atomic<unsigned>* GetCell(unsigned index)
+	{
+		return reinterpret_cast<std::atomic<unsigned>*>(reinterpret_cast<unsigned char*>(this) + sizeof(PluginRing) +
+			index * stride_);
+	}
+
+	/// Return element of a position.
+	void* GetElement(unsigned position)
+	{
+		return reinterpret_cast<unsigned char*>(GetCell(position & (capacity_ - 1))) + PLUGIN_RING_ELEMENT_OFFSET;
+	}
+
+	/// Element size.
+	const unsigned elementSize_;
+	/// Number of cells, a power of two.
+	const unsigned capacity_;
+	/// Distance between cells.
+	const unsigned stride_;
+	/// Producers mode.
+	const PluginRingMode mode_;
+	/// Position of the next element to write, shared by the producers.
+	alignas(64) std::atomic<unsigned> writePosition_;
+	/// Position of the next element to read, owned by the consumer.
+	alignas(64) std::atomic<unsigned> readPosition_;
+};
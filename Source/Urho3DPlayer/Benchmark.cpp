@@ -0,0 +1,289 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Benchmark.h"
+
+/// Durations below are recorded exactly, above with this many buckets per power of two.
+static const unsigned HISTOGRAM_SUB_BUCKETS = 128;
+/// Number of exact buckets.
+static const unsigned HISTOGRAM_LINEAR_BUCKETS = HISTOGRAM_SUB_BUCKETS * 2;
+/// Highest power of two recorded, longer durations are clamped.
+static const unsigned HISTOGRAM_MAX_MAGNITUDE = 40;
+/// Total number of buckets.
+static const unsigned HISTOGRAM_BUCKETS = HISTOGRAM_LINEAR_BUCKETS + (HISTOGRAM_MAX_MAGNITUDE - 8) * HISTOGRAM_SUB_BUCKETS;
+
+/// Phase names in the report.
+static const char* benchmarkPhaseNames[] =
+{
+	"BeginFrame",
+	"Update",
+	"PostUpdate",
+	"RenderUpdate",
+	"Render",
+};
+
+/// Return peak resident memory of the process in bytes.
+static unsigned long long GetPeakResidentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+		return 0;
+#ifdef __APPLE__
+	return (unsigned long long)usage.ru_maxrss;
+#else
+	return (unsigned long long)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/// Return user and system CPU time of the process in seconds.
+static void GetCpuTimes(double& user, double& system)
+{
+	user = system = 0.0;
+#ifdef _WIN32
+	FILETIME creation, exitTime, kernel, userTime;
+	if (GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &userTime))
+	{
+		user = (((unsigned long long)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime) * 1e-7;
+		system = (((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) * 1e-7;
+	}
+#else
+	struct rusage usage;
+	if (!getrusage(RUSAGE_SELF, &usage))
+	{
+		user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+		system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+	}
+#endif
+}
+
+FrameHistogram::FrameHistogram() :
+	count_(0),
+	total_(0),
+	min_(0),
+	max_(0)
+{
+	buckets_.Resize(HISTOGRAM_BUCKETS);
+	for (unsigned i = 0; i < HISTOGRAM_BUCKETS; ++i)
+		buckets_[i] = 0;
+}
+
+void FrameHistogram::Record(long long usec)
+{
+	usec = Max(usec, 0LL);
+
+	++buckets_[GetBucket(usec)];
+	min_ = count_ ? Min(min_, usec) : usec;
+	++count_;
+	total_ += usec;
+	max_ = Max(max_, usec);
+}
+
+long long FrameHistogram::GetPercentile(double percentile) const
+{
+	if (!count_)
+		return 0;
+
+	const unsigned long long target = Max((unsigned long long)(Clamp(percentile, 0.0, 100.0) * 0.01 * count_ + 0.5), 1ULL);
+	unsigned long long seen = 0;
+	for (unsigned i = 0; i < HISTOGRAM_BUCKETS; ++i)
+	{
+		seen += buckets_[i];
+		if (seen >= target)
+			return Min(GetBucketUpperBound(i), max_);
+	}
+
+	return max_;
+}
+
+String FrameHistogram::GetReport() const
+{
+	return ToString("\"count\":%u,\"min\":%lld,\"mean\":%.1f,\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"p99.9\":%lld,\"max\":%lld",
+		count_, GetMin(), GetMean(), GetPercentile(50.0), GetPercentile(90.0), GetPercentile(99.0), GetPercentile(99.9),
+		max_);
+}
+
+unsigned FrameHistogram::GetBucket(long long usec)
+{
+	if (usec < HISTOGRAM_LINEAR_BUCKETS)
+		return (unsigned)usec;
+
+	unsigned magnitude = 0;
+	for (unsigned long long value = (unsigned long long)usec; value >>= 1;)
+		++magnitude;
+	if (magnitude >= HISTOGRAM_MAX_MAGNITUDE)
+		return HISTOGRAM_BUCKETS - 1;
+
+	// Keep the 8 most significant bits: the top one selects the power of two, the others the sub-bucket
+	const unsigned shift = magnitude - 7;
+	return HISTOGRAM_LINEAR_BUCKETS + (shift - 1) * HISTOGRAM_SUB_BUCKETS +
+		(unsigned)(usec >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+long long FrameHistogram::GetBucketUpperBound(unsigned bucket)
+{
+	if (bucket < HISTOGRAM_LINEAR_BUCKETS)
+		return bucket;
+
+	const unsigned shift = (bucket - HISTOGRAM_LINEAR_BUCKETS) / HISTOGRAM_SUB_BUCKETS + 1;
+	const long long subBucket = (bucket - HISTOGRAM_LINEAR_BUCKETS) % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+Benchmark::Benchmark(Context* context, unsigned numFrames, unsigned numWarmupFrames, float timeStep,
+	const String& reportFileName) :
+	Object(context),
+	numFrames_(Max(numFrames, 1U)),
+	numWarmupFrames_(numWarmupFrames),
+	timeStep_(timeStep),
+	reportFileName_(reportFileName),
+	frame_(0),
+	runTime_(0),
+	phaseStart_(0),
+	phase_(MAX_BENCHMARK_PHASES)
+{
+	// Frames run back to back and simulate the same time regardless of how long they take, so runs are comparable
+	auto* engine = GetSubsystem<Engine>();
+	engine->SetMaxFps(0);
+	engine->SetMaxInactiveFps(0);
+	engine->SetNextTimeStep(timeStep_);
+
+	SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Benchmark, HandleFrameEvent));
+	SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(Benchmark, HandleFrameEvent));
+	SubscribeToEvent(E_POSTUPDATE, URHO3D_HANDLER(Benchmark, HandleFrameEvent));
+	SubscribeToEvent(E_RENDERUPDATE, URHO3D_HANDLER(Benchmark, HandleFrameEvent));
+	SubscribeToEvent(E_POSTRENDERUPDATE, URHO3D_HANDLER(Benchmark, HandleFrameEvent));
+	SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Benchmark, HandleFrameEvent));
+
+	URHO3D_LOGINFOF("Benchmarking %u frames after %u warm-up frames, timestep %.4f s", numFrames_, numWarmupFrames_,
+		timeStep_);
+}
+
+String Benchmark::GetReport() const
+{
+	double userTime, systemTime;
+	GetCpuTimes(userTime, systemTime);
+	const double runSeconds = runTime_ * 0.000001;
+
+	String report;
+	report += ToString("{\"frames\":%u,\"warmupFrames\":%u,\"timeStep\":%f,\"wallTime\":%f,\"fps\":%.2f,\n", numFrames_,
+		numWarmupFrames_, timeStep_, runSeconds, runSeconds > 0.0 ? numFrames_ / runSeconds : 0.0);
+	report += "\"unit\":\"usec\",\"frameTime\":{" + frameTimes_.GetReport() + "},\n\"phases\":{";
+	for (unsigned i = 0; i < MAX_BENCHMARK_PHASES; ++i)
+	{
+		report += ToString("%s\n\"%s\":", i ? "," : "", benchmarkPhaseNames[i]);
+		report += "{" + phaseTimes_[i].GetReport() + "}";
+	}
+	report += ToString("},\n\"peakResidentMemory\":%llu,\"cpuTime\":{\"user\":%f,\"system\":%f}}\n",
+		GetPeakResidentMemory(), userTime, systemTime);
+	return report;
+}
+
+void Benchmark::HandleFrameEvent(StringHash eventType, VariantMap& eventData)
+{
+	if (eventType == E_BEGINFRAME)
+	{
+		if (frame_ == numWarmupFrames_)
+			runTimer_.Reset();
+		frameTimer_.Reset();
+		phaseStart_ = 0;
+		phase_ = BP_BEGINFRAME;
+		return;
+	}
+
+	// Close the current phase at the start of the next one
+	const long long now = frameTimer_.GetUSec(false);
+	const bool measured = frame_ >= numWarmupFrames_;
+	if (measured && phase_ < MAX_BENCHMARK_PHASES)
+		phaseTimes_[phase_].Record(now - phaseStart_);
+	phaseStart_ = now;
+
+	if (eventType == E_UPDATE)
+		phase_ = BP_UPDATE;
+	else if (eventType == E_POSTUPDATE)
+		phase_ = BP_POSTUPDATE;
+	else if (eventType == E_RENDERUPDATE)
+		phase_ = BP_RENDERUPDATE;
+	else if (eventType == E_POSTRENDERUPDATE)
+		phase_ = BP_RENDER;
+	else if (eventType == E_ENDFRAME)
+	{
+		phase_ = MAX_BENCHMARK_PHASES;
+		if (measured)
+			frameTimes_.Record(now);
+
+		GetSubsystem<Engine>()->SetNextTimeStep(timeStep_);
+		if (++frame_ == numWarmupFrames_ + numFrames_)
+		{
+			runTime_ = runTimer_.GetUSec(false);
+			Finish();
+		}
+	}
+}
+
+void Benchmark::Finish()
+{
+	UnsubscribeFromAllEvents();
+
+	const String report = GetReport();
+	if (reportFileName_.Empty())
+		PrintLine(report);
+	else
+	{
+		FILE* file = fopen(reportFileName_.CString(), "w");
+		if (file)
+		{
+			fputs(report.CString(), file);
+			fclose(file);
+			URHO3D_LOGINFO("Benchmark report written to " + reportFileName_);
+		}
+		else
+			URHO3D_LOGERROR("Failed to write benchmark report " + reportFileName_);
+	}
+
+	URHO3D_LOGINFOF("Benchmark finished: %u frames, frame time p50 %lld us, p99 %lld us, max %lld us", numFrames_,
+		frameTimes_.GetPercentile(50.0), frameTimes_.GetPercentile(99.0), frameTimes_.GetMax());
+
+	GetSubsystem<Engine>()->Exit();
+}
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+
+using namespace Urho3D;
+
+/// Histogram of durations in microseconds with a bounded relative error (log-linear buckets, below 1%).
+class FrameHistogram
+{
+public:
+	/// Construct.
+	FrameHistogram();
+
+	/// Record a duration.
+	void Record(long long usec);
+	/// Return duration at a percentile (0-100), rounded up to the bucket upper bound.
+	long long GetPercentile(double percentile) const;
+	/// Return number of recorded durations.
+	unsigned GetCount() const { return count_; }
+	/// Return smallest recorded duration.
+	long long GetMin() const { return min_; }
+	/// Return largest recorded duration.
+	long long GetMax() const { return max_; }
+	/// Return mean duration.
+	double GetMean() const { return count_ ? (double)total_ / count_ : 0.0; }
+	/// Return count, min, mean, p50, p90, p99, p99.9 and max as JSON object members.
+	String GetReport() const;
+
+private:
+	/// Return bucket of a duration.
+	static unsigned GetBucket(long long usec);
+	/// Return largest duration of a bucket.
+	static long long GetBucketUpperBound(unsigned bucket);
+
+	/// Number of durations by bucket.
+	PODVector<unsigned> buckets_;
+	/// Number of recorded durations.
+	unsigned count_;
+	/// Sum of recorded durations.
+	long long total_;
+	/// Smallest recorded duration.
+	long long min_;
+	/// Largest recorded duration.
+	long long max_;
+};
+
+/// Frame phases measured by the benchmark, delimited by the core frame events.
+enum BenchmarkPhase
+{
+	BP_BEGINFRAME = 0,
+	BP_UPDATE,
+	BP_POSTUPDATE,
+	BP_RENDERUPDATE,
+	BP_RENDER,
+	MAX_BENCHMARK_PHASES
+};
+
+/// Runs the application for a fixed number of frames with a fixed timestep, then writes a JSON report of the frame
+/// times and exits.
+class Benchmark : public Object
+{
+	URHO3D_OBJECT(Benchmark, Object);
+
+public:
+	/// Construct and start measuring from the next frame.
+	Benchmark(Context* context, unsigned numFrames, unsigned numWarmupFrames, float timeStep, const String& reportFileName);
+
+	/// Return report as JSON.
+	String GetReport() const;
+
+private:
+	/// Handle frame events to time the frame and its phases.
+	void HandleFrameEvent(StringHash eventType, VariantMap& eventData);
+	/// Write report and exit.
+	void Finish();
+
+	/// Number of measured frames.
+	unsigned numFrames_;
+	/// Number of frames run before measuring.
+	unsigned numWarmupFrames_;
+	/// Fixed timestep in seconds.
+	float timeStep_;
+	/// Report file name, empty to log the report.
+	String reportFileName_;
+	/// Number of frames run so far.
+	unsigned frame_;
+	/// Timer of the current frame.
+	HiresTimer frameTimer_;
+	/// Timer of the whole measured run.
+	HiresTimer runTimer_;
+	/// Time of the whole measured run in microseconds.
+	long long runTime_;
+	/// Frame start time of the current phase in microseconds.
+	long long phaseStart_;
+	/// Current phase.
+	unsigned phase_;
+	/// Frame times.
+	FrameHistogram frameTimes_;
+	/// Phase times.
+	FrameHistogram phaseTimes_[MAX_BENCHMARK_PHASES];
+};
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Bundle.h"
+
+Bundle::Bundle(Context* context) :
+	Object(context),
+	mapping_(nullptr),
+	mappingSize_(0)
+{
+}
+
+Bundle::~Bundle()
+{
+	Unmap();
+
+#ifndef _WIN32
+	// Loaded libraries keep their own mapping of the memory files
+	for (int memoryFile : memoryFiles_)
+		close(memoryFile);
+#endif
+}
+
+bool Bundle::Open(const String& fileName)
+{
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	fileName_ = IsAbsolutePath(fileName) ? fileName : fileSystem->GetCurrentDir() + fileName;
+
+	packageFile_ = new PackageFile(context_);
+	if (!packageFile_->Open(fileName_))
+	{
+		packageFile_.Reset();
+		return false;
+	}
+
+#ifndef _WIN32
+	// Map the whole bundle and ask the kernel to read it ahead, the loads that follow hit the page cache
+	const int file = open(fileName_.CString(), O_RDONLY);
+	struct stat fileStat;
+	if (file >= 0 && fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		void* mapping = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping != MAP_FAILED)
+		{
+			mapping_ = mapping;
+			mappingSize_ = (unsigned)fileStat.st_size;
+			madvise(mapping_, mappingSize_, MADV_WILLNEED);
+		}
+	}
+	if (file >= 0)
+		close(file);
+#endif
+
+	// Library copies of a previous session are not used anymore
+	extractDir_ = fileSystem->GetAppPreferencesDir("urho3d", "bundle");
+	Vector<String> oldCopies;
+	fileSystem->ScanDir(oldCopies, extractDir_, "*", SCAN_FILES, false);
+	for (const String& oldCopy : oldCopies)
+		fileSystem->Delete(extractDir_ + oldCopy);
+
+	URHO3D_LOGINFO(ToString("Opened bundle %s (%u entries)", fileName_.CString(), packageFile_->GetNumFiles()));
+	return true;
+}
+
+String Bundle::ReadCommandLine()
+{
+	if (!Exists("CommandLine.txt"))
+		return String::EMPTY;
+
+	File file(context_, packageFile_, "CommandLine.txt");
+	return file.IsOpen() ? file.ReadLine() : String::EMPTY;
+}
+
+String Bundle::ExtractLibrary(const String& name)
+{
+	const PackageEntry* entry = packageFile_ ? packageFile_->GetEntry(name) : nullptr;
+	if (!entry)
+		return String::EMPTY;
+
+	// Uncompressed entries are copied straight from the mapping, compressed ones are decompressed block by block
+	PODVector<unsigned char> buffer;
+	const void* data;
+	if (mapping_ && !packageFile_->IsCompressed() && entry->offset_ + entry->size_ <= mappingSize_)
+		data = static_cast<const unsigned char*>(mapping_) + entry->offset_;
+	else
+	{
+		File file(context_, packageFile_, name);
+		buffer.Resize(entry->size_);
+		if (!file.IsOpen() || file.Read(&buffer[0], buffer.Size()) != buffer.Size())
+			return String::EMPTY;
+		data = &buffer[0];
+	}
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+	// Library is loaded from an anonymous memory file, nothing is written to disk
+	const int memoryFile = memfd_create(GetFileNameAndExtension(name).CString(), MFD_CLOEXEC);
+	if (memoryFile >= 0)
+	{
+		if (write(memoryFile, data, entry->size_) == (ssize_t)entry->size_)
+		{
+			MutexLock lock(extractMutex_);
+			memoryFiles_.Push(memoryFile);
+			return ToString("/proc/self/fd/%d", memoryFile);
+		}
+		close(memoryFile);
+	}
+#endif
+
+	const String path = extractDir_ + GetFileNameAndExtension(name);
+	File file(context_);
+	if (!file.Open(path, FILE_WRITE) || file.Write(data, entry->size_) != entry->size_)
+		return String::EMPTY;
+
+	return path;
+}
+
+void Bundle::Unmap()
+{
+#ifndef _WIN32
+	if (mapping_)
+		munmap(mapping_, mappingSize_);
+#endif
+	mapping_ = nullptr;
+	mappingSize_ = 0;
+}
@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/IO/PackageFile.h>
+
+using namespace Urho3D;
+
+/// Deployment bundle: one package file holding the script, the resources and the plugin libraries. The package is
+/// mounted first in the resource cache, and plugin libraries are loaded from it without being installed on disk.
+class Bundle : public Object
+{
+	URHO3D_OBJECT(Bundle, Object);
+
+public:
+	/// Construct.
+	explicit Bundle(Context* context);
+	/// Destruct. Release the mapping and the library copies.
+	~Bundle() override;
+
+	/// Open bundle and map it in memory. Return true on success.
+	bool Open(const String& fileName);
+	/// Return absolute file name of the bundle.
+	const String& GetFileName() const { return fileName_; }
+	/// Return package file of the bundle.
+	PackageFile* GetPackageFile() const { return packageFile_; }
+	/// Return whether the bundle contains an entry.
+	bool Exists(const String& name) const { return packageFile_ && packageFile_->Exists(name); }
+	/// Return command line stored as CommandLine.txt in the bundle, or empty if none.
+	String ReadCommandLine();
+	/// Return path the library of an entry can be loaded from, or empty if the entry does not exist. On Linux the
+	/// library is copied to an anonymous memory file, elsewhere to the preferences directory. Thread-safe.
+	String ExtractLibrary(const String& name);
+
+private:
+	/// Release the mapping.
+	void Unmap();
+
+	/// Package file.
+	SharedPtr<PackageFile> packageFile_;
+	/// Absolute file name.
+	String fileName_;
+	/// Read-only mapping of the whole bundle, null if mapping is not supported.
+	void* mapping_;
+	/// Size of the mapping.
+	unsigned mappingSize_;
+	/// Directory of the library copies when anonymous memory files are not supported.
+	String extractDir_;
+	/// Anonymous memory files of the loaded libraries.
+	PODVector<int> memoryFiles_;
+	/// Mutex for the library copies.
+	Mutex extractMutex_;
+};
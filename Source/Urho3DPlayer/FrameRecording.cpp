@@ -0,0 +1,313 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Input/Input.h>
+#include <Urho3D/Input/InputEvents.h>
+#include <Urho3D/IO/Log.h>
+
+#include "FrameRecording.h"
+#include "Plugin.h"
+
+/// Identifier of the recording files.
+static const char* FRAME_RECORDING_ID = "URRP";
+/// Version of the recording format.
+static const unsigned FRAME_RECORDING_VERSION = 1;
+
+/// Recorded input events. Raw SDL events are not, as they hold pointers.
+static const StringHash recordedEvents[] =
+{
+	E_MOUSEBUTTONDOWN,
+	E_MOUSEBUTTONUP,
+	E_MOUSEMOVE,
+	E_MOUSEWHEEL,
+	E_KEYDOWN,
+	E_KEYUP,
+	E_TEXTINPUT,
+	E_TEXTEDITING,
+	E_JOYSTICKCONNECTED,
+	E_JOYSTICKDISCONNECTED,
+	E_JOYSTICKBUTTONDOWN,
+	E_JOYSTICKBUTTONUP,
+	E_JOYSTICKAXISMOVE,
+	E_JOYSTICKHATMOVE,
+	E_TOUCHBEGIN,
+	E_TOUCHEND,
+	E_TOUCHMOVE,
+	E_DROPFILE,
+	E_INPUTFOCUS,
+	E_EXITREQUESTED,
+};
+
+/// Plugin change names in the log.
+static const char* pluginChangeNames[] =
+{
+	"load",
+	"background load",
+	"unload",
+	"hot reload",
+};
+
+/// Return log name of a plugin change.
+static const char* GetPluginChangeName(PluginChange change)
+{
+	return (unsigned)change <= PLUGIN_CHANGE_RELOAD ? pluginChangeNames[change] : "unknown change";
+}
+
+FrameRecorder::FrameRecorder(Context* context, const String& fileName) :
+	Object(context),
+	file_(new File(context, fileName, FILE_WRITE)),
+	numFrames_(0)
+{
+	if (!file_->IsOpen())
+	{
+		URHO3D_LOGERROR("Failed to open frame recording " + fileName);
+		return;
+	}
+
+	file_->WriteFileID(FRAME_RECORDING_ID);
+	file_->WriteUInt(FRAME_RECORDING_VERSION);
+
+	for (const StringHash& eventType : recordedEvents)
+		SubscribeToEvent(eventType, URHO3D_HANDLER(FrameRecorder, HandleInputEvent));
+	SubscribeToEvent(E_PLUGINCHANGED, URHO3D_HANDLER(FrameRecorder, HandlePluginChanged));
+	SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(FrameRecorder, HandleEndFrame));
+
+	URHO3D_LOGINFO("Recording frames to " + fileName);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	if (!IsOpen())
+		return;
+
+	// Changes after the last frame, while stopping, are not replayed
+	file_->WriteUByte(FRAME_RECORD_END);
+	file_->Close();
+
+	URHO3D_LOGINFOF("Frame recording finished: %u frames", numFrames_);
+}
+
+void FrameRecorder::HandleInputEvent(StringHash eventType, VariantMap& eventData)
+{
+	frameRecords_.WriteUByte(FRAME_RECORD_EVENT);
+	frameRecords_.WriteStringHash(eventType);
+	frameRecords_.WriteVariantMap(eventData);
+}
+
+void FrameRecorder::HandlePluginChanged(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PluginChanged;
+
+	frameRecords_.WriteUByte(FRAME_RECORD_PLUGIN);
+	frameRecords_.WriteUByte((unsigned char)eventData[P_CHANGE].GetInt());
+	frameRecords_.WriteString(eventData[P_NAME].GetString());
+}
+
+void FrameRecorder::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+	// The timestep is known once the frame began, so the records are buffered until its end
+	file_->WriteUByte(FRAME_RECORD_FRAME);
+	file_->WriteFloat(GetSubsystem<Time>()->GetTimeStep());
+	file_->Write(frameRecords_.GetData(), frameRecords_.GetSize());
+	frameRecords_.Clear();
+	++numFrames_;
+}
+
+FrameReplayer::FrameReplayer(Context* context, const String& fileName) :
+	Object(context),
+	frame_(0),
+	numDivergences_(0),
+	loaded_(false)
+{
+	if (!Load(fileName))
+		return;
+	loaded_ = true;
+
+	// Background loads complete on their recorded frame, not when their library happens to be ready
+	GetSubsystem<Plugin>()->SetManualAsyncLoads(true);
+
+	// Plugins loaded by the script start are recorded in the first frame. Hot reloads depend on the libraries
+	// rebuilt during the recording, they are not replayed.
+	for (const FrameReplayRecord& record : frames_[0].records_)
+	{
+		if (record.type_ == FRAME_RECORD_PLUGIN && record.change_ != PLUGIN_CHANGE_RELOAD)
+			expectedChanges_.Push(record);
+	}
+
+	auto* engine = GetSubsystem<Engine>();
+	engine->SetMaxFps(0);
+	engine->SetMaxInactiveFps(0);
+	engine->SetNextTimeStep(frames_[0].timeStep_);
+
+	SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(FrameReplayer, HandleBeginFrame));
+	SubscribeToEvent(E_PLUGINCHANGED, URHO3D_HANDLER(FrameReplayer, HandlePluginChanged));
+	SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(FrameReplayer, HandleEndFrame));
+
+	URHO3D_LOGINFOF("Replaying %u frames from %s", frames_.Size(), fileName.CString());
+}
+
+bool FrameReplayer::Load(const String& fileName)
+{
+	File file(context_, fileName, FILE_READ);
+	if (!file.IsOpen())
+	{
+		URHO3D_LOGERROR("Failed to open frame recording " + fileName);
+		return false;
+	}
+
+	if (file.ReadFileID() != FRAME_RECORDING_ID)
+	{
+		URHO3D_LOGERROR(fileName + " is not a frame recording");
+		return false;
+	}
+
+	const unsigned version = file.ReadUInt();
+	if (version != FRAME_RECORDING_VERSION)
+	{
+		URHO3D_LOGERRORF("Frame recording %s has unsupported version %u", fileName.CString(), version);
+		return false;
+	}
+
+	bool ended = false;
+	while (!ended && !file.IsEof())
+	{
+		const unsigned char type = file.ReadUByte();
+		if (type == FRAME_RECORD_FRAME)
+		{
+			frames_.Push(FrameReplayFrame());
+			frames_.Back().timeStep_ = file.ReadFloat();
+			continue;
+		}
+		if (type == FRAME_RECORD_END)
+		{
+			ended = true;
+			continue;
+		}
+		if ((type != FRAME_RECORD_EVENT && type != FRAME_RECORD_PLUGIN) || frames_.Empty())
+		{
+			URHO3D_LOGERRORF("Frame recording %s is corrupted at offset %u", fileName.CString(), file.GetPosition() - 1);
+			return false;
+		}
+
+		frames_.Back().records_.Push(FrameReplayRecord());
+		FrameReplayRecord& record = frames_.Back().records_.Back();
+		record.type_ = (FrameRecordType)type;
+		if (type == FRAME_RECORD_EVENT)
+		{
+			record.eventType_ = file.ReadStringHash();
+			record.eventData_ = file.ReadVariantMap();
+		}
+		else
+		{
+			record.change_ = (PluginChange)file.ReadUByte();
+			record.name_ = file.ReadString();
+		}
+	}
+
+	if (frames_.Empty())
+	{
+		URHO3D_LOGERROR("Frame recording " + fileName + " has no frame");
+		return false;
+	}
+	if (!ended)
+		URHO3D_LOGWARNING("Frame recording " + fileName + " is truncated, replaying the frames recorded");
+
+	return true;
+}
+
+void FrameReplayer::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+	// Input events are sent by the input subsystem, which is present even if not initialized in headless mode, so
+	// handlers subscribed to its events only receive them too
+	Object* sender = GetSubsystem<Input>();
+	if (!sender)
+		sender = this;
+
+	for (FrameReplayRecord& record : frames_[frame_].records_)
+	{
+		if (record.type_ == FRAME_RECORD_EVENT)
+		{
+			// Handlers may modify the event data, send a copy
+			VariantMap recordedData = record.eventData_;
+			sender->SendEvent(record.eventType_, recordedData);
+		}
+		else if (record.change_ == PLUGIN_CHANGE_LOAD_ASYNC)
+		{
+			if (!GetSubsystem<Plugin>()->CompleteAsyncLoad(record.name_))
+				Diverge("Plugin \"" + record.name_ + "\" is not loading in background");
+		}
+	}
+}
+
+void FrameReplayer::HandlePluginChanged(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PluginChanged;
+
+	const String& name = eventData[P_NAME].GetString();
+	const PluginChange change = (PluginChange)eventData[P_CHANGE].GetInt();
+	if (change == PLUGIN_CHANGE_RELOAD)
+		return;
+
+	for (unsigned i = 0; i < expectedChanges_.Size(); ++i)
+	{
+		if (expectedChanges_[i].change_ == change && expectedChanges_[i].name_ == name)
+		{
+			expectedChanges_.Erase(i);
+			return;
+		}
+	}
+
+	Diverge(ToString("Unexpected %s of plugin \"%s\"", GetPluginChangeName(change), name.CString()));
+}
+
+void FrameReplayer::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+	for (const FrameReplayRecord& record : expectedChanges_)
+		Diverge(ToString("Missing %s of plugin \"%s\"", GetPluginChangeName(record.change_), record.name_.CString()));
+	expectedChanges_.Clear();
+
+	if (++frame_ == frames_.Size())
+	{
+		UnsubscribeFromAllEvents();
+		URHO3D_LOGINFOF("Replay finished: %u frames, %u plugin changes differing from the recording", frame_,
+			numDivergences_);
+		GetSubsystem<Engine>()->Exit();
+		return;
+	}
+
+	for (const FrameReplayRecord& record : frames_[frame_].records_)
+	{
+		if (record.type_ == FRAME_RECORD_PLUGIN && record.change_ != PLUGIN_CHANGE_RELOAD)
+			expectedChanges_.Push(record);
+	}
+	GetSubsystem<Engine>()->SetNextTimeStep(frames_[frame_].timeStep_);
+}
+
+void FrameReplayer::Diverge(const String& message)
+{
+	++numDivergences_;
+	URHO3D_LOGWARNINGF("Replay frame %u: %s", frame_, message.CString());
+}
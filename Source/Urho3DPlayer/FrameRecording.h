@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "PluginEvents.h"
+
+using namespace Urho3D;
+
+/// Record kinds of a frame recording.
+enum FrameRecordType
+{
+	/// Start of a frame: Float timestep.
+	FRAME_RECORD_FRAME = 0,
+	/// Input event sent during the frame: StringHash event type, VariantMap event data.
+	FRAME_RECORD_EVENT,
+	/// Plugin change during the frame: UByte PluginChange, String plugin filename.
+	FRAME_RECORD_PLUGIN,
+	/// End of the recording.
+	FRAME_RECORD_END
+};
+
+/// Records the timestep, input events and plugin changes of each frame to a file, to replay the session with
+/// FrameReplayer.
+class FrameRecorder : public Object
+{
+	URHO3D_OBJECT(FrameRecorder, Object);
+
+public:
+	/// Construct and record from the next frame.
+	FrameRecorder(Context* context, const String& fileName);
+	/// Destruct. Close the recording.
+	~FrameRecorder() override;
+
+	/// Return whether the recording file is open.
+	bool IsOpen() const { return file_ && file_->IsOpen(); }
+
+private:
+	/// Handle an input event to record it in the current frame.
+	void HandleInputEvent(StringHash eventType, VariantMap& eventData);
+	/// Handle a plugin change to record it in the current frame.
+	void HandlePluginChanged(StringHash eventType, VariantMap& eventData);
+	/// Handle end of frame to write the frame.
+	void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+
+	/// Recording file.
+	SharedPtr<File> file_;
+	/// Records of the current frame.
+	VectorBuffer frameRecords_;
+	/// Number of recorded frames.
+	unsigned numFrames_;
+};
+
+/// Recorded input event or plugin change.
+struct FrameReplayRecord
+{
+	/// Record kind, FRAME_RECORD_EVENT or FRAME_RECORD_PLUGIN.
+	FrameRecordType type_;
+	/// Event type.
+	StringHash eventType_;
+	/// Event data.
+	VariantMap eventData_;
+	/// Plugin change.
+	PluginChange change_;
+	/// Plugin filename.
+	String name_;
+};
+
+/// Recorded frame.
+struct FrameReplayFrame
+{
+	/// Timestep in seconds.
+	float timeStep_;
+	/// Input events and plugin changes in recorded order.
+	Vector<FrameReplayRecord> records_;
+};
+
+/// Replays a recording of FrameRecorder: runs the frames with their recorded timestep, sends their input events and
+/// completes background plugin loads on their recorded frame, then exits. Plugin changes differing from the
+/// recording are logged.
+class FrameReplayer : public Object
+{
+	URHO3D_OBJECT(FrameReplayer, Object);
+
+public:
+	/// Construct and replay from the next frame.
+	FrameReplayer(Context* context, const String& fileName);
+
+	/// Return whether the recording was loaded.
+	bool IsLoaded() const { return loaded_; }
+	/// Return number of plugin changes differing from the recording so far.
+	unsigned GetNumDivergences() const { return numDivergences_; }
+
+private:
+	/// Load the recording. Return true if successful.
+	bool Load(const String& fileName);
+	/// Handle begin of frame to send the recorded input events and complete the recorded plugin loads.
+	void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+	/// Handle a plugin change to check it against the recording.
+	void HandlePluginChanged(StringHash eventType, VariantMap& eventData);
+	/// Handle end of frame to set the next recorded timestep, or exit after the last frame.
+	void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+	/// Log a plugin change differing from the recording.
+	void Diverge(const String& message);
+
+	/// Recorded frames.
+	Vector<FrameReplayFrame> frames_;
+	/// Current frame.
+	unsigned frame_;
+	/// Plugin changes of the current frame not seen yet.
+	Vector<FrameReplayRecord> expectedChanges_;
+	/// Number of plugin changes differing from the recording.
+	unsigned numDivergences_;
+	/// Flag whether the recording was loaded.
+	bool loaded_;
+};
@@ -1,7 +1,9 @@
-#pragma once
-
-inline const char* GetUrhoVersion() { return "Unversioned"; }
-
-inline const char* GetCompilerID() { return "MSVC"; }
-
-inline const char* GetCompilerVersion() { return "19.13.26129.0"; }
\ No newline at end of file
+#pragma once
+
+inline constexpr const char* GetGraphicAPIName() { return "D3D11"; }
+
+inline constexpr const char* GetUrhoVersion() { return "Unversioned"; }
+
+inline constexpr const char* GetCompilerID() { return "MSVC"; }
+
+inline constexpr const char* GetCompilerVersion() { return "19.13.26129.0"; }
\ No newline at end of file
@@ -1,229 +1,1631 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#include <Urho3D/IO/Log.h>
-#include <Urho3D/IO/FileSystem.h>
-#include <Urho3D/Container/Vector.h>
-#include <Urho3D/Core/ProcessUtils.h>
-#include <Urho3D/Graphics/Graphics.h>
-#include <SDL/SDL.h>
-
-#include "Plugin.h"
-#include "Info.h"
-
-#ifdef _WIN32
-static const char* EXTENTION_PLUGIN_NAME = ".dll";
-#elif __APPLE__
-static const char* EXTENTION_PLUGIN_NAME = ".dylib";
-#elif __linux__
-static const char* EXTENTION_PLUGIN_NAME = ".so";
-#elif __EMSCRIPTEN__
-static const char* EXTENTION_PLUGIN_NAME = ".js";
-#else
-static const char* EXTENTION_PLUGIN_NAME = "";
-#endif
-
-// Macro helper to load function from plugin
-#define LOAD_FUNCTION( Type, FunctionName) \
-	pluginObject.FunctionName = Type SDL_LoadFunction(pluginObject.handle_, #FunctionName);\
-	if (!pluginObject.FunctionName)\
-	{\
-		SDL_UnloadObject(pluginObject.handle_);\
-		URHO3D_LOGERROR("Unfind \""+ String(#FunctionName) +"\" on plugin: \"" + name + "\"!");\
-		return false;\
-	}
-
-// Macro helper to check plugin info and compatibility
-#define CHECK_INFO( GetPluginInfo, GetLocalInfo ) \
-	LOAD_FUNCTION( (const char* (*)()), GetPluginInfo ) \
-	else\
-	{\
-		String pluginInfo(pluginObject.GetPluginInfo());\
-		Vector<String> infos = pluginInfo.Split(';');\
-	\
-		if (!infos.Empty())\
-		{\
-			String version = GetLocalInfo();\
-			bool isIncompatible = true;\
-			for(String info : infos)\
-			{\
-				if (version == info)\
-				{\
-					isIncompatible = false;\
-					break;\
-				}\
-			}\
-			if(isIncompatible)\
-			{\
-				SDL_UnloadObject(pluginObject.handle_);\
-				URHO3D_LOGWARNING("Incompatible \"" + String(#GetLocalInfo) + "\" with \"" + String(#GetPluginInfo) + "\"!");\
-				return false;\
-			}\
-		}\
-	}
-
-Plugin::Plugin(Context* context) :
-	Object(context)
-{
-}
-
-Plugin::~Plugin()
-{
-	UnloadAll();
-}
-
-bool Plugin::Load(const String& name, bool forceToStart)
-{
-	PluginObject pluginObject;
-
-	// Just keep filename to register
-	const String filename = GetFileName(name);
-	
-	// If it is previously loaded we are not need to reload.
-	if (IsLoaded(filename))
-	{
-		URHO3D_LOGDEBUG("Plugin: \"" + name + "\" previously loaded");
-		return true;
-	}
-
-	// Add or replace extention with current platform
-	const String replacedName = ReplaceExtension(name, String(EXTENTION_PLUGIN_NAME));
-
-	// First load handle.
-	pluginObject.handle_ = SDL_LoadObject(replacedName.CString());
-	if (!pluginObject.handle_)
-	{
-		URHO3D_LOGERROR("Unfind plugin: \"" + name + "\"!");
-		return false;
-	}
-	// Get compatible urho3D version and compare.
-	CHECK_INFO(GetUrhoCompatibleVersion, GetUrhoVersion)
-
-	// Get compatible compilator name and compare.
-	CHECK_INFO(GetCompatibleCompilatorName, GetCompilerID)
-
-	// Get compatible compilator version and compare.
-	CHECK_INFO(GetCompatibleCompilatorVersion, GetCompilerVersion)
-
-	// Get compatible OS version and compare.
-	CHECK_INFO(GetCompatibleOSVersion, GetOSVersion )
-
-	// Get compatible graphics API and compare.
-	auto graphics = GetSubsystem<Graphics>();
-	CHECK_INFO(GetCompatibleGraphicAPI, graphics->GetApiName)
-
-	// Load main plugin function.
-	LOAD_FUNCTION((void(*)(Context*)), CreatePluginApplication)
-	LOAD_FUNCTION((void(*)(Context*)), DestroyPluginApplication)
-	LOAD_FUNCTION((void(*)(VariantMap& parameters)), Setup)
-	LOAD_FUNCTION((void(*)()), Start)
-	LOAD_FUNCTION((void(*)()), Stop)
-	LOAD_FUNCTION((void(*)(const char*, void*)), OnScriptBinding)
-
-	// Construct plugin application
-	pluginObject.CreatePluginApplication(context_);
-
-	// Force to start in case is loaded on the runtime
-	if (forceToStart)
-		pluginObject.Start();
-
-	// Set on the memory.
-	pluginObjects_[filename] = pluginObject;
-
-	return true;
-}
-
-void Plugin::Unload(const String& name, bool forceToStop)
-{
-	// Just get filename
-	const String filename = GetFileName(name);
-
-	HashMap<String, PluginObject>::Iterator i = pluginObjects_.Find(filename);
-	if (i == pluginObjects_.End())
-	{
-		URHO3D_LOGWARNING("Impossible to unload plugin: \"" + name + "\" unfinding.");
-		return;
-	}
-
-	if (forceToStop)
-		i->second_.Stop();
-
-	i->second_.DestroyPluginApplication(context_);
-	pluginObjects_.Erase(i);
-}
-
-void Plugin::UnloadAll()
-{
-	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
-	{
-		i->second_.DestroyPluginApplication(context_);
-	}
-
-	pluginObjects_.Clear();
-}
-
-bool Plugin::IsLoaded(const String& name) const
-{
-	// Just get filename
-	const String filename = GetFileName(name);
-
-	HashMap<String, PluginObject>::ConstIterator i = pluginObjects_.Find(filename);
-	return (i != pluginObjects_.End());
-}
-
-void Plugin::Setup(VariantMap& parameters)
-{
-	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
-	{
-		i->second_.Setup(parameters);
-	}
-}
-
-void Plugin::Start()
-{
-	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
-	{
-		i->second_.Start();
-	}
-}
-
-void Plugin::Stop()
-{
-	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
-	{
-		i->second_.Stop();
-	}
-}
-
-bool Plugin::Empty() const
-{
-	return pluginObjects_.Empty();
-}
-
-void Plugin::OnScriptBinding(const String scriptTypeName, void* scriptContext)
-{
-	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
-	{
-		i->second_.OnScriptBinding(scriptTypeName.CString(), scriptContext);
-	}
-}
-
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Math/MathDefs.h>
+#include <SDL/SDL.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "Plugin.h"
+#include "PluginEvents.h"
+#include "Info.h"
+#include "StartupTrace.h"
+
+#ifdef _WIN32
+static const char* EXTENTION_PLUGIN_NAME = ".dll";
+#elif __APPLE__
+static const char* EXTENTION_PLUGIN_NAME = ".dylib";
+#elif __linux__
+static const char* EXTENTION_PLUGIN_NAME = ".so";
+#elif __EMSCRIPTEN__
+static const char* EXTENTION_PLUGIN_NAME = ".js";
+#else
+static const char* EXTENTION_PLUGIN_NAME = "";
+#endif
+
+// ABI fingerprint the plugins must match, computed when compiling the player
+static constexpr unsigned long long PLAYER_ABI_FINGERPRINT =
+	GetPluginABIFingerprint(GetUrhoVersion(), GetCompilerID(), GetCompilerVersion(), GetGraphicAPIName());
+
+// Profiled sections of the plugin entry points
+static const StringHash SECTION_CONFIGURE("Configure");
+static const StringHash SECTION_CREATE("Create");
+static const StringHash SECTION_SETUP("Setup");
+static const StringHash SECTION_START("Start");
+static const StringHash SECTION_STOP("Stop");
+static const StringHash SECTION_RELOAD("Reload");
+static const StringHash SECTION_SCRIPT_BINDING("OnScriptBinding");
+
+// Profiled sections of the per-frame hooks, by PluginHook
+static const char* hookSectionNames[] = { "OnUpdate", "OnPostUpdate", "OnEndFrame" };
+static const StringHash hookSections[] = { StringHash(hookSectionNames[0]), StringHash(hookSectionNames[1]),
+	StringHash(hookSectionNames[2]) };
+
+Plugin::Plugin(Context* context) :
+	Object(context)
+{
+	// Created first to join the plugin tasks before any other post update handler
+	scheduler_ = new PluginScheduler(context_);
+	logWriter_ = new PluginLogWriter(context_);
+	blackboard_ = new PluginBlackboard(context_);
+	services_ = new PluginServices(context_);
+}
+
+Plugin::~Plugin()
+{
+	UnloadAll();
+}
+
+bool Plugin::Load(const String& name, bool forceToStart)
+{
+	StartupTraceScope traceScope("Plugin::Load", name);
+
+	PluginLoadTask task;
+	task.name_ = name;
+	task.bundle_ = bundle_;
+
+	// Just keep filename to register
+	task.filename_ = GetFileName(name);
+	
+	// If it is previously loaded we are not need to reload.
+	if (IsLoaded(StringHash(task.filename_)))
+	{
+		URHO3D_LOGDEBUG("Plugin: \"" + name + "\" previously loaded");
+		return true;
+	}
+
+	if (!ResolveLibrary(task))
+	{
+		Log::Write(task.errorLevel_, task.error_);
+		return false;
+	}
+
+	CreateApplication(task, forceToStart);
+	return true;
+}
+
+SharedPtr<PluginLoadHandle> Plugin::LoadAsync(const String& name, bool forceToStart)
+{
+	const String filename = GetFileName(name);
+
+	// Plugin already loading shares its progress
+	for (const SharedPtr<PluginAsyncLoad>& asyncLoad : asyncLoads_)
+	{
+		if (asyncLoad->task_.filename_ == filename)
+			return asyncLoad->handle_;
+	}
+
+	SharedPtr<PluginAsyncLoad> asyncLoad(new PluginAsyncLoad());
+	asyncLoad->handle_ = new PluginLoadHandle(name);
+	asyncLoad->task_.name_ = name;
+	asyncLoad->task_.filename_ = filename;
+	asyncLoad->task_.bundle_ = bundle_;
+	asyncLoad->forceToStart_ = forceToStart;
+
+	// A plugin loaded already completes on the next frame too, so the caller always gets the event
+	auto* queue = GetSubsystem<WorkQueue>();
+	if (!IsLoaded(StringHash(filename)))
+	{
+		if (queue)
+		{
+			// Not taken from the pool: pooled items are reset once completed, before the frames polling them
+			asyncLoad->item_ = new WorkItem();
+			asyncLoad->item_->priority_ = 0;
+			asyncLoad->item_->workFunction_ = ResolveLibraryWork;
+			asyncLoad->item_->start_ = &asyncLoad->task_;
+			queue->AddWorkItem(asyncLoad->item_);
+		}
+		else
+			asyncLoad->task_.resolved_ = ResolveLibrary(asyncLoad->task_);
+	}
+
+	asyncLoads_.Push(asyncLoad);
+	SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Plugin, HandleBeginFrame));
+	return asyncLoad->handle_;
+}
+
+unsigned Plugin::Configure(const Vector<String>& names, VariantMap& parameters)
+{
+	Vector<PluginLoadTask> tasks;
+	PrepareLoadTasks(names, tasks);
+	ResolveLoadTasks(tasks, Engine::GetParameter(parameters, EP_WORKER_THREADS, true).GetBool());
+
+	// Plugins adjust the parameters in the given order, errors are reported when the plugins are loaded
+	unsigned numConfigured = 0;
+	for (PluginLoadTask& task : tasks)
+	{
+		if (task.resolved_)
+		{
+			PluginObject& pluginObject = task.pluginObject_;
+			CreateRuntime(pluginObject, task.filename_);
+
+			StartupTraceScope traceScope("Configure", task.filename_);
+			PluginTimeScope scope(pluginObject.runtime_, SECTION_CONFIGURE);
+			pluginObject.descriptor_->Configure(parameters);
+			++numConfigured;
+		}
+
+		configuredTasks_.Push(task);
+	}
+
+	return numConfigured;
+}
+
+unsigned Plugin::LoadAll(const Vector<String>& names, bool forceToStart)
+{
+	Vector<PluginLoadTask> tasks;
+	PrepareLoadTasks(names, tasks);
+	ResolveLoadTasks(tasks);
+
+	// Construct plugin applications on this thread in deterministic order
+	unsigned numLoaded = 0;
+	for (PluginLoadTask& task : tasks)
+	{
+		if (!task.resolved_)
+		{
+			Log::Write(task.errorLevel_, task.error_);
+			continue;
+		}
+
+		CreateApplication(task, forceToStart);
+		++numLoaded;
+	}
+
+	return numLoaded;
+}
+
+void Plugin::PrepareLoadTasks(const Vector<String>& names, Vector<PluginLoadTask>& tasks)
+{
+	// Keep one task per library not already loaded, in the given order
+	tasks.Reserve(names.Size());
+	for (const String& name : names)
+	{
+		const String filename = GetFileName(name);
+
+		bool isDuplicate = IsLoaded(filename);
+		for (unsigned i = 0; i < tasks.Size() && !isDuplicate; ++i)
+			isDuplicate = tasks[i].filename_ == filename;
+
+		if (isDuplicate)
+		{
+			URHO3D_LOGDEBUG("Plugin: \"" + name + "\" previously loaded");
+			continue;
+		}
+
+		// Take over the library resolved by Configure
+		bool isConfigured = false;
+		for (unsigned i = 0; i < configuredTasks_.Size(); ++i)
+		{
+			if (configuredTasks_[i].filename_ == filename)
+			{
+				tasks.Push(configuredTasks_[i]);
+				configuredTasks_.Erase(i);
+				isConfigured = true;
+				break;
+			}
+		}
+
+		if (isConfigured)
+			continue;
+
+		tasks.Resize(tasks.Size() + 1);
+		PluginLoadTask& task = tasks.Back();
+		task.name_ = name;
+		task.filename_ = filename;
+		task.bundle_ = bundle_;
+	}
+}
+
+void Plugin::ResolveLoadTasks(Vector<PluginLoadTask>& tasks, bool workerThreads)
+{
+	// Tasks taken over from Configure are resolved already, successfully or not
+	PODVector<PluginLoadTask*> pendingTasks;
+	for (PluginLoadTask& task : tasks)
+	{
+		if (!task.resolved_ && task.error_.Empty())
+			pendingTasks.Push(&task);
+	}
+
+	// Open, relocate and check libraries on the worker threads. With a single library the work queue would only
+	// add overhead, so resolve directly.
+	auto* queue = GetSubsystem<WorkQueue>();
+	if (pendingTasks.Size() < 2)
+	{
+		for (PluginLoadTask* task : pendingTasks)
+			task->resolved_ = ResolveLibrary(*task);
+	}
+	else if (queue && queue->GetNumThreads())
+	{
+		for (PluginLoadTask* task : pendingTasks)
+		{
+			SharedPtr<WorkItem> item = queue->GetFreeItem();
+			item->priority_ = M_MAX_UNSIGNED;
+			item->workFunction_ = ResolveLibraryWork;
+			item->start_ = task;
+			queue->AddWorkItem(item);
+		}
+		queue->Complete(M_MAX_UNSIGNED);
+	}
+#ifdef URHO3D_THREADING
+	else if (workerThreads && (!GetSubsystem<Engine>() || !GetSubsystem<Engine>()->IsInitialized()))
+	{
+		// Configure runs before the engine initialization creates the worker threads, resolve on threads of our
+		// own, the calling thread included, unless the engine parameters disable them
+		const unsigned numThreads = Min(pendingTasks.Size(), Max(GetNumLogicalCPUs(), 1U));
+		std::atomic<unsigned> nextTask(0);
+		auto resolveTasks = [&pendingTasks, &nextTask]()
+		{
+			for (unsigned i = nextTask++; i < pendingTasks.Size(); i = nextTask++)
+				pendingTasks[i]->resolved_ = ResolveLibrary(*pendingTasks[i]);
+		};
+
+		std::unique_ptr<std::thread[]> threads(new std::thread[numThreads - 1]);
+		for (unsigned i = 0; i + 1 < numThreads; ++i)
+			threads[i] = std::thread(resolveTasks);
+		resolveTasks();
+		for (unsigned i = 0; i + 1 < numThreads; ++i)
+			threads[i].join();
+	}
+#endif
+	else
+	{
+		// Worker threads disabled
+		for (PluginLoadTask* task : pendingTasks)
+			task->resolved_ = ResolveLibrary(*task);
+	}
+}
+
+bool Plugin::ResolveLibrary(PluginLoadTask& task)
+{
+	PluginObject& pluginObject = task.pluginObject_;
+
+	// Add or replace extention with current platform
+	const String replacedName = ReplaceExtension(task.name_, String(EXTENTION_PLUGIN_NAME));
+
+	pluginObject.path_ = replacedName;
+
+	// Libraries of the deployment bundle are loaded from memory, as named or from its Plugins directory
+	if (task.bundle_)
+	{
+		StartupTraceScope traceScope("Extract from bundle", task.name_);
+		String bundledPath = task.bundle_->ExtractLibrary(replacedName);
+		if (bundledPath.Empty())
+			bundledPath = task.bundle_->ExtractLibrary("Plugins/" + GetFileNameAndExtension(replacedName));
+
+		if (!bundledPath.Empty())
+		{
+			pluginObject.path_ = bundledPath;
+			pluginObject.bundled_ = true;
+		}
+	}
+
+	// First load handle.
+	{
+		StartupTraceScope traceScope("SDL_LoadObject", task.name_);
+		pluginObject.handle_ = SDL_LoadObject(pluginObject.path_.CString());
+	}
+	if (!pluginObject.handle_)
+	{
+		task.error_ = "Unfind plugin: \"" + task.name_ + "\"!";
+		task.errorLevel_ = LOG_ERROR;
+		return false;
+	}
+
+	StartupTraceScope traceScope("Check compatibility", task.name_);
+
+	// Get the entry points table.
+	auto GetPluginDescriptor = (const PluginDescriptor* (*)()) SDL_LoadFunction(pluginObject.handle_, PLUGIN_DESCRIPTOR_FUNCTION);
+	pluginObject.descriptor_ = GetPluginDescriptor ? GetPluginDescriptor() : nullptr;
+	if (!pluginObject.descriptor_)
+	{
+		SDL_UnloadObject(pluginObject.handle_);
+		task.error_ = "Unfind \"" + String(PLUGIN_DESCRIPTOR_FUNCTION) + "\" on plugin: \"" + task.name_ + "\"!";
+		task.errorLevel_ = LOG_ERROR;
+		return false;
+	}
+
+	// Check descriptor layout, then urho3D version, compilator, graphics API and structure sizes in one compare.
+	const PluginDescriptor& descriptor = *pluginObject.descriptor_;
+	if (descriptor.version_ != PLUGIN_DESCRIPTOR_VERSION || descriptor.abiFingerprint_ != PLAYER_ABI_FINGERPRINT)
+	{
+		SDL_UnloadObject(pluginObject.handle_);
+		task.error_ = "Incompatible plugin: \"" + task.name_ + "\" (descriptor version " + String(descriptor.version_) +
+			", ABI fingerprint " + ToString("%016llx", descriptor.abiFingerprint_) + " instead of " + ToString("%016llx", PLAYER_ABI_FINGERPRINT) + ")!";
+		task.errorLevel_ = LOG_WARNING;
+		return false;
+	}
+
+	return true;
+}
+
+void Plugin::ResolveLibraryWork(const WorkItem* item, unsigned threadIndex)
+{
+	auto* task = reinterpret_cast<PluginLoadTask*>(item->start_);
+	task->resolved_ = ResolveLibrary(*task);
+}
+
+void Plugin::CreateApplication(PluginLoadTask& task, bool forceToStart, PluginChange change)
+{
+	PluginObject& pluginObject = task.pluginObject_;
+
+	// Runtime exists already if the plugin was configured
+	if (!pluginObject.runtime_)
+		CreateRuntime(pluginObject, task.filename_);
+
+	// Construct plugin application
+	{
+		StartupTraceScope traceScope("CreatePluginApplication", task.filename_);
+		PluginTimeScope scope(pluginObject.runtime_, SECTION_CREATE);
+		pluginObject.instance_ = pluginObject.descriptor_->CreatePluginApplication(context_, pluginObject.runtime_);
+	}
+
+	// Force to start in case is loaded on the runtime
+	if (forceToStart)
+	{
+		PluginTimeScope scope(pluginObject.runtime_, SECTION_START);
+		pluginObject.descriptor_->Start(pluginObject.instance_);
+	}
+
+	// Set on the memory.
+	pluginObjects_[task.filename_] = pluginObject;
+	Publish(task.filename_, pluginObject);
+	initOrderDirty_ = true;
+	SubscribeFrameHooks(*pluginObject.descriptor_);
+
+	if (hotReload_)
+		WatchLibrary(pluginObject);
+
+	SendChanged(task.filename_, change);
+}
+
+void Plugin::SendChanged(const String& filename, PluginChange change)
+{
+	using namespace PluginChanged;
+
+	VariantMap& eventData = GetEventDataMap();
+	eventData[P_NAME] = filename;
+	eventData[P_CHANGE] = change;
+	SendEvent(E_PLUGINCHANGED, eventData);
+}
+
+void Plugin::Unload(const String& name, bool forceToStop)
+{
+	// Just get filename
+	const String filename = GetFileName(name);
+
+	for (unsigned j = 0; j < hosts_.Size(); ++j)
+	{
+		if (GetFileName(hosts_[j]->GetName()) == filename)
+		{
+			hosts_[j]->Stop();
+			hosts_.Erase(j);
+			return;
+		}
+	}
+
+	HashMap<String, PluginObject>::Iterator i = pluginObjects_.Find(filename);
+	if (i == pluginObjects_.End())
+	{
+		URHO3D_LOGWARNING("Impossible to unload plugin: \"" + name + "\" unfinding.");
+		return;
+	}
+
+	// Plugin tasks must not be running anymore, other plugins lose its services and new readers do not see it. The
+	// frame hooks are gathered again on their next call. Readers on other threads are not waited for: the
+	// application is destroyed once they are done, usually right away, and the library is closed in background.
+	scheduler_->Join();
+	services_->Revoke(i->second_.runtime_);
+	registry_.Remove(StringHash(filename));
+	Retire(i->second_, PluginEpoch::Advance(), forceToStop);
+	if (runningHooks_)
+	{
+		// Skip the hooks of the plugin in the calls in progress
+		for (Vector<PluginFrameHook>& hooks : frameHooks_)
+		{
+			for (PluginFrameHook& hook : hooks)
+			{
+				if (hook.instance_ == i->second_.instance_)
+					hook.function_ = nullptr;
+			}
+		}
+	}
+	pluginObjects_.Erase(i);
+	initOrderDirty_ = true;
+	UpdateRetired(false);
+
+	SendChanged(filename, PLUGIN_CHANGE_UNLOAD);
+}
+
+void Plugin::UnloadAll()
+{
+	hosts_.Clear();
+	scheduler_->Join();
+
+	// Background loads and hot reloads are abandoned once done with their library
+	if (!asyncLoads_.Empty() || !reloads_.Empty())
+	{
+		auto* queue = GetSubsystem<WorkQueue>();
+		if (queue)
+			queue->Complete(0);
+	}
+
+	if (!reloads_.Empty())
+	{
+		auto* fileSystem = GetSubsystem<FileSystem>();
+		for (const SharedPtr<PluginReload>& reload : reloads_)
+		{
+			if (reload->task_.resolved_)
+				SDL_UnloadObject(reload->task_.pluginObject_.handle_);
+			if (fileSystem)
+				fileSystem->Delete(reload->task_.name_);
+		}
+
+		reloads_.Clear();
+		pendingReloads_.Clear();
+	}
+
+	if (!asyncLoads_.Empty())
+	{
+		for (const SharedPtr<PluginAsyncLoad>& asyncLoad : asyncLoads_)
+		{
+			if (asyncLoad->task_.resolved_)
+				SDL_UnloadObject(asyncLoad->task_.pluginObject_.handle_);
+
+			PluginLoadHandle& handle = *asyncLoad->handle_;
+			handle.complete_ = true;
+			handle.succeeded_ = false;
+			handle.error_ = "Plugin: \"" + handle.name_ + "\" unloaded before loading completed";
+		}
+
+		asyncLoads_.Clear();
+	}
+
+	for (HashMap<String, PluginObject>::ConstIterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+		services_->Revoke(i->second_.runtime_);
+	registry_.Clear();
+
+	// Destroy dependents first
+	const unsigned long long epoch = PluginEpoch::Advance();
+	UpdateInitOrder();
+	for (unsigned i = initOrder_.Size() - 1; i < initOrder_.Size(); --i)
+		Retire(pluginObjects_[initOrder_[i]], epoch, false);
+
+	// Unloaded from a hook, the plugins are destroyed once the hook calls are done
+	if (runningHooks_)
+	{
+		for (Vector<PluginFrameHook>& hooks : frameHooks_)
+		{
+			for (PluginFrameHook& hook : hooks)
+				hook.function_ = nullptr;
+		}
+	}
+
+	pluginObjects_.Clear();
+	initOrder_.Clear();
+	initLevels_.Clear();
+	UpdateFrameHooks();
+	UpdateRetired(true);
+
+	// Release libraries configured but never loaded
+	for (PluginLoadTask& task : configuredTasks_)
+	{
+		if (!task.resolved_)
+			continue;
+
+		logWriter_->CloseChannel(task.pluginObject_.runtime_->logChannel_);
+		ReleaseMemory(task.pluginObject_.runtime_);
+		SDL_UnloadObject(task.pluginObject_.handle_);
+	}
+
+	configuredTasks_.Clear();
+}
+
+bool Plugin::LoadHosted(const String& name, bool forceToStart)
+{
+	if (IsHosted(name))
+		return true;
+
+	SharedPtr<PluginHostConnection> host(new PluginHostConnection(context_, name));
+	host->SetDeadline(hostDeadline_);
+	if (!host->Launch() || (forceToStart && !host->Start()))
+		return false;
+
+	hosts_.Push(host);
+	return true;
+}
+
+bool Plugin::IsHosted(const String& name) const
+{
+	// Matched on the filename, as the other plugins
+	const String filename = GetFileName(name);
+	for (const SharedPtr<PluginHostConnection>& host : hosts_)
+	{
+		if (GetFileName(host->GetName()) == filename)
+			return true;
+	}
+
+	return false;
+}
+
+void Plugin::SetHostDeadline(float deadline)
+{
+	hostDeadline_ = (long long)(Max(deadline, 0.0f) * 1000.0f);
+	for (SharedPtr<PluginHostConnection>& host : hosts_)
+		host->SetDeadline(hostDeadline_);
+}
+
+bool Plugin::IsLoaded(const String& name) const
+{
+	return registry_.Contains(StringHash(GetFileName(name)));
+}
+
+void Plugin::Setup(VariantMap& parameters)
+{
+	RunInitLevels(SECTION_SETUP, &parameters);
+
+	// Hosts launched before the engine initialization set up their plugin meanwhile
+	for (unsigned i = hosts_.Size() - 1; i < hosts_.Size(); --i)
+	{
+		if (!hosts_[i]->WaitReady())
+			hosts_.Erase(i);
+	}
+}
+
+void Plugin::Start()
+{
+	RunInitLevels(SECTION_START, nullptr);
+
+	for (unsigned i = hosts_.Size() - 1; i < hosts_.Size(); --i)
+	{
+		if (!hosts_[i]->Start())
+			hosts_.Erase(i);
+	}
+}
+
+void Plugin::Stop()
+{
+	for (SharedPtr<PluginHostConnection>& host : hosts_)
+		host->Stop();
+
+	// Stop dependents first
+	UpdateInitOrder();
+	for (unsigned i = initOrder_.Size() - 1; i < initOrder_.Size(); --i)
+	{
+		const PluginObject& pluginObject = pluginObjects_[initOrder_[i]];
+		PluginTimeScope scope(pluginObject.runtime_, SECTION_STOP);
+		pluginObject.descriptor_->Stop(pluginObject.instance_);
+	}
+}
+
+void Plugin::UpdateInitOrder()
+{
+	if (!initOrderDirty_)
+		return;
+
+	initOrderDirty_ = false;
+	initOrder_.Clear();
+	initLevels_.Clear();
+
+	// Count dependencies of each plugin on the loaded plugins
+	HashMap<String, unsigned> numDependencies;
+	HashMap<String, Vector<String> > dependents;
+	for (HashMap<String, PluginObject>::ConstIterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+	{
+		unsigned& count = numDependencies[i->first_];
+		for (const char* const* dependency = i->second_.descriptor_->dependencies_; dependency && *dependency; ++dependency)
+		{
+			const String filename = GetFileName(String(*dependency));
+			if (filename == i->first_)
+				continue;
+
+			if (!pluginObjects_.Contains(filename))
+			{
+				URHO3D_LOGWARNING("Plugin: \"" + i->first_ + "\" depends on \"" + filename + "\" which is not loaded");
+				continue;
+			}
+
+			++count;
+			dependents[filename].Push(i->first_);
+		}
+	}
+
+	// Topological sort by level, plugins of a level only depend on the previous levels
+	Vector<String> level;
+	for (HashMap<String, unsigned>::ConstIterator i = numDependencies.Begin(); i != numDependencies.End(); ++i)
+	{
+		if (!i->second_)
+			level.Push(i->first_);
+	}
+
+	while (!level.Empty())
+	{
+		// Sort by name to keep the order of a level deterministic
+		Sort(level.Begin(), level.End());
+		initLevels_.Push(initOrder_.Size());
+
+		Vector<String> nextLevel;
+		for (const String& filename : level)
+		{
+			initOrder_.Push(filename);
+
+			HashMap<String, Vector<String> >::ConstIterator i = dependents.Find(filename);
+			if (i == dependents.End())
+				continue;
+
+			for (const String& dependent : i->second_)
+			{
+				if (--numDependencies[dependent] == 0)
+					nextLevel.Push(dependent);
+			}
+		}
+
+		level = nextLevel;
+	}
+
+	// Plugins left are in a dependency cycle, run them one by one
+	if (initOrder_.Size() < pluginObjects_.Size())
+	{
+		for (HashMap<String, unsigned>::ConstIterator i = numDependencies.Begin(); i != numDependencies.End(); ++i)
+		{
+			if (!i->second_)
+				continue;
+
+			URHO3D_LOGERROR("Plugin: \"" + i->first_ + "\" is in a dependency cycle");
+			initLevels_.Push(initOrder_.Size());
+			initOrder_.Push(i->first_);
+		}
+	}
+
+	initLevels_.Push(initOrder_.Size());
+
+	UpdateFrameHooks();
+}
+
+void Plugin::RunInitLevels(StringHash section, VariantMap* parameters)
+{
+	UpdateInitOrder();
+
+	auto* queue = GetSubsystem<WorkQueue>();
+	const bool concurrent = queue && queue->GetNumThreads();
+
+	for (unsigned level = 0; level + 1 < initLevels_.Size(); ++level)
+	{
+		const unsigned begin = initLevels_[level];
+		const unsigned end = initLevels_[level + 1];
+
+		// Each plugin sets its own copy of the parameters given by the previous levels
+		Vector<PluginInitTask> tasks(end - begin);
+		for (unsigned i = begin; i < end; ++i)
+		{
+			PluginInitTask& task = tasks[i - begin];
+			task.pluginObject_ = &pluginObjects_[initOrder_[i]];
+			task.section_ = section;
+			if (parameters)
+				task.parameters_ = *parameters;
+		}
+
+		// Thread-safe plugins run on the worker threads while the others run here
+		PODVector<PluginInitTask*> mainThreadTasks;
+		unsigned numQueued = 0;
+		for (PluginInitTask& task : tasks)
+		{
+			if (concurrent && tasks.Size() > 1 && (task.pluginObject_->descriptor_->flags_ & PLUGIN_THREAD_SAFE_INIT))
+			{
+				SharedPtr<WorkItem> item = queue->GetFreeItem();
+				item->priority_ = M_MAX_UNSIGNED;
+				item->workFunction_ = InitTaskWork;
+				item->start_ = &task;
+				queue->AddWorkItem(item);
+				++numQueued;
+			}
+			else
+				mainThreadTasks.Push(&task);
+		}
+
+		for (PluginInitTask* task : mainThreadTasks)
+			RunInitTask(*task);
+		if (numQueued)
+			queue->Complete(M_MAX_UNSIGNED);
+
+		// Merge in the level order only the parameters each plugin changed, so a later plugin does not revert the
+		// changes of an earlier one with its untouched copy. Plugins of a level do not see each other's changes, two
+		// of them setting the same parameter differently is reported and the later one wins.
+		if (parameters)
+		{
+			const VariantMap levelParameters = *parameters;
+			HashMap<StringHash, const PluginInitTask*> writers;
+			for (const PluginInitTask& task : tasks)
+			{
+				for (VariantMap::ConstIterator i = task.parameters_.Begin(); i != task.parameters_.End(); ++i)
+				{
+					VariantMap::ConstIterator input = levelParameters.Find(i->first_);
+					if (input != levelParameters.End() && input->second_ == i->second_)
+						continue;
+
+					HashMap<StringHash, const PluginInitTask*>::ConstIterator writer = writers.Find(i->first_);
+					if (writer != writers.End() && (*parameters)[i->first_] != i->second_)
+					{
+						const String& name = task.pluginObject_->runtime_->GetName();
+						URHO3D_LOGWARNINGF("Plugins \"%s\" and \"%s\" set engine parameter %s differently, keeping \"%s\"",
+							writer->second_->pluginObject_->runtime_->GetName().CString(), name.CString(),
+							i->first_.ToString().CString(), name.CString());
+					}
+
+					(*parameters)[i->first_] = i->second_;
+					writers[i->first_] = &task;
+				}
+
+				// Parameters removed by the plugin
+				for (VariantMap::ConstIterator i = levelParameters.Begin(); i != levelParameters.End(); ++i)
+				{
+					if (!task.parameters_.Contains(i->first_))
+						parameters->Erase(i->first_);
+				}
+			}
+		}
+	}
+}
+
+void Plugin::RunInitTask(PluginInitTask& task)
+{
+	PluginObject& pluginObject = *task.pluginObject_;
+	StartupTraceScope traceScope(task.section_ == SECTION_SETUP ? "Setup" : "Start", pluginObject.runtime_->GetName());
+	PluginTimeScope scope(pluginObject.runtime_, task.section_);
+
+	if (task.section_ == SECTION_SETUP)
+		pluginObject.descriptor_->Setup(pluginObject.instance_, task.parameters_);
+	else
+		pluginObject.descriptor_->Start(pluginObject.instance_);
+}
+
+void Plugin::InitTaskWork(const WorkItem* item, unsigned threadIndex)
+{
+	RunInitTask(*reinterpret_cast<PluginInitTask*>(item->start_));
+}
+
+bool Plugin::Empty() const
+{
+	return pluginObjects_.Empty();
+}
+
+void Plugin::OnScriptBinding(const String scriptTypeName, void* scriptContext)
+{
+	scriptBindings_.Push(MakePair(scriptTypeName, scriptContext));
+
+	UpdateInitOrder();
+	for (const String& filename : initOrder_)
+	{
+		const PluginObject& pluginObject = pluginObjects_[filename];
+		PluginTimeScope scope(pluginObject.runtime_, SECTION_SCRIPT_BINDING);
+		pluginObject.descriptor_->OnScriptBinding(pluginObject.instance_, scriptTypeName.CString(), scriptContext);
+	}
+}
+
+void Plugin::Register(const String& name)
+{
+	const String filename = GetFileName(name);
+	registeredPlugins_[filename] = name;
+}
+
+void Plugin::Register(const String& name, StringHash activationEvent)
+{
+	Register(name);
+
+	const String filename = GetFileName(name);
+	Vector<String>& filenames = activationEvents_[activationEvent];
+	if (!filenames.Contains(filename))
+		filenames.Push(filename);
+
+	SubscribeToEvent(activationEvent, URHO3D_HANDLER(Plugin, HandleActivationEvent));
+}
+
+bool Plugin::IsRegistered(const String& name) const
+{
+	return registeredPlugins_.Contains(GetFileName(name));
+}
+
+bool Plugin::Get(const String& name)
+{
+	const String filename = GetFileName(name);
+
+	if (IsLoaded(filename))
+		return true;
+
+	if (!registeredPlugins_.Contains(filename))
+	{
+		URHO3D_LOGDEBUG("Plugin: \"" + name + "\" is not registered");
+		return false;
+	}
+
+	return Activate(filename);
+}
+
+bool Plugin::Activate(const String& filename)
+{
+	if (activating_.Contains(filename))
+	{
+		URHO3D_LOGWARNING("Plugin: \"" + filename + "\" depends on itself through its dependencies");
+		return false;
+	}
+
+	PluginLoadTask task;
+	task.name_ = registeredPlugins_[filename];
+	task.filename_ = filename;
+	task.bundle_ = bundle_;
+	const String& name = task.name_;
+
+	// The library tells the dependencies, which are set up and started before the plugin is constructed
+	if (!ResolveLibrary(task))
+	{
+		Log::Write(task.errorLevel_, task.error_);
+		return false;
+	}
+
+	activating_.Push(filename);
+	const PluginDescriptor* descriptor = task.pluginObject_.descriptor_;
+	for (const char* const* dependency = descriptor->dependencies_; dependency && *dependency; ++dependency)
+	{
+		if (!Get(String(*dependency)))
+			URHO3D_LOGWARNING("Plugin: \"" + name + "\" depends on \"" + String(*dependency) + "\" which is not loaded");
+	}
+	activating_.Remove(filename);
+
+	// Loaded meanwhile by a dependency, release the library reference taken by the resolution
+	if (IsLoaded(StringHash(filename)))
+	{
+		SDL_UnloadObject(task.pluginObject_.handle_);
+		return true;
+	}
+
+	CreateApplication(task, false);
+	const PluginObject& pluginObject = pluginObjects_[filename];
+
+	// Gather the hooks of the plugin now rather than on the next hook call
+	UpdateInitOrder();
+
+	// Engine is already running, parameters can not be applied anymore
+	VariantMap parameters;
+	{
+		PluginTimeScope scope(pluginObject.runtime_, SECTION_SETUP);
+		descriptor->Setup(pluginObject.instance_, parameters);
+	}
+	if (!parameters.Empty())
+		URHO3D_LOGWARNING("Plugin: \"" + name + "\" activated on demand, engine parameters ignored");
+
+	{
+		PluginTimeScope scope(pluginObject.runtime_, SECTION_START);
+		descriptor->Start(pluginObject.instance_);
+	}
+
+	// Give the script bindings the plugin missed
+	PluginTimeScope scope(pluginObject.runtime_, SECTION_SCRIPT_BINDING);
+	for (const Pair<String, void*>& binding : scriptBindings_)
+		descriptor->OnScriptBinding(pluginObject.instance_, binding.first_.CString(), binding.second_);
+
+	URHO3D_LOGDEBUG("Plugin: \"" + name + "\" activated on demand");
+	return true;
+}
+
+void Plugin::HandleActivationEvent(StringHash eventType, VariantMap& eventData)
+{
+	HashMap<StringHash, Vector<String> >::Iterator i = activationEvents_.Find(eventType);
+	if (i == activationEvents_.End())
+		return;
+
+	// Activation is needed only once
+	const Vector<String> filenames = i->second_;
+	activationEvents_.Erase(i);
+	UnsubscribeFromEvent(eventType);
+
+	for (const String& filename : filenames)
+	{
+		if (!IsLoaded(filename))
+			Activate(filename);
+	}
+}
+
+void Plugin::SetHotReload(bool enable)
+{
+	if (enable == hotReload_)
+		return;
+
+	hotReload_ = enable;
+
+	if (enable)
+	{
+		// Library copies from a previous session are not used anymore
+		auto* fileSystem = GetSubsystem<FileSystem>();
+		shadowDir_ = fileSystem->GetAppPreferencesDir("urho3d", "pluginreload");
+		Vector<String> oldCopies;
+		fileSystem->ScanDir(oldCopies, shadowDir_, "*" + String(EXTENTION_PLUGIN_NAME), SCAN_FILES, false);
+		for (const String& oldCopy : oldCopies)
+			fileSystem->Delete(shadowDir_ + oldCopy);
+
+		for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+			WatchLibrary(i->second_);
+
+		SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Plugin, HandleBeginFrame));
+	}
+	else
+	{
+		if (asyncLoads_.Empty())
+			UnsubscribeFromEvent(E_BEGINFRAME);
+		libraryWatchers_.Clear();
+	}
+}
+
+void Plugin::WatchLibrary(const PluginObject& pluginObject)
+{
+	if (pluginObject.bundled_)
+	{
+		URHO3D_LOGDEBUG("Plugin library: \"" + pluginObject.path_ + "\" loaded from the bundle, not watched for hot reload");
+		return;
+	}
+
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	if (!fileSystem->FileExists(pluginObject.path_))
+	{
+		URHO3D_LOGWARNING("Plugin library: \"" + pluginObject.path_ + "\" not found on disk, can not watch for hot reload");
+		return;
+	}
+
+	const String path = IsAbsolutePath(pluginObject.path_) ? GetPath(pluginObject.path_) :
+		fileSystem->GetCurrentDir() + GetPath(pluginObject.path_);
+
+	if (libraryWatchers_.Contains(path))
+		return;
+
+	SharedPtr<FileWatcher> watcher(new FileWatcher(context_));
+	if (watcher->StartWatching(path, false))
+		libraryWatchers_[path] = watcher;
+}
+
+void Plugin::UpdateHotReload()
+{
+	// Start to reload rebuilt libraries
+	for (HashMap<String, SharedPtr<FileWatcher> >::Iterator i = libraryWatchers_.Begin(); i != libraryWatchers_.End(); ++i)
+	{
+		String change;
+		while (i->second_->GetNextChange(change))
+		{
+			if (GetExtension(change) != EXTENTION_PLUGIN_NAME)
+				continue;
+
+			const String filename = GetFileName(change);
+			if (!pluginObjects_.Contains(filename))
+				continue;
+
+			bool isReloading = false;
+			for (const SharedPtr<PluginReload>& reload : reloads_)
+				isReloading |= reload->task_.filename_ == filename;
+
+			// Rebuilt again while the previous build is copied, reloaded once it is swapped
+			if (isReloading)
+				pendingReloads_[filename] = i->first_ + change;
+			else
+				StartReload(filename, i->first_ + change);
+		}
+	}
+
+	// Swap resolved libraries on frame boundary
+	for (unsigned i = 0; i < reloads_.Size();)
+	{
+		if (reloads_[i]->item_->completed_)
+		{
+			const String filename = reloads_[i]->task_.filename_;
+			FinishReload(*reloads_[i]);
+			reloads_.Erase(i);
+
+			HashMap<String, String>::Iterator pending = pendingReloads_.Find(filename);
+			if (pending != pendingReloads_.End())
+			{
+				if (pluginObjects_.Contains(filename))
+					StartReload(filename, pending->second_);
+				pendingReloads_.Erase(pending);
+			}
+		}
+		else
+			++i;
+	}
+}
+
+void Plugin::FinishAsyncLoads()
+{
+	if (manualAsyncLoads_)
+		return;
+
+	for (unsigned i = 0; i < asyncLoads_.Size();)
+	{
+		if (asyncLoads_[i]->item_ && !asyncLoads_[i]->item_->completed_)
+		{
+			++i;
+			continue;
+		}
+
+		// Removed first, as event handlers may load more plugins
+		SharedPtr<PluginAsyncLoad> asyncLoad = asyncLoads_[i];
+		asyncLoads_.Erase(i);
+		FinishAsyncLoad(*asyncLoad);
+	}
+}
+
+bool Plugin::CompleteAsyncLoad(const String& name)
+{
+	const String filename = GetFileName(name);
+	for (unsigned i = 0; i < asyncLoads_.Size(); ++i)
+	{
+		if (asyncLoads_[i]->task_.filename_ != filename)
+			continue;
+
+		SharedPtr<PluginAsyncLoad> asyncLoad = asyncLoads_[i];
+		asyncLoads_.Erase(i);
+
+		// Wait for the resolution on the worker threads
+		if (asyncLoad->item_ && !asyncLoad->item_->completed_)
+			GetSubsystem<WorkQueue>()->Complete(0);
+
+		FinishAsyncLoad(*asyncLoad);
+		return true;
+	}
+
+	return false;
+}
+
+void Plugin::FinishAsyncLoad(PluginAsyncLoad& asyncLoad)
+{
+	PluginLoadTask& task = asyncLoad.task_;
+	PluginLoadHandle& handle = *asyncLoad.handle_;
+	if (IsLoaded(task.filename_))
+	{
+		// Loaded meanwhile, release the library reference taken by the resolution
+		if (task.resolved_)
+			SDL_UnloadObject(task.pluginObject_.handle_);
+		handle.succeeded_ = true;
+	}
+	else if (task.resolved_)
+	{
+		CreateApplication(task, asyncLoad.forceToStart_, PLUGIN_CHANGE_LOAD_ASYNC);
+		handle.succeeded_ = true;
+	}
+	else
+	{
+		Log::Write(task.errorLevel_, task.error_);
+		handle.error_ = task.error_;
+	}
+	handle.complete_ = true;
+
+	using namespace PluginLoaded;
+
+	VariantMap& eventData = GetEventDataMap();
+	eventData[P_NAME] = handle.name_;
+	eventData[P_SUCCESS] = handle.succeeded_;
+	SendEvent(E_PLUGINLOADED, eventData);
+}
+
+void Plugin::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+	if (hotReload_)
+		UpdateHotReload();
+	if (!asyncLoads_.Empty())
+		FinishAsyncLoads();
+	if (!retired_.Empty())
+		UpdateRetired(false);
+	if (!hotReload_ && asyncLoads_.Empty() && retired_.Empty())
+		UnsubscribeFromEvent(E_BEGINFRAME);
+}
+
+Plugin::PluginRetired& Plugin::Retire(const PluginObject& pluginObject, unsigned long long epoch, bool forceToStop)
+{
+	SharedPtr<PluginRetired> retired(new PluginRetired());
+	retired->pluginObject_ = pluginObject;
+	retired->epoch_ = epoch;
+	retired->logWriter_ = logWriter_;
+	retired->stop_ = forceToStop;
+	retired_.Push(retired);
+	return *retired;
+}
+
+void Plugin::UpdateRetired(bool wait)
+{
+	// Stop and destroy of a plugin may unload others. The hook calls in progress may still reach an unloaded
+	// plugin, it is destroyed once they are done.
+	if (updatingRetired_ || runningHooks_)
+		return;
+	updatingRetired_ = true;
+
+	if (wait)
+		PluginEpoch::Synchronize();
+
+	auto* queue = GetSubsystem<WorkQueue>();
+	for (unsigned i = 0; i < retired_.Size();)
+	{
+		PluginRetired& retired = *retired_[i];
+		PluginObject& pluginObject = retired.pluginObject_;
+
+		// Destroyed on the main thread, as the application unsubscribes from its events
+		if (!retired.destroyed_)
+		{
+			if (!wait && !PluginEpoch::IsReleased(retired.epoch_))
+			{
+				++i;
+				continue;
+			}
+
+			retired.destroyed_ = true;
+			if (retired.stop_)
+			{
+				PluginTimeScope scope(pluginObject.runtime_, SECTION_STOP);
+				pluginObject.descriptor_->Stop(pluginObject.instance_);
+			}
+			pluginObject.descriptor_->DestroyPluginApplication(pluginObject.instance_);
+			if (!retired.keepRuntime_)
+				ReleaseMemory(pluginObject.runtime_);
+		}
+
+		// Static destructors and unmapping of large libraries take milliseconds, keep them off the frame
+		if (!retired.item_)
+		{
+			if (queue && !wait)
+			{
+				// Not taken from the pool: pooled items are reset once completed, before the frames polling them
+				retired.item_ = new WorkItem();
+				retired.item_->priority_ = 0;
+				retired.item_->workFunction_ = CloseLibraryWork;
+				retired.item_->start_ = &retired;
+				queue->AddWorkItem(retired.item_);
+				++i;
+				continue;
+			}
+
+			CloseLibrary(retired);
+		}
+		else if (!retired.item_->completed_)
+		{
+			if (!wait)
+			{
+				++i;
+				continue;
+			}
+
+			if (queue)
+				queue->Complete(0);
+			else
+				CloseLibrary(retired);
+		}
+
+		if (!pluginObject.shadowPath_.Empty())
+			GetSubsystem<FileSystem>()->Delete(pluginObject.shadowPath_);
+		retired_.Erase(i);
+	}
+
+	updatingRetired_ = false;
+	if (!retired_.Empty())
+		SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Plugin, HandleBeginFrame));
+}
+
+void Plugin::CloseLibrary(PluginRetired& retired)
+{
+	// Pending messages reference format strings of the library
+	if (retired.keepRuntime_)
+		retired.logWriter_->Flush();
+	else
+		retired.logWriter_->CloseChannel(retired.pluginObject_.runtime_->logChannel_);
+
+	SDL_UnloadObject(retired.pluginObject_.handle_);
+}
+
+void Plugin::CloseLibraryWork(const WorkItem* item, unsigned threadIndex)
+{
+	CloseLibrary(*reinterpret_cast<PluginRetired*>(item->start_));
+}
+
+void Plugin::StartReload(const String& filename, const String& sourcePath)
+{
+	SharedPtr<PluginReload> reload(new PluginReload());
+	reload->sourcePath_ = sourcePath;
+	reload->task_.filename_ = filename;
+	reload->task_.name_ = shadowDir_ + filename + fileSuffix_ + "." + String(++reloadCount_) + EXTENTION_PLUGIN_NAME;
+
+	// Not taken from the pool: pooled items are reset once completed, before the frames polling them
+	auto* queue = GetSubsystem<WorkQueue>();
+	reload->item_ = new WorkItem();
+	reload->item_->priority_ = 0;
+	reload->item_->workFunction_ = ReloadLibraryWork;
+	reload->item_->start_ = reload.Get();
+	queue->AddWorkItem(reload->item_);
+
+	reloads_.Push(reload);
+}
+
+void Plugin::ReloadLibraryWork(const WorkItem* item, unsigned threadIndex)
+{
+	auto* reload = reinterpret_cast<PluginReload*>(item->start_);
+	PluginLoadTask& task = reload->task_;
+
+	// Load a copy, as the library loader would return the handle already open for the same path
+	SDL_RWops* source = SDL_RWFromFile(reload->sourcePath_.CString(), "rb");
+	SDL_RWops* dest = source ? SDL_RWFromFile(task.name_.CString(), "wb") : nullptr;
+	bool copied = source && dest;
+	if (copied)
+	{
+		char buffer[65536];
+		size_t size;
+		while ((size = SDL_RWread(source, buffer, 1, sizeof buffer)) > 0)
+		{
+			if (SDL_RWwrite(dest, buffer, 1, size) != size)
+			{
+				copied = false;
+				break;
+			}
+		}
+	}
+	if (dest)
+		SDL_RWclose(dest);
+	if (source)
+		SDL_RWclose(source);
+
+	if (!copied)
+	{
+		task.error_ = "Impossible to copy rebuilt plugin: \"" + reload->sourcePath_ + "\" for hot reload!";
+		task.errorLevel_ = LOG_ERROR;
+		task.resolved_ = false;
+		return;
+	}
+
+	task.resolved_ = ResolveLibrary(task);
+}
+
+void Plugin::FinishReload(PluginReload& reload)
+{
+	PluginLoadTask& task = reload.task_;
+	auto* fileSystem = GetSubsystem<FileSystem>();
+
+	HashMap<String, PluginObject>::Iterator i = pluginObjects_.Find(task.filename_);
+	if (!task.resolved_ || i == pluginObjects_.End())
+	{
+		if (!task.resolved_)
+			Log::Write(task.errorLevel_, task.error_);
+		else
+			SDL_UnloadObject(task.pluginObject_.handle_);
+
+		fileSystem->Delete(task.name_);
+		return;
+	}
+
+	PluginObject oldObject = i->second_;
+	PluginObject& newObject = task.pluginObject_;
+	newObject.path_ = oldObject.path_;
+	newObject.shadowPath_ = task.name_;
+	newObject.runtime_ = oldObject.runtime_;
+
+	// Hand over the state from the old plugin application to the new one. The plugin leaves the registry meanwhile,
+	// and its services are revoked until the new one publishes them again.
+	scheduler_->Join();
+	services_->Revoke(oldObject.runtime_);
+	registry_.Remove(StringHash(task.filename_));
+	PluginEpoch::Synchronize();
+
+	// Timed and credited to the plugin as the other entry points, the runtime is shared by both libraries
+	PluginRuntimeImpl* runtime = newObject.runtime_;
+	VectorBuffer state;
+	{
+		PluginTimeScope scope(runtime, SECTION_RELOAD);
+		oldObject.descriptor_->SaveState(oldObject.instance_, state);
+	}
+	{
+		PluginTimeScope scope(runtime, SECTION_STOP);
+		oldObject.descriptor_->Stop(oldObject.instance_);
+		oldObject.descriptor_->DestroyPluginApplication(oldObject.instance_);
+	}
+
+	runtime->SetBindFunction(newObject.descriptor_->BindRuntime);
+	{
+		PluginTimeScope scope(runtime, SECTION_CREATE);
+		newObject.instance_ = newObject.descriptor_->CreatePluginApplication(context_, runtime);
+	}
+	{
+		PluginTimeScope scope(runtime, SECTION_RELOAD);
+		state.Seek(0);
+		newObject.descriptor_->RestoreState(newObject.instance_, state);
+	}
+
+	VariantMap parameters;
+	{
+		PluginTimeScope scope(runtime, SECTION_SETUP);
+		newObject.descriptor_->Setup(newObject.instance_, parameters);
+	}
+	{
+		PluginTimeScope scope(runtime, SECTION_START);
+		newObject.descriptor_->Start(newObject.instance_);
+	}
+	{
+		PluginTimeScope scope(runtime, SECTION_SCRIPT_BINDING);
+		for (const Pair<String, void*>& binding : scriptBindings_)
+			newObject.descriptor_->OnScriptBinding(newObject.instance_, binding.first_.CString(), binding.second_);
+	}
+
+	i->second_ = newObject;
+	Publish(task.filename_, newObject);
+	initOrderDirty_ = true;
+	SubscribeFrameHooks(*newObject.descriptor_);
+
+	// The old library is closed in background, and its copy deleted once closed
+	PluginRetired& retired = Retire(oldObject, 0, false);
+	retired.destroyed_ = true;
+	retired.keepRuntime_ = true;
+	UpdateRetired(false);
+
+	URHO3D_LOGINFO("Plugin: \"" + task.filename_ + "\" hot reloaded");
+	SendChanged(task.filename_, PLUGIN_CHANGE_RELOAD);
+}
+
+void Plugin::Publish(const String& filename, const PluginObject& pluginObject)
+{
+	PluginRegistryEntry entry;
+	entry.name_ = filename;
+	entry.descriptor_ = pluginObject.descriptor_;
+	entry.instance_ = pluginObject.instance_;
+	entry.runtime_ = pluginObject.runtime_;
+	registry_.Set(StringHash(filename), entry);
+}
+
+void Plugin::CreateRuntime(PluginObject& pluginObject, const String& filename)
+{
+	pluginObject.runtime_ = new PluginRuntimeImpl(filename, scheduler_, logWriter_, blackboard_, services_);
+	pluginObject.runtime_->profiling_ = profiling_;
+
+	// Plugin log follows the settings of the main log
+	auto* log = GetSubsystem<Log>();
+	pluginObject.runtime_->logLevel_ = log ? log->GetLevel() : LOG_INFO;
+	pluginObject.runtime_->logChannel_ = logWriter_->OpenChannel(filename + fileSuffix_, log && log->IsQuiet());
+
+	PluginRuntimeImpl* runtime = pluginObject.runtime_;
+	runtime->SetSectionName(SECTION_CONFIGURE, "Configure");
+	runtime->SetSectionName(SECTION_CREATE, "Create");
+	runtime->SetSectionName(SECTION_SETUP, "Setup");
+	runtime->SetSectionName(SECTION_START, "Start");
+	runtime->SetSectionName(SECTION_STOP, "Stop");
+	runtime->SetSectionName(SECTION_RELOAD, "Reload");
+	runtime->SetSectionName(SECTION_SCRIPT_BINDING, "OnScriptBinding");
+	runtime->SetSectionName(E_BEGINFRAME, "E_BEGINFRAME");
+	runtime->SetSectionName(E_UPDATE, "E_UPDATE");
+	runtime->SetSectionName(E_POSTUPDATE, "E_POSTUPDATE");
+	runtime->SetSectionName(E_RENDERUPDATE, "E_RENDERUPDATE");
+	runtime->SetSectionName(E_POSTRENDERUPDATE, "E_POSTRENDERUPDATE");
+	runtime->SetSectionName(E_ENDFRAME, "E_ENDFRAME");
+	for (unsigned i = 0; i < MAX_PLUGIN_HOOKS; ++i)
+		runtime->SetSectionName(hookSections[i], hookSectionNames[i]);
+
+	runtime->SetBindFunction(pluginObject.descriptor_->BindRuntime);
+}
+
+void Plugin::SetLogLevel(int level)
+{
+	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+		i->second_.runtime_->logLevel_ = level;
+	for (PluginLoadTask& task : configuredTasks_)
+	{
+		if (task.pluginObject_.runtime_)
+			task.pluginObject_.runtime_->logLevel_ = level;
+	}
+}
+
+void Plugin::SetProfiling(bool enable)
+{
+	if (enable == profiling_)
+		return;
+
+	profiling_ = enable;
+
+	for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+		i->second_.runtime_->profiling_ = enable;
+	for (PluginLoadTask& task : configuredTasks_)
+	{
+		if (task.pluginObject_.runtime_)
+			task.pluginObject_.runtime_->profiling_ = enable;
+	}
+
+	// End frame is still needed by the end frame hooks, if there are some
+	if (enable)
+		SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Plugin, HandleEndFrame));
+	else if (frameHooks_[PLUGIN_HOOK_ENDFRAME].Empty() && !initOrderDirty_)
+		UnsubscribeFromEvent(E_ENDFRAME);
+}
+
+String Plugin::GetProfileReport(const String& name) const
+{
+	if (!name.Empty())
+	{
+		PluginRuntimeImpl* runtime = GetRuntime(name);
+		return runtime ? runtime->GetProfileReport() : String::EMPTY;
+	}
+
+	String report;
+	for (HashMap<String, PluginObject>::ConstIterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+		report += i->second_.runtime_->GetProfileReport();
+
+	return report;
+}
+
+long long Plugin::GetMemoryUse(const String& name) const
+{
+	PluginRuntimeImpl* runtime = GetRuntime(name);
+	return runtime ? runtime->GetMemoryUse() : 0;
+}
+
+long long Plugin::GetMemoryPeak(const String& name) const
+{
+	PluginRuntimeImpl* runtime = GetRuntime(name);
+	return runtime ? runtime->GetMemoryPeak() : 0;
+}
+
+String Plugin::GetMemoryReport() const
+{
+	String report = ToString("  %-24s %12s %12s\n", "Plugin", "Use KB", "Peak KB");
+	for (HashMap<String, PluginObject>::ConstIterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+	{
+		const PluginRuntimeImpl* runtime = i->second_.runtime_;
+		report += ToString("  %-24s %12.1f %12.1f\n", runtime->GetName().CString(), runtime->GetMemoryUse() / 1024.0,
+			runtime->GetMemoryPeak() / 1024.0);
+	}
+
+	return report;
+}
+
+void Plugin::ReleaseMemory(PluginRuntimeImpl* runtime)
+{
+	runtime->ReleaseArena();
+
+	// Static data of the library is still allocated at this point, anything else is a leak of the plugin
+	const long long memoryUse = runtime->GetMemoryUse();
+	if (PluginMemory::IsEnabled() && memoryUse > 0)
+		URHO3D_LOGWARNINGF("Plugin \"%s\" still holds %lld bytes after unloading", runtime->GetName().CString(), memoryUse);
+}
+
+PluginRuntimeImpl* Plugin::GetRuntime(const String& name) const
+{
+	HashMap<String, PluginObject>::ConstIterator i = pluginObjects_.Find(GetFileName(name));
+	return i != pluginObjects_.End() ? i->second_.runtime_.Get() : nullptr;
+}
+
+void Plugin::SubscribeFrameHooks(const PluginDescriptor& descriptor)
+{
+	if (descriptor.frameHooks_[PLUGIN_HOOK_UPDATE])
+		SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(Plugin, HandleUpdateHooks));
+	if (descriptor.frameHooks_[PLUGIN_HOOK_POSTUPDATE])
+		SubscribeToEvent(E_POSTUPDATE, URHO3D_HANDLER(Plugin, HandlePostUpdateHooks));
+	if (descriptor.frameHooks_[PLUGIN_HOOK_ENDFRAME])
+		SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Plugin, HandleEndFrame));
+}
+
+void Plugin::UpdateFrameHooks()
+{
+	// The hook lists are being iterated, gather once the calls are done
+	if (runningHooks_)
+	{
+		frameHooksDirty_ = true;
+		return;
+	}
+
+	frameHooksDirty_ = false;
+	for (unsigned i = 0; i < MAX_PLUGIN_HOOKS; ++i)
+		frameHooks_[i].Clear();
+
+	for (const String& filename : initOrder_)
+	{
+		const PluginObject& pluginObject = pluginObjects_[filename];
+		for (unsigned i = 0; i < MAX_PLUGIN_HOOKS; ++i)
+		{
+			if (!pluginObject.descriptor_->frameHooks_[i])
+				continue;
+
+			PluginFrameHook hook;
+			hook.function_ = pluginObject.descriptor_->frameHooks_[i];
+			hook.instance_ = pluginObject.instance_;
+			hook.runtime_ = pluginObject.runtime_;
+			hook.memoryTag_ = pluginObject.runtime_->GetMemoryTag();
+			frameHooks_[i].Push(hook);
+		}
+	}
+
+	// Frame events without hooks are not dispatched to the player anymore
+	if (frameHooks_[PLUGIN_HOOK_UPDATE].Empty())
+		UnsubscribeFromEvent(E_UPDATE);
+	if (frameHooks_[PLUGIN_HOOK_POSTUPDATE].Empty())
+		UnsubscribeFromEvent(E_POSTUPDATE);
+	if (frameHooks_[PLUGIN_HOOK_ENDFRAME].Empty() && !profiling_)
+		UnsubscribeFromEvent(E_ENDFRAME);
+}
+
+void Plugin::RunFrameHooks(PluginHook hook, float timeStep)
+{
+	UpdateInitOrder();
+
+	// Plugins loaded or unloaded by a hook, on demand included, are taken into account from the next call: the
+	// hook lists are gathered again once the calls in progress are done
+	const Vector<PluginFrameHook>& hooks = frameHooks_[hook];
+	++runningHooks_;
+	if (!profiling_)
+	{
+		for (unsigned i = 0; i < hooks.Size(); ++i)
+		{
+			if (!hooks[i].function_)
+				continue;
+
+			PluginMemoryScope memoryScope(hooks[i].memoryTag_);
+			hooks[i].function_(hooks[i].instance_, timeStep);
+		}
+	}
+	else
+	{
+		for (unsigned i = 0; i < hooks.Size(); ++i)
+		{
+			if (!hooks[i].function_)
+				continue;
+
+			PluginMemoryScope memoryScope(hooks[i].memoryTag_);
+			PluginTimeScope scope(hooks[i].runtime_, hookSections[hook]);
+			hooks[i].function_(hooks[i].instance_, timeStep);
+		}
+	}
+	--runningHooks_;
+
+	if (!runningHooks_ && frameHooksDirty_)
+		UpdateFrameHooks();
+	if (!runningHooks_ && !retired_.Empty())
+		UpdateRetired(false);
+}
+
+void Plugin::HandleUpdateHooks(StringHash eventType, VariantMap& eventData)
+{
+	using namespace Update;
+	RunFrameHooks(PLUGIN_HOOK_UPDATE, eventData[P_TIMESTEP].GetFloat());
+}
+
+void Plugin::HandlePostUpdateHooks(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PostUpdate;
+	RunFrameHooks(PLUGIN_HOOK_POSTUPDATE, eventData[P_TIMESTEP].GetFloat());
+}
+
+void Plugin::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+	RunFrameHooks(PLUGIN_HOOK_ENDFRAME, GetSubsystem<Time>()->GetTimeStep());
+
+	if (profiling_)
+	{
+		for (HashMap<String, PluginObject>::Iterator i = pluginObjects_.Begin(); i != pluginObjects_.End(); ++i)
+			i->second_.runtime_->EndFrame();
+	}
+}
@@ -1,85 +1,421 @@
-//
-// Copyright (c) 2008-2018 the Urho3DPlayer project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#pragma once
-
-#include <Urho3D/Core/Context.h>
-
-using namespace Urho3D;
-
-class Plugin : public Object
-{
-	URHO3D_OBJECT(Plugin, Object);
-
-	friend class Urho3DPlayer;
-	public:
-		/// Construct.
-		Plugin(Context* context);
-
-		~Plugin();
-
-		/// Load plugin return true if successfull. 
-		/// Usefull to force start if the plugin is loaded on the runtime.
-		bool Load(const String& name, bool forceToStart = false);
-		/// Unload plugin.
-		void Unload(const String& name, bool forceToStop = false);
-		/// Unload all plugins.
-		void UnloadAll();
-		/// Check if the plugin is loaded
-		bool IsLoaded(const String& name) const;
-		/// Verify if have plugin object
-		bool Empty() const;
-
-	protected:
-
-		class PluginObject
-		{
-		public:
-
-			const char* (*GetUrhoCompatibleVersion)();
-			const char* (*GetCompatibleCompilatorName)();
-			const char* (*GetCompatibleCompilatorVersion)();
-			const char* (*GetCompatibleOSVersion)();
-			const char* (*GetCompatibleGraphicAPI)();
-
-			void(*CreatePluginApplication)(Context*);
-			void(*DestroyPluginApplication)(Context*);
-
-			void(*Setup)(VariantMap& parameters);
-			void(*Start)();
-			void(*Stop)();
-			void(*OnScriptBinding)(const char*, void*);
-
-			void* handle_ = nullptr;
-		};
-
-		/// Setup all plugin application in same time of setup application (use on internal application only).
-		void Setup(VariantMap& parameters);
-		/// Start all plugin application in same time of start application (use on internal application only).
-		void Start();
-		/// Stop all plugin application in same time of stop application (use on internal application only).
-		void Stop();
-		/// Call on script binding and send scriptContext. Use to extend script binding in the plugin. 
-		void OnScriptBinding(const String scriptTypeName, void* scriptContext);
-
-		HashMap<String, PluginObject> pluginObjects_;
+//
+// Copyright (c) 2008-2018 the Urho3DPlayer project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/FileWatcher.h>
+#include <Urho3D/IO/Log.h>
+
+#include "Bundle.h"
+#include "PluginEpoch.h"
+#include "PluginEvents.h"
+#include "PluginHostConnection.h"
+#include "PluginRegistry.h"
+#include "PluginRuntimeImpl.h"
+
+using namespace Urho3D;
+
+/// Progress of a plugin loaded in background by Plugin::LoadAsync.
+class PluginLoadHandle : public RefCounted
+{
+	friend class Plugin;
+
+public:
+	/// Construct.
+	explicit PluginLoadHandle(const String& name) :
+		name_(name)
+	{
+	}
+
+	/// Return plugin name as requested.
+	const String& GetName() const { return name_; }
+	/// Return whether loading is complete, successfully or not.
+	bool IsComplete() const { return complete_; }
+	/// Return whether the plugin is loaded.
+	bool IsSucceeded() const { return succeeded_; }
+	/// Return error message if loading failed.
+	const String& GetError() const { return error_; }
+
+private:
+	/// Plugin name as requested.
+	String name_;
+	/// Error message.
+	String error_;
+	/// Completion flag.
+	bool complete_ = false;
+	/// Success flag.
+	bool succeeded_ = false;
+};
+
+class Plugin : public Object
+{
+	URHO3D_OBJECT(Plugin, Object);
+
+	friend class Urho3DPlayer;
+	friend class PluginBenchmark;
+	friend class PluginHost;
+	public:
+		/// Construct.
+		Plugin(Context* context);
+
+		~Plugin();
+
+		/// Load plugin return true if successfull. 
+		/// Usefull to force start if the plugin is loaded on the runtime.
+		bool Load(const String& name, bool forceToStart = false);
+		/// Load plugin in background and return its progress. The library is opened and checked on a worker thread,
+		/// then the plugin application is constructed and started on the main thread at the beginning of a frame,
+		/// and E_PLUGINLOADED is sent.
+		SharedPtr<PluginLoadHandle> LoadAsync(const String& name, bool forceToStart = true);
+		/// Resolve a group of plugins before the engine is initialized and let them adjust the engine parameters.
+		/// Return the number configured. The plugins are constructed later by LoadAll, without opening the libraries again.
+		unsigned Configure(const Vector<String>& names, VariantMap& parameters);
+		/// Load a group of plugins and return the number successfully loaded.
+		/// Libraries are opened and checked concurrently on the worker threads, then plugin applications
+		/// are constructed on the calling thread in the given order.
+		unsigned LoadAll(const Vector<String>& names, bool forceToStart = false);
+		/// Unload plugin. It is detached at once, its application is destroyed as soon as no other thread reads its
+		/// registry entry, and its library is closed in background.
+		void Unload(const String& name, bool forceToStop = false);
+		/// Unload all plugins and wait for their libraries to be closed.
+		void UnloadAll();
+		/// Check if the plugin is loaded. Safe to call from any thread.
+		bool IsLoaded(const String& name) const;
+		/// Check if the plugin is loaded from the hash of its filename, without path nor extension. Wait-free, safe to
+		/// call from any thread.
+		bool IsLoaded(StringHash filename) const { return registry_.Contains(filename); }
+		/// Return registry of the loaded plugins, to find their entry points from any thread.
+		const PluginRegistry& GetRegistry() const { return registry_; }
+		/// Verify if have plugin object
+		bool Empty() const;
+		/// Register plugin to load on demand. The library is not opened until the plugin is requested.
+		void Register(const String& name);
+		/// Register plugin to load on demand and activate it when the event is sent.
+		void Register(const String& name, StringHash activationEvent);
+		/// Load plugin in a PluginHost process, isolated from the main loop. The host sets it up at once, and starts
+		/// and stops it with the player. Return true if the host was launched.
+		bool LoadHosted(const String& name, bool forceToStart = false);
+		/// Check if the plugin runs in a PluginHost process.
+		bool IsHosted(const String& name) const;
+		/// Set longest wait for the frame of a plugin host in milliseconds, counted from the start of the frame.
+		void SetHostDeadline(float deadline);
+		/// Return longest wait for the frame of a plugin host in milliseconds.
+		float GetHostDeadline() const { return hostDeadline_ / 1000.0f; }
+		/// Check if the plugin is registered to load on demand.
+		bool IsRegistered(const String& name) const;
+		/// Return true if the plugin is loaded, activating it first if registered to load on demand.
+		bool Get(const String& name);
+		/// Let the caller decide when background loads complete with CompleteAsyncLoad, instead of the first frame their
+		/// library is ready. Used by replays to complete them on the recorded frame.
+		void SetManualAsyncLoads(bool enable) { manualAsyncLoads_ = enable; }
+		/// Complete background load of a plugin now, waiting for its library if needed. Return false if the plugin is
+		/// not loading.
+		bool CompleteAsyncLoad(const String& name);
+		/// Enable or disable hot reload of rebuilt plugin libraries.
+		void SetHotReload(bool enable);
+		/// Return whether hot reload is enabled.
+		bool GetHotReload() const { return hotReload_; }
+		/// Enable or disable per-plugin time accounting.
+		void SetProfiling(bool enable);
+		/// Return whether per-plugin time accounting is enabled.
+		bool GetProfiling() const { return profiling_; }
+		/// Set minimum level of plugin log messages, follows the main log by default.
+		void SetLogLevel(int level);
+		/// Return time accounting of the plugin, or of all plugins if name is empty.
+		String GetProfileReport(const String& name = String::EMPTY) const;
+		/// Return bytes allocated by the plugin and not freed yet.
+		long long GetMemoryUse(const String& name) const;
+		/// Return highest bytes allocated by the plugin at once.
+		long long GetMemoryPeak(const String& name) const;
+		/// Return memory accounting of all plugins as text.
+		String GetMemoryReport() const;
+		/// Return runtime of the plugin or null if not loaded.
+		PluginRuntimeImpl* GetRuntime(const String& name) const;
+		/// Return scheduler running the plugin tasks.
+		PluginScheduler* GetScheduler() const { return scheduler_; }
+		/// Set deployment bundle to load the plugin libraries from before the disk.
+		void SetBundle(Bundle* bundle) { bundle_ = bundle; }
+		/// Return deployment bundle.
+		Bundle* GetBundle() const { return bundle_; }
+		/// Set suffix of the plugin log files and library copies, to tell apart the players running in the same process.
+		void SetFileSuffix(const String& suffix) { fileSuffix_ = suffix; }
+		/// Return writer of the plugin logs.
+		PluginLogWriter* GetLogWriter() const { return logWriter_; }
+		/// Return blackboard shared by the plugins.
+		PluginBlackboard* GetBlackboard() const { return blackboard_; }
+		/// Return services published between plugins.
+		PluginServices* GetServices() const { return services_; }
+
+	protected:
+
+		class PluginObject
+		{
+		public:
+
+			/// Entry points table of the plugin.
+			const PluginDescriptor* descriptor_ = nullptr;
+			/// Plugin application created on this Context, null until constructed.
+			void* instance_ = nullptr;
+
+			void* handle_ = nullptr;
+			/// Library path as built.
+			String path_;
+			/// Library copy actually loaded after a hot reload.
+			String shadowPath_;
+			/// Flag whether the library was loaded from the deployment bundle.
+			bool bundled_ = false;
+			/// Runtime given to the plugin.
+			SharedPtr<PluginRuntimeImpl> runtime_;
+		};
+
+		/// Pending library resolution, filled on a worker thread by LoadAll.
+		struct PluginLoadTask
+		{
+			/// Name as requested.
+			String name_;
+			/// Registered filename.
+			String filename_;
+			/// Deployment bundle to look for the library first, or null.
+			Bundle* bundle_ = nullptr;
+			/// Resolved library.
+			PluginObject pluginObject_;
+			/// Error message if resolution failed.
+			String error_;
+			/// Log level of the error message.
+			int errorLevel_ = LOG_ERROR;
+			/// Resolution result.
+			bool resolved_ = false;
+		};
+
+		/// Pending hot reload, the rebuilt library is copied and resolved on a worker thread.
+		struct PluginReload : public RefCounted
+		{
+			/// Library path as built.
+			String sourcePath_;
+			/// Resolution of the copied library.
+			PluginLoadTask task_;
+			/// Work item doing the copy and the resolution.
+			SharedPtr<WorkItem> item_;
+		};
+
+		/// Plugin loading in background.
+		struct PluginAsyncLoad : public RefCounted
+		{
+			/// Progress given to the caller.
+			SharedPtr<PluginLoadHandle> handle_;
+			/// Resolution of the library.
+			PluginLoadTask task_;
+			/// Work item doing the resolution, null if the plugin was loaded already.
+			SharedPtr<WorkItem> item_;
+			/// Flag whether to start the plugin once constructed.
+			bool forceToStart_ = true;
+		};
+
+		/// Unloaded plugin waiting for its application to be destroyed and its library to be closed.
+		struct PluginRetired : public RefCounted
+		{
+			/// Unloaded plugin.
+			PluginObject pluginObject_;
+			/// Epoch whose readers may still see the plugin in the registry.
+			unsigned long long epoch_ = 0;
+			/// Writer of the plugin log.
+			PluginLogWriter* logWriter_ = nullptr;
+			/// Work item closing the library, null until the application is destroyed.
+			SharedPtr<WorkItem> item_;
+			/// Flag whether to stop the plugin application before destroying it.
+			bool stop_ = false;
+			/// Flag whether the plugin application is destroyed.
+			bool destroyed_ = false;
+			/// Flag whether the runtime is handed over to a rebuilt library. Its log channel is flushed, not closed.
+			bool keepRuntime_ = false;
+		};
+
+		/// Per-frame hook of one plugin, called directly by the player.
+		struct PluginFrameHook
+		{
+			/// Hook function of the plugin, null if the plugin was unloaded during the hook calls in progress.
+			PluginFrameFunction function_;
+			/// Plugin application the hook is called on.
+			void* instance_;
+			/// Runtime of the plugin, to account the time spent in the hook.
+			SharedPtr<PluginRuntimeImpl> runtime_;
+			/// Memory tag of the plugin, to credit the allocations of the hook.
+			unsigned memoryTag_;
+		};
+
+		/// Pending Setup or Start of one plugin, run on a worker thread when the plugin is thread-safe.
+		struct PluginInitTask
+		{
+			/// Plugin to set up or start.
+			PluginObject* pluginObject_ = nullptr;
+			/// Entry point to run, SECTION_SETUP or SECTION_START.
+			StringHash section_;
+			/// Engine parameters given to Setup.
+			VariantMap parameters_;
+		};
+
+		/// Create load tasks for the libraries not loaded yet, taking over the ones resolved by Configure.
+		void PrepareLoadTasks(const Vector<String>& names, Vector<PluginLoadTask>& tasks);
+		/// Resolve load tasks, concurrently on the worker threads if there are some and threads are allowed.
+		void ResolveLoadTasks(Vector<PluginLoadTask>& tasks, bool workerThreads = true);
+		/// Open library and check compatibility without touching the engine. Safe to call from worker thread.
+		static bool ResolveLibrary(PluginLoadTask& task);
+		/// Work item function to resolve library on worker thread.
+		static void ResolveLibraryWork(const WorkItem* item, unsigned threadIndex);
+		/// Construct plugin application from resolved library, register it and send E_PLUGINCHANGED.
+		void CreateApplication(PluginLoadTask& task, bool forceToStart, PluginChange change = PLUGIN_CHANGE_LOAD);
+		/// Send E_PLUGINCHANGED.
+		void SendChanged(const String& filename, PluginChange change);
+		/// Work item function to copy and resolve rebuilt library on worker thread.
+		static void ReloadLibraryWork(const WorkItem* item, unsigned threadIndex);
+		/// Watch the directory of the plugin library for hot reload.
+		void WatchLibrary(const PluginObject& pluginObject);
+		/// Start to copy and resolve rebuilt library in background.
+		void StartReload(const String& filename, const String& sourcePath);
+		/// Swap plugin application with the one from the rebuilt library, handing over its state.
+		void FinishReload(PluginReload& reload);
+		/// Detect rebuilt libraries and swap them on frame boundary.
+		void UpdateHotReload();
+		/// Construct the plugins loaded in background, and send E_PLUGINLOADED.
+		void FinishAsyncLoads();
+		/// Construct a plugin loaded in background, and send E_PLUGINLOADED.
+		void FinishAsyncLoad(PluginAsyncLoad& asyncLoad);
+		/// Add unloaded plugin, already detached from the registry, the services and the tasks, to the retired ones.
+		PluginRetired& Retire(const PluginObject& pluginObject, unsigned long long epoch, bool forceToStop);
+		/// Destroy the retired plugin applications no reader can see anymore, and close their libraries in
+		/// background. Wait for all readers and libraries if requested.
+		void UpdateRetired(bool wait);
+		/// Close library of a retired plugin, after writing its pending log messages.
+		static void CloseLibrary(PluginRetired& retired);
+		/// Work item function to close library of a retired plugin on a worker thread.
+		static void CloseLibraryWork(const WorkItem* item, unsigned threadIndex);
+		/// Handle begin frame to update hot reload, background loads and retired plugins.
+		void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+		/// Free the arena of an unloaded plugin and report the memory it still holds.
+		void ReleaseMemory(PluginRuntimeImpl* runtime);
+		/// Subscribe to the frame events of the hooks overridden by a plugin. Hooks are gathered on the next event.
+		void SubscribeFrameHooks(const PluginDescriptor& descriptor);
+		/// Gather the per-frame hooks of the loaded plugins in dependency order, and unsubscribe from the frame
+		/// events without hooks.
+		void UpdateFrameHooks();
+		/// Call a per-frame hook of all the plugins overriding it.
+		void RunFrameHooks(PluginHook hook, float timeStep);
+		/// Handle update to call the update hooks.
+		void HandleUpdateHooks(StringHash eventType, VariantMap& eventData);
+		/// Handle post update to call the post update hooks.
+		void HandlePostUpdateHooks(StringHash eventType, VariantMap& eventData);
+		/// Handle end frame to call the end frame hooks and close the profiling frame of the plugins.
+		void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+		/// Publish loaded plugin in the registry read by any thread.
+		void Publish(const String& filename, const PluginObject& pluginObject);
+		/// Create the runtime given to the plugin.
+		void CreateRuntime(PluginObject& pluginObject, const String& filename);
+		/// Sort loaded plugins by dependency level and gather their per-frame hooks if they changed.
+		void UpdateInitOrder();
+		/// Run Setup or Start of all plugins level by level, thread-safe plugins of a level concurrently.
+		void RunInitLevels(StringHash section, VariantMap* parameters);
+		/// Run Setup or Start of one plugin.
+		static void RunInitTask(PluginInitTask& task);
+		/// Work item function to run Setup or Start on worker thread.
+		static void InitTaskWork(const WorkItem* item, unsigned threadIndex);
+
+		/// Setup all plugin application in same time of setup application (use on internal application only).
+		void Setup(VariantMap& parameters);
+		/// Start all plugin application in same time of start application (use on internal application only).
+		void Start();
+		/// Stop all plugin application in same time of stop application (use on internal application only).
+		void Stop();
+		/// Call on script binding and send scriptContext. Use to extend script binding in the plugin. 
+		void OnScriptBinding(const String scriptTypeName, void* scriptContext);
+
+		/// Load, setup and start plugin registered to load on demand.
+		bool Activate(const String& filename);
+		/// Handle event activating plugins registered to load on demand.
+		void HandleActivationEvent(StringHash eventType, VariantMap& eventData);
+
+		/// Loaded plugins by filename, owned and modified by the main thread.
+		HashMap<String, PluginObject> pluginObjects_;
+		/// Loaded plugins by filename hash, read by any thread.
+		PluginRegistry registry_;
+		/// Libraries resolved and configured before the engine initialization, waiting for LoadAll.
+		Vector<PluginLoadTask> configuredTasks_;
+		/// Filenames of the loaded plugins, dependencies first.
+		Vector<String> initOrder_;
+		/// Start index of each dependency level in initOrder_, plus the end.
+		PODVector<unsigned> initLevels_;
+		/// Per-frame hooks by PluginHook, in dependency order.
+		Vector<PluginFrameHook> frameHooks_[MAX_PLUGIN_HOOKS];
+		/// Depth of the hook calls in progress. The hooks are not gathered again meanwhile.
+		unsigned runningHooks_ = 0;
+		/// Flag to gather the hooks again once the hook calls in progress are done.
+		bool frameHooksDirty_ = false;
+		/// Flag to sort plugins again before the next Setup, Start or Stop.
+		bool initOrderDirty_ = false;
+		/// Plugins registered to load on demand, name by filename.
+		HashMap<String, String> registeredPlugins_;
+		/// Plugins being activated on demand, to detect dependency cycles.
+		Vector<String> activating_;
+		/// Plugins to activate by event.
+		HashMap<StringHash, Vector<String> > activationEvents_;
+		/// Script bindings sent so far, replayed to plugins activated afterward.
+		Vector<Pair<String, void*> > scriptBindings_;
+		/// Hot reload flag.
+		bool hotReload_ = false;
+		/// Library directory watchers by directory.
+		HashMap<String, SharedPtr<FileWatcher> > libraryWatchers_;
+		/// Hot reloads in progress.
+		Vector<SharedPtr<PluginReload> > reloads_;
+		/// Libraries rebuilt again during their hot reload, path as built by filename.
+		HashMap<String, String> pendingReloads_;
+		/// Background loads in progress.
+		Vector<SharedPtr<PluginAsyncLoad> > asyncLoads_;
+		/// Flag whether background loads complete only through CompleteAsyncLoad.
+		bool manualAsyncLoads_ = false;
+		/// Unloaded plugins whose library is not closed yet, in unload order.
+		Vector<SharedPtr<PluginRetired> > retired_;
+		/// Flag whether the retired plugins are being updated. Plugins unloaded meanwhile are handled in the same pass.
+		bool updatingRetired_ = false;
+		/// Directory of the library copies loaded by hot reload.
+		String shadowDir_;
+		/// Counter to give library copies unique names.
+		unsigned reloadCount_ = 0;
+		/// Suffix of the plugin log files and library copies.
+		String fileSuffix_;
+		/// Profiling flag.
+		bool profiling_ = false;
+		/// Scheduler running the plugin tasks.
+		SharedPtr<PluginScheduler> scheduler_;
+		/// Background writer of the plugin logs.
+		SharedPtr<PluginLogWriter> logWriter_;
+		/// Blackboard shared by the plugins, outlives them.
+		SharedPtr<PluginBlackboard> blackboard_;
+		/// Services published between plugins, outlive them.
+		SharedPtr<PluginServices> services_;
+		/// Deployment bundle.
+		SharedPtr<Bundle> bundle_;
+		/// Plugins running in a PluginHost process.
+		Vector<SharedPtr<PluginHostConnection> > hosts_;
+		/// Longest wait for the frame of a plugin host in microseconds.
+		long long hostDeadline_ = 1000;
 };
\ No newline at end of file
@@ -1,41 +1,73 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#include "../AngelScript/APITemplates.h"
-#include "../Core/Context.h"
-
-#include "Plugin.h"
-#include "PluginAPI.h"
-
-void RegisterPlugin(Context* context, asIScriptEngine* engine)
-{
-	RegisterObject<Plugin>(engine, "Plugin");
-	engine->RegisterObjectMethod("Plugin", "bool Load(const String& name, bool forceToStart = true)", asMETHOD(Plugin, Load), asCALL_THISCALL);
-	engine->RegisterObjectMethod("Plugin", "void Unload(const String& name, bool forceToStop = true)", asMETHOD(Plugin, Unload), asCALL_THISCALL);
-	engine->RegisterObjectMethod("Plugin", "void UnloadAll()", asMETHOD(Plugin, UnloadAll), asCALL_THISCALL);
-	engine->RegisterObjectMethod("Plugin", "bool IsLoaded(const String& name)", asMETHOD(Plugin, IsLoaded), asCALL_THISCALL);
-	engine->RegisterObjectMethod("Plugin", "bool get_empty()", asMETHOD(Plugin, Empty), asCALL_THISCALL);
-
-	static Context* staticContext = context;
-	engine->RegisterGlobalFunction("Plugin@+ get_plugin()", asFUNCTIONPR([]() {
-		return staticContext->GetSubsystem<Plugin>(); }, (), Plugin*), asCALL_CDECL);
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../AngelScript/APITemplates.h"
+#include "../AngelScript/ScriptInstance.h"
+#include "../Core/Context.h"
+
+#include "Plugin.h"
+#include "PluginAPI.h"
+
+static Plugin* GetScriptPlugin()
+{
+	// Each player Context has its own script engine, the plugin subsystem is the one of the calling script
+	Context* context = GetScriptContext();
+	return context ? context->GetSubsystem<Plugin>() : nullptr;
+}
+
+static PluginLoadHandle* PluginLoadAsync(const String& name, bool forceToStart, Plugin* ptr)
+{
+	// The plugin keeps a reference until E_PLUGINLOADED is sent
+	return ptr->LoadAsync(name, forceToStart).Get();
+}
+
+void RegisterPlugin(Context* context, asIScriptEngine* engine)
+{
+	RegisterRefCounted<PluginLoadHandle>(engine, "PluginLoadHandle");
+	engine->RegisterObjectMethod("PluginLoadHandle", "const String& get_name() const", asMETHOD(PluginLoadHandle, GetName), asCALL_THISCALL);
+	engine->RegisterObjectMethod("PluginLoadHandle", "bool get_complete() const", asMETHOD(PluginLoadHandle, IsComplete), asCALL_THISCALL);
+	engine->RegisterObjectMethod("PluginLoadHandle", "bool get_succeeded() const", asMETHOD(PluginLoadHandle, IsSucceeded), asCALL_THISCALL);
+	engine->RegisterObjectMethod("PluginLoadHandle", "const String& get_error() const", asMETHOD(PluginLoadHandle, GetError), asCALL_THISCALL);
+
+	RegisterObject<Plugin>(engine, "Plugin");
+	engine->RegisterObjectMethod("Plugin", "bool Load(const String& name, bool forceToStart = true)", asMETHOD(Plugin, Load), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "PluginLoadHandle@+ LoadAsync(const String& name, bool forceToStart = true)", asFUNCTION(PluginLoadAsync), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod("Plugin", "void Unload(const String& name, bool forceToStop = true)", asMETHOD(Plugin, Unload), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "void UnloadAll()", asMETHOD(Plugin, UnloadAll), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool IsLoaded(const String& name)", asMETHODPR(Plugin, IsLoaded, (const String&) const, bool), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool get_empty()", asMETHOD(Plugin, Empty), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool LoadHosted(const String& name, bool forceToStart = true)", asMETHOD(Plugin, LoadHosted), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool IsHosted(const String& name) const", asMETHOD(Plugin, IsHosted), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "void set_hostDeadline(float)", asMETHOD(Plugin, SetHostDeadline), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "float get_hostDeadline() const", asMETHOD(Plugin, GetHostDeadline), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "void Register(const String& name)", asMETHODPR(Plugin, Register, (const String&), void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool IsRegistered(const String& name)", asMETHOD(Plugin, IsRegistered), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool Get(const String& name)", asMETHOD(Plugin, Get), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "void set_profiling(bool)", asMETHOD(Plugin, SetProfiling), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "bool get_profiling() const", asMETHOD(Plugin, GetProfiling), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "String GetProfileReport(const String& name = String()) const", asMETHOD(Plugin, GetProfileReport), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "int64 GetMemoryUse(const String&in) const", asMETHOD(Plugin, GetMemoryUse), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "int64 GetMemoryPeak(const String&in) const", asMETHOD(Plugin, GetMemoryPeak), asCALL_THISCALL);
+	engine->RegisterObjectMethod("Plugin", "String GetMemoryReport() const", asMETHOD(Plugin, GetMemoryReport), asCALL_THISCALL);
+
+	engine->RegisterGlobalFunction("Plugin@+ get_plugin()", asFUNCTION(GetScriptPlugin), asCALL_CDECL);
 }
\ No newline at end of file
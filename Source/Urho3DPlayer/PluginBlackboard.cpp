@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include "PluginBlackboard.h"
+#include "PluginMemory.h"
+
+/// Alignment of the rings, to keep their producer and consumer positions on separate cache lines.
+static const unsigned RING_ALIGNMENT = 64;
+
+PluginBlackboard::PluginBlackboard(Context* context) :
+	Object(context),
+	memoryUse_(0)
+{
+}
+
+PluginBlackboard::~PluginBlackboard()
+{
+	for (HashMap<String, Entry>::Iterator i = entries_.Begin(); i != entries_.End(); ++i)
+	{
+		if (i->second_.ring_)
+			i->second_.ring_->~PluginRing();
+		delete[] i->second_.allocation_;
+	}
+}
+
+void* PluginBlackboard::AcquireSlot(const String& name, unsigned size, unsigned alignment)
+{
+	if (!size || !alignment || !IsPowerOfTwo(alignment))
+	{
+		URHO3D_LOGERROR("Blackboard slot \"" + name + "\" requested with invalid size or alignment");
+		return nullptr;
+	}
+
+	MutexLock lock(mutex_);
+
+	HashMap<String, Entry>::Iterator i = entries_.Find(name);
+	if (i != entries_.End())
+	{
+		const Entry& entry = i->second_;
+		if (entry.ring_ || entry.size_ != size || entry.alignment_ != alignment)
+		{
+			URHO3D_LOGERRORF("Blackboard slot \"%s\" requested with size %u and alignment %u, it exists with another layout",
+				name.CString(), size, alignment);
+			return nullptr;
+		}
+		return entry.memory_;
+	}
+
+	Entry& entry = entries_[name];
+	Allocate(entry, size, alignment);
+	entry.size_ = size;
+	entry.alignment_ = alignment;
+	return entry.memory_;
+}
+
+PluginRing* PluginBlackboard::AcquireRing(const String& name, unsigned elementSize, unsigned capacity, PluginRingMode mode)
+{
+	if (!elementSize || !capacity)
+	{
+		URHO3D_LOGERROR("Blackboard ring \"" + name + "\" requested with invalid element size or capacity");
+		return nullptr;
+	}
+
+	capacity = NextPowerOfTwo(capacity);
+
+	MutexLock lock(mutex_);
+
+	HashMap<String, Entry>::Iterator i = entries_.Find(name);
+	if (i != entries_.End())
+	{
+		const Entry& entry = i->second_;
+		if (!entry.ring_ || entry.size_ != elementSize || entry.alignment_ != capacity || entry.ring_->GetMode() != mode)
+		{
+			URHO3D_LOGERRORF("Blackboard ring \"%s\" requested with element size %u and capacity %u, it exists with "
+				"another layout", name.CString(), elementSize, capacity);
+			return nullptr;
+		}
+		return entry.ring_;
+	}
+
+	Entry& entry = entries_[name];
+	Allocate(entry, PluginRing::GetMemorySize(elementSize, capacity), RING_ALIGNMENT);
+	entry.ring_ = new(entry.memory_) PluginRing(elementSize, capacity, mode);
+	entry.size_ = elementSize;
+	entry.alignment_ = capacity;
+	return entry.ring_;
+}
+
+void PluginBlackboard::Allocate(Entry& entry, unsigned size, unsigned alignment)
+{
+	// Entries outlive the plugins acquiring them, so they are credited to the player
+	PluginMemoryScope memoryScope(0);
+	const unsigned allocationSize = size + alignment - 1;
+	entry.allocation_ = new unsigned char[allocationSize];
+	memset(entry.allocation_, 0, allocationSize);
+
+	const size_t address = reinterpret_cast<size_t>(entry.allocation_);
+	entry.memory_ = reinterpret_cast<void*>((address + alignment - 1) & ~(size_t)(alignment - 1));
+	memoryUse_ += allocationSize;
+}
@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Object.h>
+
+#include "PluginRing.h"
+
+using namespace Urho3D;
+
+/// Named slots and rings shared between plugins without copy. Memory of an entry is allocated once, when first
+/// acquired, and freed only with the blackboard, so plugins can keep raw pointers to it across hot reloads.
+class PluginBlackboard : public Object
+{
+	URHO3D_OBJECT(PluginBlackboard, Object);
+
+public:
+	/// Construct.
+	explicit PluginBlackboard(Context* context);
+	/// Destruct and free all entries.
+	~PluginBlackboard() override;
+
+	/// Return slot, created zeroed on first request. Return null if it exists with another size or alignment.
+	/// Thread-safe.
+	void* AcquireSlot(const String& name, unsigned size, unsigned alignment);
+	/// Return ring, created on first request with the capacity rounded up to a power of two. Return null if it exists
+	/// with another element size, capacity or mode. Thread-safe.
+	PluginRing* AcquireRing(const String& name, unsigned elementSize, unsigned capacity, PluginRingMode mode);
+
+	/// Return number of entries.
+	unsigned GetNumEntries() const { return entries_.Size(); }
+	/// Return memory used by all entries in bytes.
+	unsigned GetMemoryUse() const { return memoryUse_; }
+
+private:
+	/// Slot or ring.
+	struct Entry
+	{
+		/// Allocation holding the aligned memory.
+		unsigned char* allocation_ = nullptr;
+		/// Slot memory or ring object.
+		void* memory_ = nullptr;
+		/// Ring object, null for a slot.
+		PluginRing* ring_ = nullptr;
+		/// Size of a slot or of a ring element.
+		unsigned size_ = 0;
+		/// Alignment of a slot or capacity of a ring.
+		unsigned alignment_ = 0;
+	};
+
+	/// Allocate zeroed memory of an entry.
+	void Allocate(Entry& entry, unsigned size, unsigned alignment);
+
+	/// Entries by name.
+	HashMap<String, Entry> entries_;
+	/// Memory used by all entries in bytes.
+	unsigned memoryUse_;
+	/// Mutex for the entries.
+	Mutex mutex_;
+};
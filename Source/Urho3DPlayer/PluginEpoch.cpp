@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include <atomic>
+#include <thread>
+
+#include "PluginEpoch.h"
+
+using namespace Urho3D;
+
+/// Number of threads with a reader slot. Readers on further threads share an overflow counter.
+static const unsigned MAX_EPOCH_READERS = 4096;
+
+/// Reader slot of one thread, alone on its cache line.
+struct alignas(64) PluginEpochReader
+{
+	/// Epoch entered by the thread, 0 outside read sections.
+	std::atomic<unsigned long long> epoch_;
+};
+
+static PluginEpochReader epochReaders[MAX_EPOCH_READERS];
+static std::atomic<unsigned> numEpochReaders(0);
+static std::atomic<unsigned> overflowReaders(0);
+static std::atomic<unsigned long long> currentEpoch(1);
+static thread_local unsigned threadReaderIndex = M_MAX_UNSIGNED;
+static thread_local unsigned threadReaderDepth = 0;
+
+void PluginEpoch::Enter()
+{
+	if (threadReaderDepth++)
+		return;
+
+	if (threadReaderIndex == M_MAX_UNSIGNED)
+		threadReaderIndex = numEpochReaders.fetch_add(1);
+
+	// The slot is published before the shared data is read, so a writer scanning afterward sees this reader
+	if (threadReaderIndex < MAX_EPOCH_READERS)
+		epochReaders[threadReaderIndex].epoch_.store(currentEpoch.load());
+	else
+		overflowReaders.fetch_add(1);
+}
+
+void PluginEpoch::Leave()
+{
+	if (--threadReaderDepth)
+		return;
+
+	if (threadReaderIndex < MAX_EPOCH_READERS)
+		epochReaders[threadReaderIndex].epoch_.store(0, std::memory_order_release);
+	else
+		overflowReaders.fetch_sub(1, std::memory_order_release);
+}
+
+unsigned long long PluginEpoch::Advance()
+{
+	return currentEpoch.fetch_add(1);
+}
+
+bool PluginEpoch::IsReleased(unsigned long long epoch)
+{
+	// Readers beyond the slots have no epoch, wait until there is none
+	if (overflowReaders.load())
+		return false;
+
+	const unsigned numReaders = Min(numEpochReaders.load(), MAX_EPOCH_READERS);
+	for (unsigned i = 0; i < numReaders; ++i)
+	{
+		const unsigned long long readerEpoch = epochReaders[i].epoch_.load();
+		if (readerEpoch && readerEpoch <= epoch)
+			return false;
+	}
+
+	return true;
+}
+
+void PluginEpoch::Synchronize()
+{
+	if (threadReaderDepth)
+	{
+		URHO3D_LOGERROR("PluginEpoch::Synchronize called in a read section");
+		return;
+	}
+
+	const unsigned long long epoch = Advance();
+	while (!IsReleased(epoch))
+		std::this_thread::yield();
+}
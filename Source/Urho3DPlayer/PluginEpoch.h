@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+/// Epoch-based reclamation of the plugin data read by any thread. Readers announce the epoch they entered in a slot
+/// of their thread, without lock nor retry. A writer replaces shared data, advances the epoch and frees the old data
+/// only once every reader entered after that epoch.
+class PluginEpoch
+{
+public:
+	/// Enter read section on the calling thread. Sections may be nested. Wait-free.
+	static void Enter();
+	/// Leave read section on the calling thread. Wait-free.
+	static void Leave();
+	/// Advance the epoch after replacing shared data and return the epoch whose readers may still see the old data.
+	static unsigned long long Advance();
+	/// Return whether no reader is left from the epoch returned by Advance.
+	static bool IsReleased(unsigned long long epoch);
+	/// Advance the epoch and wait until no reader is left from the previous one. Must not be called in a read section.
+	static void Synchronize();
+};
+
+/// Helper to keep the calling thread in a read section during a scope.
+class PluginEpochScope
+{
+public:
+	/// Construct and enter the read section.
+	PluginEpochScope() { PluginEpoch::Enter(); }
+	/// Destruct and leave the read section.
+	~PluginEpochScope() { PluginEpoch::Leave(); }
+};
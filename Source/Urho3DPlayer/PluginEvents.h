@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+/// Change of the loaded plugins.
+enum PluginChange
+{
+	/// Loaded by Load, LoadAll or on demand.
+	PLUGIN_CHANGE_LOAD = 0,
+	/// Loaded in background by LoadAsync.
+	PLUGIN_CHANGE_LOAD_ASYNC,
+	/// Unloaded by Unload.
+	PLUGIN_CHANGE_UNLOAD,
+	/// Replaced by its rebuilt library.
+	PLUGIN_CHANGE_RELOAD
+};
+
+/// Plugin requested with Plugin::LoadAsync is loaded and started, or failed to load. Sent on the main thread at
+/// the beginning of a frame.
+URHO3D_EVENT(E_PLUGINLOADED, PluginLoaded)
+{
+	URHO3D_PARAM(P_NAME, Name);                    // String, name as requested
+	URHO3D_PARAM(P_SUCCESS, Success);              // bool
+}
+
+/// Plugin loaded, unloaded or hot reloaded. Sent on the main thread once the change is done.
+URHO3D_EVENT(E_PLUGINCHANGED, PluginChanged)
+{
+	URHO3D_PARAM(P_NAME, Name);                    // String, plugin filename
+	URHO3D_PARAM(P_CHANGE, Change);                // int, PluginChange
+}
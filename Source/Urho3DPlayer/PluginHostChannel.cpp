@@ -0,0 +1,316 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "PluginHostChannel.h"
+
+/// Identifies the shared memory of a channel.
+static const unsigned CHANNEL_MAGIC = 0x48504c55;
+/// Version of the shared memory layout, increased when it changes.
+static const unsigned CHANNEL_VERSION = 1;
+/// Messages each ring can hold.
+static const unsigned CHANNEL_CAPACITY = 64;
+/// Alignment of the header and the rings in the shared memory.
+static const unsigned CHANNEL_ALIGNMENT = 64;
+
+/// Start of the shared memory, followed by the ring to the host and the ring to the player.
+struct PluginHostHeader
+{
+	/// Magic number, written last by the player.
+	unsigned magic_;
+	/// Layout version.
+	unsigned version_;
+	/// Process id of the player.
+	unsigned playerProcessId_;
+	/// Memory of one ring.
+	unsigned ringSize_;
+};
+
+/// Index of the next channel created by this process.
+static std::atomic<unsigned> nextChannelIndex(0);
+
+/// Return id of the calling process.
+static unsigned GetProcessIdentifier()
+{
+#ifdef _WIN32
+	return (unsigned)GetCurrentProcessId();
+#elif defined(__EMSCRIPTEN__)
+	return 0;
+#else
+	return (unsigned)getpid();
+#endif
+}
+
+PluginHostChannel::PluginHostChannel() :
+	memory_(nullptr),
+	size_(0),
+	sendRing_(nullptr),
+	receiveRing_(nullptr),
+	linked_(false)
+#ifdef _WIN32
+	, mapping_(nullptr)
+#endif
+{
+}
+
+PluginHostChannel::~PluginHostChannel()
+{
+	Close();
+}
+
+bool PluginHostChannel::Create()
+{
+	Close();
+	name_ = ToString("Urho3DPlayer-%u-%u", GetProcessIdentifier(), nextChannelIndex.fetch_add(1));
+	return Map(true);
+}
+
+bool PluginHostChannel::Open(const String& name)
+{
+	Close();
+	name_ = name;
+	return Map(false);
+}
+
+void PluginHostChannel::Close()
+{
+	if (memory_)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(memory_);
+		CloseHandle((HANDLE)mapping_);
+		mapping_ = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+		munmap(memory_, size_);
+#endif
+		memory_ = nullptr;
+	}
+
+	Unlink();
+	sendRing_ = nullptr;
+	receiveRing_ = nullptr;
+}
+
+void PluginHostChannel::Unlink()
+{
+	// Named file mappings are freed with their last handle on Windows
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+	if (linked_)
+		shm_unlink(("/" + name_).CString());
+#endif
+	linked_ = false;
+}
+
+bool PluginHostChannel::Map(bool create)
+{
+	const unsigned ringSize = (PluginRing::GetMemorySize(sizeof(PluginHostMessage), CHANNEL_CAPACITY) +
+		CHANNEL_ALIGNMENT - 1) & ~(CHANNEL_ALIGNMENT - 1);
+	size_ = CHANNEL_ALIGNMENT + 2 * ringSize;
+
+#ifdef _WIN32
+	const String mappingName = "Local\\" + name_;
+	HANDLE mapping = create ? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, size_,
+		mappingName.CString()) : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.CString());
+	if (!mapping)
+	{
+		URHO3D_LOGERRORF("Failed to open plugin host channel %s, error %u", name_.CString(), (unsigned)GetLastError());
+		return false;
+	}
+
+	memory_ = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size_);
+	if (!memory_)
+	{
+		URHO3D_LOGERRORF("Failed to map plugin host channel %s, error %u", name_.CString(), (unsigned)GetLastError());
+		CloseHandle(mapping);
+		return false;
+	}
+	mapping_ = mapping;
+#elif defined(__EMSCRIPTEN__)
+	URHO3D_LOGERROR("Plugin host channels are not supported on this platform");
+	return false;
+#else
+	const String sharedName = "/" + name_;
+	const int descriptor = shm_open(sharedName.CString(), create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0600);
+	if (descriptor < 0)
+	{
+		URHO3D_LOGERRORF("Failed to open plugin host channel %s: %s", name_.CString(), strerror(errno));
+		return false;
+	}
+
+	linked_ = create;
+	if (create && ftruncate(descriptor, size_) != 0)
+	{
+		URHO3D_LOGERRORF("Failed to size plugin host channel %s: %s", name_.CString(), strerror(errno));
+		close(descriptor);
+		Unlink();
+		return false;
+	}
+
+	void* memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (memory == MAP_FAILED)
+	{
+		URHO3D_LOGERRORF("Failed to map plugin host channel %s: %s", name_.CString(), strerror(errno));
+		Unlink();
+		return false;
+	}
+	memory_ = memory;
+#endif
+
+	auto* header = static_cast<PluginHostHeader*>(memory_);
+	auto* toHost = reinterpret_cast<PluginRing*>(static_cast<unsigned char*>(memory_) + CHANNEL_ALIGNMENT);
+	auto* toPlayer = reinterpret_cast<PluginRing*>(static_cast<unsigned char*>(memory_) + CHANNEL_ALIGNMENT + ringSize);
+
+	if (create)
+	{
+		new(toHost) PluginRing(sizeof(PluginHostMessage), CHANNEL_CAPACITY, PLUGIN_RING_SPSC);
+		new(toPlayer) PluginRing(sizeof(PluginHostMessage), CHANNEL_CAPACITY, PLUGIN_RING_SPSC);
+		header->version_ = CHANNEL_VERSION;
+		header->playerProcessId_ = GetProcessIdentifier();
+		header->ringSize_ = ringSize;
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic_ = CHANNEL_MAGIC;
+
+		sendRing_ = toHost;
+		receiveRing_ = toPlayer;
+	}
+	else
+	{
+		// The host is launched once the channel is complete
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header->magic_ != CHANNEL_MAGIC || header->version_ != CHANNEL_VERSION || header->ringSize_ != ringSize)
+		{
+			URHO3D_LOGERROR("Plugin host channel " + name_ + " was created by another version of the player");
+			Close();
+			return false;
+		}
+
+		sendRing_ = toPlayer;
+		receiveRing_ = toHost;
+	}
+
+	return true;
+}
+
+bool PluginHostChannel::Send(PluginHostMessageType type, unsigned frameNumber, float timeStep)
+{
+	if (!sendRing_)
+		return false;
+
+	unsigned position;
+	auto* message = static_cast<PluginHostMessage*>(sendRing_->BeginWrite(position));
+	if (!message)
+		return false;
+
+	message->type_ = type;
+	message->frameNumber_ = frameNumber;
+	message->timeStep_ = timeStep;
+	message->size_ = 0;
+	sendRing_->EndWrite(position);
+	return true;
+}
+
+bool PluginHostChannel::SendEvent(const VariantMap& eventData)
+{
+	if (!sendRing_)
+		return false;
+
+	VectorBuffer buffer;
+	buffer.WriteVariantMap(eventData);
+	if (buffer.GetSize() > PLUGIN_HOST_MESSAGE_DATA_SIZE)
+	{
+		URHO3D_LOGERRORF("Event parameters of %u bytes are too large to forward to a plugin host, the limit is %u",
+			buffer.GetSize(), PLUGIN_HOST_MESSAGE_DATA_SIZE);
+		return false;
+	}
+
+	unsigned position;
+	auto* message = static_cast<PluginHostMessage*>(sendRing_->BeginWrite(position));
+	if (!message)
+		return false;
+
+	message->type_ = PLUGIN_HOST_EVENT;
+	message->frameNumber_ = 0;
+	message->timeStep_ = 0.0f;
+	message->size_ = buffer.GetSize();
+	memcpy(message->data_, buffer.GetData(), buffer.GetSize());
+	sendRing_->EndWrite(position);
+	return true;
+}
+
+const PluginHostMessage* PluginHostChannel::BeginReceive()
+{
+	return receiveRing_ ? static_cast<const PluginHostMessage*>(receiveRing_->BeginRead()) : nullptr;
+}
+
+void PluginHostChannel::EndReceive()
+{
+	receiveRing_->EndRead();
+}
+
+bool PluginHostChannel::ReadEvent(const PluginHostMessage& message, VariantMap& eventData)
+{
+	if (message.type_ != PLUGIN_HOST_EVENT || message.size_ > PLUGIN_HOST_MESSAGE_DATA_SIZE)
+		return false;
+
+	MemoryBuffer buffer(message.data_, message.size_);
+	eventData = buffer.ReadVariantMap();
+	return true;
+}
+
+bool PluginHostChannel::IsPlayerAlive() const
+{
+	if (!memory_)
+		return false;
+
+	const unsigned processId = static_cast<const PluginHostHeader*>(memory_)->playerProcessId_;
+#ifdef _WIN32
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+	if (!process)
+		return false;
+	const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+	return alive;
+#elif defined(__EMSCRIPTEN__)
+	return false;
+#else
+	return kill((pid_t)processId, 0) == 0 || errno == EPERM;
+#endif
+}
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+#include <Urho3D/Container/Str.h>
+#include <Urho3D/Core/Variant.h>
+
+#include "PluginRing.h"
+
+using namespace Urho3D;
+
+/// Message exchanged between the player and a PluginHost process.
+enum PluginHostMessageType : unsigned
+{
+	/// Host to player: the plugin is loaded and set up.
+	PLUGIN_HOST_READY = 0,
+	/// Host to player: the plugin failed to load, the host exits.
+	PLUGIN_HOST_FAILED,
+	/// Player to host: start the plugin.
+	PLUGIN_HOST_START,
+	/// Host to player: the plugin is started.
+	PLUGIN_HOST_STARTED,
+	/// Player to host: run a frame with the time step of the player.
+	PLUGIN_HOST_FRAME,
+	/// Host to player: the frame is complete.
+	PLUGIN_HOST_FRAME_DONE,
+	/// Both ways: forwarded event parameters.
+	PLUGIN_HOST_EVENT,
+	/// Player to host: stop the plugin and exit.
+	PLUGIN_HOST_STOP,
+	/// Host to player: the plugin is stopped.
+	PLUGIN_HOST_STOPPED
+};
+
+/// Bytes of message data, so a whole message is 4 KB.
+static const unsigned PLUGIN_HOST_MESSAGE_DATA_SIZE = 4080;
+
+/// Fixed size message in the rings of a channel.
+struct PluginHostMessage
+{
+	/// Message type.
+	PluginHostMessageType type_;
+	/// Player frame number.
+	unsigned frameNumber_;
+	/// Player time step of the frame.
+	float timeStep_;
+	/// Bytes of data used.
+	unsigned size_;
+	/// Serialized event parameters.
+	unsigned char data_[PLUGIN_HOST_MESSAGE_DATA_SIZE];
+};
+
+/// Shared memory between the player and a PluginHost process, holding one ring in each direction. The rings are
+/// lock-free and position independent, so neither side ever waits for the other to read or write a message.
+class PluginHostChannel
+{
+public:
+	/// Construct.
+	PluginHostChannel();
+	/// Destruct. Unmap the shared memory.
+	~PluginHostChannel();
+
+	/// Create the channel under a new name, on the player side. Return true if successful.
+	bool Create();
+	/// Open the channel created by the player, on the host side. Return true if successful.
+	bool Open(const String& name);
+	/// Unmap the shared memory and remove its name.
+	void Close();
+	/// Remove the name of the shared memory once the host opened it, so it is freed even if both sides crash.
+	void Unlink();
+
+	/// Send a message. Return false if the ring is full.
+	bool Send(PluginHostMessageType type, unsigned frameNumber = 0, float timeStep = 0.0f);
+	/// Send event parameters. Return false if they are too large or the ring is full.
+	bool SendEvent(const VariantMap& eventData);
+	/// Return the oldest received message to read in place, or null if there is none. Release it with EndReceive.
+	const PluginHostMessage* BeginReceive();
+	/// Release the message returned by BeginReceive.
+	void EndReceive();
+	/// Read event parameters from a message. Return false if they are corrupt.
+	static bool ReadEvent(const PluginHostMessage& message, VariantMap& eventData);
+
+	/// Return whether the shared memory is mapped.
+	bool IsOpen() const { return memory_ != nullptr; }
+	/// Return whether the player process which created the channel is still running.
+	bool IsPlayerAlive() const;
+	/// Return shared memory name.
+	const String& GetName() const { return name_; }
+
+private:
+	/// Map the shared memory, and construct the rings if creating it. Return true if successful.
+	bool Map(bool create);
+
+	/// Shared memory name.
+	String name_;
+	/// Mapped memory.
+	void* memory_;
+	/// Mapped size.
+	unsigned size_;
+	/// Ring written by this side.
+	PluginRing* sendRing_;
+	/// Ring read by this side.
+	PluginRing* receiveRing_;
+	/// Flag whether the name is still to be removed.
+	bool linked_;
+#ifdef _WIN32
+	/// File mapping handle.
+	void* mapping_;
+#endif
+};
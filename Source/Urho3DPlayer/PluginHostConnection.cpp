@@ -0,0 +1,332 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+#include "PluginHostConnection.h"
+#include "PluginHostEvents.h"
+
+/// Longest wait in microseconds for the host to set up, start or stop the plugin.
+static const long long HOST_TIMEOUT = 10000000;
+/// Longest wait in microseconds for the host to exit once the plugin is stopped.
+static const long long HOST_EXIT_TIMEOUT = 1000000;
+/// Remaining wait in microseconds under which the calling thread spins instead of sleeping.
+static const long long SPIN_TIME = 2000;
+
+#ifdef _WIN32
+static const char* HOST_EXECUTABLE_NAME = "PluginHost.exe";
+#else
+static const char* HOST_EXECUTABLE_NAME = "PluginHost";
+#endif
+
+PluginHostConnection::PluginHostConnection(Context* context, const String& name) :
+	Object(context),
+	name_(name),
+	deadline_(1000),
+	lastFrameSent_(0),
+	lastFrameDone_(0),
+	missedDeadlines_(0),
+	droppedFrames_(0),
+	ready_(false),
+	started_(false),
+#ifdef _WIN32
+	process_(nullptr)
+#else
+	processId_(0)
+#endif
+{
+}
+
+PluginHostConnection::~PluginHostConnection()
+{
+	Stop();
+}
+
+bool PluginHostConnection::Launch()
+{
+	if (!channel_.Create())
+		return false;
+
+	const String hostPath = GetSubsystem<FileSystem>()->GetProgramDir() + HOST_EXECUTABLE_NAME;
+
+#ifdef _WIN32
+	String commandLine = "\"" + GetNativePath(hostPath) + "\" -channel " + channel_.GetName() + " -plugin \"" + name_ + "\"";
+	STARTUPINFOA startupInfo;
+	ZeroMemory(&startupInfo, sizeof(startupInfo));
+	startupInfo.cb = sizeof(startupInfo);
+	PROCESS_INFORMATION processInfo;
+	if (!CreateProcessA(nullptr, const_cast<char*>(commandLine.CString()), nullptr, nullptr, FALSE, 0, nullptr, nullptr,
+		&startupInfo, &processInfo))
+	{
+		URHO3D_LOGERRORF("Failed to launch %s for plugin \"%s\", error %u", hostPath.CString(), name_.CString(),
+			(unsigned)GetLastError());
+		channel_.Close();
+		return false;
+	}
+
+	CloseHandle(processInfo.hThread);
+	process_ = processInfo.hProcess;
+#elif defined(__EMSCRIPTEN__)
+	URHO3D_LOGERROR("Plugin hosts are not supported on this platform");
+	channel_.Close();
+	return false;
+#else
+	const char* arguments[] = { hostPath.CString(), "-channel", channel_.GetName().CString(), "-plugin", name_.CString(),
+		nullptr };
+	pid_t processId;
+	const int error = posix_spawn(&processId, hostPath.CString(), nullptr, nullptr, const_cast<char* const*>(arguments),
+		environ);
+	if (error)
+	{
+		URHO3D_LOGERRORF("Failed to launch %s for plugin \"%s\": %s", hostPath.CString(), name_.CString(), strerror(error));
+		channel_.Close();
+		return false;
+	}
+
+	processId_ = processId;
+#endif
+
+	SubscribeToEvent(E_PLUGINHOSTINPUT, URHO3D_HANDLER(PluginHostConnection, HandleInput));
+	URHO3D_LOGINFO("Plugin \"" + name_ + "\" launched in a plugin host");
+	return true;
+}
+
+bool PluginHostConnection::WaitReady()
+{
+	if (ready_)
+		return true;
+
+	if (!Receive(PLUGIN_HOST_READY, HOST_TIMEOUT))
+	{
+		URHO3D_LOGERROR("Plugin host of \"" + name_ + "\" failed to set up the plugin");
+		Stop();
+		return false;
+	}
+
+	// The host mapped the channel, so it no longer needs a name
+	channel_.Unlink();
+	ready_ = true;
+	return true;
+}
+
+bool PluginHostConnection::Start()
+{
+	if (started_)
+		return true;
+
+	if (!WaitReady())
+		return false;
+
+	if (!channel_.Send(PLUGIN_HOST_START) || !Receive(PLUGIN_HOST_STARTED, HOST_TIMEOUT))
+	{
+		URHO3D_LOGERROR("Plugin host of \"" + name_ + "\" failed to start the plugin");
+		Stop();
+		return false;
+	}
+
+	started_ = true;
+	SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(PluginHostConnection, HandleBeginFrame));
+	SubscribeToEvent(E_POSTUPDATE, URHO3D_HANDLER(PluginHostConnection, HandlePostUpdate));
+	return true;
+}
+
+void PluginHostConnection::Stop()
+{
+	UnsubscribeFromAllEvents();
+
+	if (IsProcessRunning())
+	{
+		// A host which does not stop the plugin in time is killed
+		if (!channel_.Send(PLUGIN_HOST_STOP) || !Receive(PLUGIN_HOST_STOPPED, HOST_TIMEOUT))
+			URHO3D_LOGERROR("Plugin host of \"" + name_ + "\" failed to stop the plugin");
+
+		HiresTimer exitTimer;
+		while (IsProcessRunning() && exitTimer.GetUSec(false) < HOST_EXIT_TIMEOUT)
+			Time::Sleep(1);
+		if (IsProcessRunning())
+			KillProcess();
+	}
+
+	if (missedDeadlines_ || droppedFrames_)
+	{
+		URHO3D_LOGINFOF("Plugin host of \"%s\" missed %u frame deadlines and dropped %u frames", name_.CString(),
+			missedDeadlines_, droppedFrames_);
+		missedDeadlines_ = 0;
+		droppedFrames_ = 0;
+	}
+
+	channel_.Close();
+	ready_ = false;
+	started_ = false;
+}
+
+bool PluginHostConnection::Receive(PluginHostMessageType type, long long timeout)
+{
+	HiresTimer timer;
+	for (;;)
+	{
+		while (const PluginHostMessage* message = channel_.BeginReceive())
+		{
+			const PluginHostMessageType receivedType = message->type_;
+			if (receivedType == PLUGIN_HOST_EVENT)
+			{
+				VariantMap eventData;
+				if (PluginHostChannel::ReadEvent(*message, eventData))
+				{
+					channel_.EndReceive();
+					eventData[PluginHostOutput::P_PLUGIN] = name_;
+					SendEvent(E_PLUGINHOSTOUTPUT, eventData);
+					continue;
+				}
+			}
+			else if (receivedType == PLUGIN_HOST_FRAME_DONE)
+				lastFrameDone_ = message->frameNumber_;
+			channel_.EndReceive();
+
+			if (receivedType == type)
+				return true;
+			if (receivedType == PLUGIN_HOST_FAILED)
+				return false;
+		}
+
+		const long long remaining = timeout - timer.GetUSec(false);
+		if (remaining <= 0)
+			return false;
+
+		// Sleeping is too coarse for a frame deadline
+		if (remaining < SPIN_TIME)
+			std::this_thread::yield();
+		else if (IsProcessRunning())
+			Time::Sleep(1);
+		else
+			return false;
+	}
+}
+
+bool PluginHostConnection::IsProcessRunning()
+{
+#ifdef _WIN32
+	if (!process_)
+		return false;
+	if (WaitForSingleObject((HANDLE)process_, 0) == WAIT_TIMEOUT)
+		return true;
+
+	CloseHandle((HANDLE)process_);
+	process_ = nullptr;
+	return false;
+#elif defined(__EMSCRIPTEN__)
+	return false;
+#else
+	if (!processId_)
+		return false;
+
+	int status;
+	if (waitpid(processId_, &status, WNOHANG) == 0)
+		return true;
+
+	processId_ = 0;
+	return false;
+#endif
+}
+
+void PluginHostConnection::KillProcess()
+{
+	URHO3D_LOGWARNING("Killing plugin host of \"" + name_ + "\"");
+
+#ifdef _WIN32
+	TerminateProcess((HANDLE)process_, 1);
+	WaitForSingleObject((HANDLE)process_, INFINITE);
+	CloseHandle((HANDLE)process_);
+	process_ = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+	kill(processId_, SIGKILL);
+	int status;
+	waitpid(processId_, &status, 0);
+	processId_ = 0;
+#endif
+}
+
+void PluginHostConnection::Disconnect()
+{
+	URHO3D_LOGERROR("Plugin host of \"" + name_ + "\" exited unexpectedly");
+	UnsubscribeFromAllEvents();
+	started_ = false;
+}
+
+void PluginHostConnection::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+	using namespace BeginFrame;
+
+	frameTimer_.Reset();
+
+	// A host more than a ring of frames behind skips frames rather than making the player wait
+	const unsigned frameNumber = eventData[P_FRAMENUMBER].GetUInt();
+	if (channel_.Send(PLUGIN_HOST_FRAME, frameNumber, eventData[P_TIMESTEP].GetFloat()))
+		lastFrameSent_ = frameNumber;
+	else
+		++droppedFrames_;
+}
+
+void PluginHostConnection::HandlePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+	// Messages already received are handled even past the deadline
+	while (lastFrameDone_ != lastFrameSent_)
+	{
+		if (!Receive(PLUGIN_HOST_FRAME_DONE, deadline_ - frameTimer_.GetUSec(false)))
+			break;
+	}
+
+	// Outputs of late frames are forwarded on a later frame
+	if (lastFrameDone_ != lastFrameSent_)
+	{
+		++missedDeadlines_;
+		if (!IsProcessRunning())
+			Disconnect();
+	}
+}
+
+void PluginHostConnection::HandleInput(StringHash eventType, VariantMap& eventData)
+{
+	using namespace PluginHostInput;
+
+	if (eventData[P_PLUGIN].GetString() != name_)
+		return;
+
+	if (!channel_.SendEvent(eventData))
+		URHO3D_LOGWARNING("Input to plugin host of \"" + name_ + "\" dropped");
+}
@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+
+#include "PluginHostChannel.h"
+
+using namespace Urho3D;
+
+/// Player side of a plugin running in a PluginHost process. The host runs the Setup, Start and Stop of the plugin
+/// when told to, and one frame per frame of the player with its time step. The main thread never waits for a
+/// frame of the host longer than the deadline: late frames complete in the background and their outputs are
+/// forwarded on a later frame.
+class PluginHostConnection : public Object
+{
+	URHO3D_OBJECT(PluginHostConnection, Object);
+
+public:
+	/// Construct.
+	PluginHostConnection(Context* context, const String& name);
+	/// Destruct. Stop the host if still running.
+	~PluginHostConnection() override;
+
+	/// Create the channel and launch the host process, which loads and sets up the plugin. Return true if successful.
+	bool Launch();
+	/// Wait until the plugin is set up in the host. Return true if successful.
+	bool WaitReady();
+	/// Start the plugin, then run a host frame per player frame. Return true if successful.
+	bool Start();
+	/// Stop the plugin and wait for the host to exit, killing it after a timeout.
+	void Stop();
+
+	/// Set longest wait for a host frame in microseconds, counted from the start of the player frame.
+	void SetDeadline(long long deadline) { deadline_ = deadline; }
+	/// Return plugin name.
+	const String& GetName() const { return name_; }
+	/// Return whether the plugin is started and the host running.
+	bool IsStarted() const { return started_; }
+	/// Return number of host frames not complete by the deadline.
+	unsigned GetMissedDeadlines() const { return missedDeadlines_; }
+	/// Return number of frames not sent because the host was too far behind.
+	unsigned GetDroppedFrames() const { return droppedFrames_; }
+
+private:
+	/// Receive messages until one of the type arrives, the host fails or the timeout in microseconds elapses.
+	/// Return true if the message arrived.
+	bool Receive(PluginHostMessageType type, long long timeout);
+	/// Return whether the host process is still running.
+	bool IsProcessRunning();
+	/// Kill the host process.
+	void KillProcess();
+	/// Stop forwarding after the host exited or failed.
+	void Disconnect();
+	/// Handle begin frame to send the frame to the host.
+	void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+	/// Handle post update to wait for the host frame until the deadline and forward its outputs.
+	void HandlePostUpdate(StringHash eventType, VariantMap& eventData);
+	/// Handle input event to forward it to the host.
+	void HandleInput(StringHash eventType, VariantMap& eventData);
+
+	/// Plugin name.
+	String name_;
+	/// Shared memory with the host.
+	PluginHostChannel channel_;
+	/// Longest wait for a host frame in microseconds.
+	long long deadline_;
+	/// Timer from the start of the player frame.
+	HiresTimer frameTimer_;
+	/// Last frame sent to the host.
+	unsigned lastFrameSent_;
+	/// Last frame completed by the host.
+	unsigned lastFrameDone_;
+	/// Number of host frames not complete by the deadline.
+	unsigned missedDeadlines_;
+	/// Number of frames not sent.
+	unsigned droppedFrames_;
+	/// Flag whether the plugin is set up.
+	bool ready_;
+	/// Flag whether the plugin is started.
+	bool started_;
+#ifdef _WIN32
+	/// Host process handle.
+	void* process_;
+#else
+	/// Host process id, 0 if not running.
+	int processId_;
+#endif
+};
@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include "PluginLogWriter.h"
+
+/// Interval between two writes of pending messages in milliseconds.
+static const unsigned LOG_WRITE_INTERVAL = 5;
+static const unsigned LOG_IDLE_INTERVAL = 40;
+
+static const char* levelPrefixes[] =
+{
+	"TRACE",
+	"DEBUG",
+	"INFO",
+	"WARNING",
+	"ERROR"
+};
+
+PluginLogWriter::PluginLogWriter(Context* context) :
+	Object(context),
+	nextChannel_(1)
+{
+	Run();
+}
+
+PluginLogWriter::~PluginLogWriter()
+{
+	Stop();
+
+	MutexLock lock(channelsMutex_);
+	for (HashMap<unsigned, Channel>::Iterator i = channels_.Begin(); i != channels_.End(); ++i)
+	{
+		DrainChannel(i->second_);
+		for (unsigned j = 0; j < i->second_.rings_.Size(); ++j)
+			delete i->second_.rings_[j];
+	}
+	channels_.Clear();
+}
+
+unsigned PluginLogWriter::OpenChannel(const String& name, bool quiet)
+{
+	SharedPtr<File> file(new File(context_));
+	if (!file->Open(name + ".log", FILE_WRITE))
+	{
+		URHO3D_LOGERROR("Failed to create log file " + name + ".log");
+		file.Reset();
+	}
+
+	MutexLock lock(channelsMutex_);
+	const unsigned id = nextChannel_++;
+	Channel& channel = channels_[id];
+	channel.name_ = name;
+	channel.file_ = file;
+	channel.quiet_ = quiet;
+
+	return id;
+}
+
+void PluginLogWriter::CloseChannel(unsigned channel)
+{
+	MutexLock lock(channelsMutex_);
+	HashMap<unsigned, Channel>::Iterator i = channels_.Find(channel);
+	if (i == channels_.End())
+		return;
+
+	DrainChannel(i->second_);
+	for (unsigned j = 0; j < i->second_.rings_.Size(); ++j)
+		delete i->second_.rings_[j];
+	if (i->second_.file_)
+		i->second_.file_->Close();
+	channels_.Erase(i);
+}
+
+PluginLogRing* PluginLogWriter::AcquireRing(unsigned channel)
+{
+	MutexLock lock(channelsMutex_);
+	HashMap<unsigned, Channel>::Iterator i = channels_.Find(channel);
+	if (i == channels_.End())
+		return nullptr;
+
+	// Threads switching between plugins ask again for the ring of each channel, which keeps one writer per ring
+	const ThreadID thread = Thread::GetCurrentThreadID();
+	for (unsigned j = 0; j < i->second_.ringThreads_.Size(); ++j)
+	{
+		if (i->second_.ringThreads_[j] == thread)
+			return i->second_.rings_[j];
+	}
+
+	auto* ring = new PluginLogRing();
+	i->second_.rings_.Push(ring);
+	i->second_.ringThreads_.Push(thread);
+	return ring;
+}
+
+bool PluginLogWriter::Flush()
+{
+	MutexLock lock(channelsMutex_);
+	bool written = false;
+	for (HashMap<unsigned, Channel>::Iterator i = channels_.Begin(); i != channels_.End(); ++i)
+		written |= DrainChannel(i->second_);
+	return written;
+}
+
+void PluginLogWriter::ThreadFunction()
+{
+	// Back off while the plugins are silent, polling is resumed at full rate by the next message
+	unsigned interval = LOG_WRITE_INTERVAL;
+	while (shouldRun_)
+	{
+		interval = Flush() ? LOG_WRITE_INTERVAL : Min(interval * 2, LOG_IDLE_INTERVAL);
+		Time::Sleep(interval);
+	}
+}
+
+bool PluginLogWriter::DrainChannel(Channel& channel)
+{
+	bool written = false;
+	for (unsigned i = 0; i < channel.rings_.Size(); ++i)
+	{
+		PluginLogRing* ring = channel.rings_[i];
+		while (const PluginLogRecord* record = ring->BeginRead())
+		{
+			WriteLine(channel, record->level_, FormatPluginLogRecord(*record));
+			ring->EndRead();
+			written = true;
+		}
+
+		const unsigned dropped = ring->TakeDropped();
+		if (dropped)
+		{
+			WriteLine(channel, LOG_WARNING, ToString("%u messages dropped, log ring full", dropped));
+			written = true;
+		}
+	}
+
+	if (written && channel.file_)
+		channel.file_->Flush();
+	return written;
+}
+
+void PluginLogWriter::WriteLine(Channel& channel, int level, const String& message)
+{
+	if (level == LOG_RAW)
+	{
+		if (channel.file_)
+			channel.file_->Write(message.CString(), message.Length());
+		if (!channel.quiet_)
+			PrintUnicode(message, false);
+		return;
+	}
+
+	const String formattedMessage = "[" + Time::GetTimeStamp() + "] " + String(levelPrefixes[Clamp(level, 0, 4)]) + ": " + message;
+	if (channel.file_)
+		channel.file_->WriteLine(formattedMessage);
+	if (!channel.quiet_)
+		PrintUnicodeLine("[" + channel.name_ + "] " + formattedMessage, level == LOG_ERROR);
+}
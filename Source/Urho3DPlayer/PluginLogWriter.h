@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/IO/File.h>
+
+#include "PluginLogBuffer.h"
+
+using namespace Urho3D;
+
+/// Background writer of the plugin logs. Plugins only record raw messages in per thread rings, formatting and file
+/// output happen on the writer thread.
+class PluginLogWriter : public Object, public Thread
+{
+	URHO3D_OBJECT(PluginLogWriter, Object);
+
+public:
+	/// Construct.
+	explicit PluginLogWriter(Context* context);
+	/// Destruct. Stop the writer thread and close all channels.
+	~PluginLogWriter() override;
+
+	/// Open channel writing to the log file of a plugin and return its id.
+	unsigned OpenChannel(const String& name, bool quiet);
+	/// Write pending messages of the channel and close it.
+	void CloseChannel(unsigned channel);
+	/// Return the ring of the calling thread on a channel, created on first request, or null if the channel is not
+	/// open. Thread-safe.
+	PluginLogRing* AcquireRing(unsigned channel);
+	/// Write pending messages of all channels on the calling thread and return whether there were some. Required
+	/// before unloading a plugin library, messages reference its format strings.
+	bool Flush();
+
+	/// Write pending messages periodically.
+	void ThreadFunction() override;
+
+private:
+	/// Log output of one plugin.
+	struct Channel
+	{
+		/// Plugin name.
+		String name_;
+		/// Log file.
+		SharedPtr<File> file_;
+		/// Rings of the threads writing on the channel.
+		PODVector<PluginLogRing*> rings_;
+		/// Thread writing on each ring.
+		PODVector<ThreadID> ringThreads_;
+		/// Quiet flag, stdout is not written when set.
+		bool quiet_;
+	};
+
+	/// Write pending messages of a channel and return whether there were some. Called with the mutex locked.
+	bool DrainChannel(Channel& channel);
+	/// Write one formatted line to a channel.
+	void WriteLine(Channel& channel, int level, const String& message);
+
+	/// Open channels.
+	HashMap<unsigned, Channel> channels_;
+	/// Mutex for the channels.
+	Mutex channelsMutex_;
+	/// Next channel id.
+	unsigned nextChannel_;
+};
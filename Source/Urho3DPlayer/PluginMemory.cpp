@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <Urho3D/IO/Log.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "PluginMemory.h"
+
+/// Number of tags, the first one being the player.
+static const unsigned MAX_MEMORY_TAGS = 4096;
+
+/// Memory counters of one tag.
+struct PluginMemoryCounter
+{
+	/// Bytes allocated and not freed yet.
+	std::atomic<long long> use_;
+	/// Highest use.
+	std::atomic<long long> peak_;
+};
+
+static PluginMemoryCounter memoryCounters[MAX_MEMORY_TAGS];
+static std::atomic<unsigned> nextMemoryTag(1);
+static thread_local unsigned threadMemoryTag = 0;
+
+/// Add bytes to a counter and update its peak.
+static inline void AddMemory(unsigned tag, long long bytes)
+{
+	PluginMemoryCounter& counter = memoryCounters[tag];
+	const long long use = counter.use_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	long long peak = counter.peak_.load(std::memory_order_relaxed);
+	while (use > peak && !counter.peak_.compare_exchange_weak(peak, use, std::memory_order_relaxed))
+		;
+}
+
+#ifdef URHO3D_PLUGIN_MEMORY
+
+/// Header before each allocation, keeping the 16 bytes alignment of malloc.
+struct alignas(16) PluginAllocationHeader
+{
+	/// Requested size.
+	size_t size_;
+	/// Tag the allocation is credited to.
+	unsigned tag_;
+};
+
+/// Allocate memory credited to the tag of the calling thread.
+static inline void* AllocateTagged(size_t size)
+{
+	auto* header = static_cast<PluginAllocationHeader*>(malloc(sizeof(PluginAllocationHeader) + size));
+	if (!header)
+		return nullptr;
+
+	header->size_ = size;
+	header->tag_ = threadMemoryTag;
+	if (header->tag_)
+		AddMemory(header->tag_, (long long)size);
+	return header + 1;
+}
+
+/// Free memory and credit it back to its tag.
+static inline void FreeTagged(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	PluginAllocationHeader* header = static_cast<PluginAllocationHeader*>(ptr) - 1;
+	if (header->tag_)
+		AddMemory(header->tag_, -(long long)header->size_);
+	free(header);
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = AllocateTagged(size);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = AllocateTagged(size);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return AllocateTagged(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return AllocateTagged(size); }
+void operator delete(void* ptr) noexcept { FreeTagged(ptr); }
+void operator delete[](void* ptr) noexcept { FreeTagged(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { FreeTagged(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { FreeTagged(ptr); }
+#ifdef __cpp_sized_deallocation
+void operator delete(void* ptr, size_t) noexcept { FreeTagged(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { FreeTagged(ptr); }
+#endif
+
+#endif
+
+bool PluginMemory::IsEnabled()
+{
+#ifdef URHO3D_PLUGIN_MEMORY
+	return true;
+#else
+	return false;
+#endif
+}
+
+unsigned PluginMemory::AcquireTag()
+{
+	const unsigned tag = nextMemoryTag.fetch_add(1, std::memory_order_relaxed);
+	if (tag < MAX_MEMORY_TAGS)
+		return tag;
+
+	if (tag == MAX_MEMORY_TAGS)
+		URHO3D_LOGWARNING("Too many plugins loaded, memory of the next ones is credited to the player");
+	return 0;
+}
+
+unsigned PluginMemory::SetThreadTag(unsigned tag)
+{
+	const unsigned previousTag = threadMemoryTag;
+	threadMemoryTag = tag;
+	return previousTag;
+}
+
+void PluginMemory::Record(unsigned tag, long long bytes)
+{
+	if (tag && tag < MAX_MEMORY_TAGS)
+		AddMemory(tag, bytes);
+}
+
+long long PluginMemory::GetUse(unsigned tag)
+{
+	return tag < MAX_MEMORY_TAGS ? memoryCounters[tag].use_.load(std::memory_order_relaxed) : 0;
+}
+
+long long PluginMemory::GetPeak(unsigned tag)
+{
+	return tag < MAX_MEMORY_TAGS ? memoryCounters[tag].peak_.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#pragma once
+
+/// Accounting of the memory allocated on behalf of each plugin. With URHO3D_PLUGIN_MEMORY, the player replaces the
+/// global allocator of the process: each allocation records the tag of the plugin whose code runs on the calling
+/// thread, so it is credited back to that plugin whichever code frees it. Tag 0 is the player and the engine.
+class PluginMemory
+{
+public:
+	/// Return whether allocations are accounted.
+	static bool IsEnabled();
+	/// Return a new tag for a plugin, or 0 if there is none left. Tags are not reused.
+	static unsigned AcquireTag();
+	/// Set tag of the calling thread and return the previous one.
+	static unsigned SetThreadTag(unsigned tag);
+	/// Record memory allocated or freed under a tag outside the global allocator, such as an arena.
+	static void Record(unsigned tag, long long bytes);
+	/// Return bytes allocated under a tag and not freed yet.
+	static long long GetUse(unsigned tag);
+	/// Return highest bytes allocated under a tag at once.
+	static long long GetPeak(unsigned tag);
+};
+
+/// Helper to credit the allocations of the calling thread to a plugin.
+class PluginMemoryScope
+{
+public:
+	/// Construct and set the tag of the calling thread.
+	explicit PluginMemoryScope(unsigned tag) :
+		previousTag_(PluginMemory::SetThreadTag(tag))
+	{
+	}
+
+	/// Destruct and restore the previous tag.
+	~PluginMemoryScope() { PluginMemory::SetThreadTag(previousTag_); }
+
+private:
+	/// Tag of the calling thread before the scope.
+	unsigned previousTag_;
+};
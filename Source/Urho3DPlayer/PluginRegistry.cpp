@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "PluginEpoch.h"
+#include "PluginRegistry.h"
+
+PluginRegistry::PluginRegistry() :
+	entries_(new EntryMap())
+{
+}
+
+PluginRegistry::~PluginRegistry()
+{
+	for (const RetiredEntries& retired : retired_)
+		delete retired.entries_;
+	delete entries_.load();
+}
+
+const PluginRegistryEntry* PluginRegistry::Find(StringHash name) const
+{
+	const EntryMap* entries = entries_.load();
+	EntryMap::ConstIterator i = entries->Find(name);
+	return i != entries->End() ? &i->second_ : nullptr;
+}
+
+bool PluginRegistry::Contains(StringHash name) const
+{
+	PluginEpochScope scope;
+	return entries_.load()->Contains(name);
+}
+
+unsigned PluginRegistry::Size() const
+{
+	PluginEpochScope scope;
+	return entries_.load()->Size();
+}
+
+void PluginRegistry::Set(StringHash name, const PluginRegistryEntry& entry)
+{
+	auto* entries = new EntryMap(*entries_.load());
+	(*entries)[name] = entry;
+	Publish(entries);
+}
+
+void PluginRegistry::Remove(StringHash name)
+{
+	const EntryMap* current = entries_.load();
+	if (!current->Contains(name))
+		return;
+
+	auto* entries = new EntryMap(*current);
+	entries->Erase(name);
+	Publish(entries);
+}
+
+void PluginRegistry::Clear()
+{
+	if (!entries_.load()->Empty())
+		Publish(new EntryMap());
+}
+
+void PluginRegistry::Publish(EntryMap* entries)
+{
+	// Readers entering from now on see the new snapshot, the ones already in may still read the old one
+	EntryMap* previous = entries_.exchange(entries);
+	RetiredEntries retired;
+	retired.entries_ = previous;
+	retired.epoch_ = PluginEpoch::Advance();
+	retired_.Push(retired);
+
+	Reclaim();
+}
+
+void PluginRegistry::Reclaim()
+{
+	// Snapshots are retired in epoch order, the first one still read keeps the next ones
+	unsigned numReleased = 0;
+	while (numReleased < retired_.Size() && PluginEpoch::IsReleased(retired_[numReleased].epoch_))
+		delete retired_[numReleased++].entries_;
+
+	if (numReleased)
+		retired_.Erase(0, numReleased);
+}
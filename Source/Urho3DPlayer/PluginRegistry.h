@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Str.h>
+#include <Urho3D/Math/StringHash.h>
+
+#include <atomic>
+
+#include "PluginDescriptor.h"
+
+using namespace Urho3D;
+
+class PluginRuntimeImpl;
+
+/// Loaded plugin as seen from any thread.
+struct PluginRegistryEntry
+{
+	/// Plugin filename, without path nor extension.
+	String name_;
+	/// Entry points table of the plugin.
+	const PluginDescriptor* descriptor_ = nullptr;
+	/// Plugin application instance.
+	void* instance_ = nullptr;
+	/// Runtime of the plugin.
+	PluginRuntimeImpl* runtime_ = nullptr;
+};
+
+/// Read-mostly registry of the loaded plugins keyed by the hash of their filename. Readers on any thread get a
+/// consistent snapshot without lock nor copy. The main thread publishes a modified copy on every change and frees
+/// the previous snapshot once PluginEpoch tells no reader can see it anymore.
+class PluginRegistry
+{
+public:
+	/// Construct empty.
+	PluginRegistry();
+	/// Destruct. No reader may be left.
+	~PluginRegistry();
+
+	/// Return entry of a loaded plugin, or null if not loaded. Call in a read section (PluginEpochScope), the entry
+	/// stays valid until the section is left. Wait-free, any thread.
+	const PluginRegistryEntry* Find(StringHash name) const;
+	/// Return whether a plugin is loaded. Wait-free, any thread.
+	bool Contains(StringHash name) const;
+	/// Return number of loaded plugins. Wait-free, any thread.
+	unsigned Size() const;
+
+	/// Add or replace entry. Main thread only.
+	void Set(StringHash name, const PluginRegistryEntry& entry);
+	/// Remove entry. Readers may still see it until PluginEpoch::Synchronize returns. Main thread only.
+	void Remove(StringHash name);
+	/// Remove all entries. Main thread only.
+	void Clear();
+
+private:
+	/// Entries of one snapshot.
+	typedef HashMap<StringHash, PluginRegistryEntry> EntryMap;
+
+	/// Snapshot replaced, freed once its readers are gone.
+	struct RetiredEntries
+	{
+		/// Entries.
+		EntryMap* entries_;
+		/// Epoch whose readers may still see them.
+		unsigned long long epoch_;
+	};
+
+	/// Publish new snapshot and retire the current one.
+	void Publish(EntryMap* entries);
+	/// Free retired snapshots without readers left.
+	void Reclaim();
+
+	/// Current snapshot.
+	std::atomic<EntryMap*> entries_;
+	/// Retired snapshots, oldest first.
+	PODVector<RetiredEntries> retired_;
+};
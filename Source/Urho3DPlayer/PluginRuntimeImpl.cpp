@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Math/MathDefs.h>
+
+#include <cstring>
+
+#include "PluginRuntimeImpl.h"
+
+/// Size of the arena blocks. Larger allocations get a block of their own.
+static const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+PluginRuntimeImpl::PluginRuntimeImpl(const String& name, PluginScheduler* scheduler, PluginLogWriter* logWriter,
+	PluginBlackboard* blackboard, PluginServices* services) :
+	name_(name),
+	scheduler_(scheduler),
+	logWriter_(logWriter),
+	blackboard_(blackboard),
+	services_(services),
+	memoryTag_(PluginMemory::AcquireTag())
+{
+}
+
+PluginRuntimeImpl::~PluginRuntimeImpl()
+{
+	ReleaseArena();
+}
+
+void PluginRuntimeImpl::RecordTime(StringHash section, long long elapsedUSec)
+{
+	HashMap<StringHash, PluginProfileSection>::Iterator i = sections_.Find(section);
+	if (i == sections_.End())
+	{
+		i = sections_.Insert(MakePair(section, PluginProfileSection()));
+		i->second_.name_ = "Event " + section.ToString();
+	}
+
+	PluginProfileSection& profileSection = i->second_;
+	++profileSection.calls_;
+	profileSection.totalTime_ += elapsedUSec;
+	profileSection.frameTime_ += elapsedUSec;
+	profileSection.maxCallTime_ = Max(profileSection.maxCallTime_, elapsedUSec);
+}
+
+unsigned PluginRuntimeImpl::SubmitTask(PluginTaskFunction function, void* data, const unsigned* dependencies, unsigned numDependencies)
+{
+	if (!scheduler_)
+	{
+		function(data);
+		return 0;
+	}
+
+	return scheduler_->SubmitTask(function, data, dependencies, numDependencies, memoryTag_, bind_, this);
+}
+
+PluginLogRing* PluginRuntimeImpl::AcquireLogRing()
+{
+	return logWriter_ ? logWriter_->AcquireRing(logChannel_) : nullptr;
+}
+
+void* PluginRuntimeImpl::AcquireBlackboardSlot(const char* name, unsigned size, unsigned alignment)
+{
+	return blackboard_ ? blackboard_->AcquireSlot(name, size, alignment) : nullptr;
+}
+
+PluginRing* PluginRuntimeImpl::AcquireBlackboardRing(const char* name, unsigned elementSize, unsigned capacity,
+	PluginRingMode mode)
+{
+	return blackboard_ ? blackboard_->AcquireRing(name, elementSize, capacity, mode) : nullptr;
+}
+
+PluginServiceSlot* PluginRuntimeImpl::AcquireServiceSlot(const char* name, unsigned version)
+{
+	return services_ ? services_->AcquireSlot(name, version) : nullptr;
+}
+
+bool PluginRuntimeImpl::PublishService(const char* name, unsigned version, void* service)
+{
+	return services_ ? services_->Publish(name, version, service, this) : false;
+}
+
+void* PluginRuntimeImpl::AllocateArena(unsigned size, unsigned alignment)
+{
+	if (!size || !alignment || !IsPowerOfTwo(alignment))
+		return nullptr;
+
+	MutexLock lock(arenaMutex_);
+
+	size_t address = (arenaPosition_ + alignment - 1) & ~(size_t)(alignment - 1);
+	if (arenaBlocks_.Empty() || address + size > arenaEnd_)
+	{
+		const size_t blockSize = Max(ARENA_BLOCK_SIZE, (size_t)size + alignment - 1);
+		unsigned char* block;
+		{
+			// The arena is recorded explicitly and freed in bulk, not through the allocations of the plugin
+			PluginMemoryScope memoryScope(0);
+			block = new unsigned char[blockSize];
+		}
+		memset(block, 0, blockSize);
+		PluginMemory::Record(memoryTag_, (long long)blockSize);
+		arenaBlocks_.Push(block);
+		arenaSize_ += blockSize;
+
+		arenaPosition_ = reinterpret_cast<size_t>(block);
+		arenaEnd_ = arenaPosition_ + blockSize;
+		address = (arenaPosition_ + alignment - 1) & ~(size_t)(alignment - 1);
+	}
+
+	arenaPosition_ = address + size;
+	return reinterpret_cast<void*>(address);
+}
+
+unsigned PluginRuntimeImpl::BeginMemoryScope()
+{
+	return PluginMemory::SetThreadTag(memoryTag_);
+}
+
+void PluginRuntimeImpl::EndMemoryScope(unsigned previousOwner)
+{
+	PluginMemory::SetThreadTag(previousOwner);
+}
+
+void PluginRuntimeImpl::ReleaseArena()
+{
+	MutexLock lock(arenaMutex_);
+
+	{
+		PluginMemoryScope memoryScope(0);
+		for (unsigned i = 0; i < arenaBlocks_.Size(); ++i)
+			delete[] arenaBlocks_[i];
+	}
+	PluginMemory::Record(memoryTag_, -arenaSize_);
+
+	arenaBlocks_.Clear();
+	arenaPosition_ = 0;
+	arenaEnd_ = 0;
+	arenaSize_ = 0;
+}
+
+void PluginRuntimeImpl::SetSectionName(StringHash section, const String& name)
+{
+	sections_[section].name_ = name;
+}
+
+void PluginRuntimeImpl::EndFrame()
+{
+	for (HashMap<StringHash, PluginProfileSection>::Iterator i = sections_.Begin(); i != sections_.End(); ++i)
+	{
+		PluginProfileSection& profileSection = i->second_;
+		profileSection.maxFrameTime_ = Max(profileSection.maxFrameTime_, profileSection.frameTime_);
+		profileSection.frameTime_ = 0;
+	}
+}
+
+String PluginRuntimeImpl::GetProfileReport() const
+{
+	String report = "Plugin \"" + name_ + "\"\n";
+	report += ToString("  %-24s %10s %12s %12s %12s\n", "Section", "Calls", "Total ms", "Max call ms", "Max frame ms");
+
+	for (HashMap<StringHash, PluginProfileSection>::ConstIterator i = sections_.Begin(); i != sections_.End(); ++i)
+	{
+		const PluginProfileSection& profileSection = i->second_;
+		if (!profileSection.calls_)
+			continue;
+
+		report += ToString("  %-24s %10u %12.3f %12.3f %12.3f\n", profileSection.name_.CString(), profileSection.calls_,
+			profileSection.totalTime_ / 1000.0, profileSection.maxCallTime_ / 1000.0,
+			Max(profileSection.maxFrameTime_, profileSection.frameTime_) / 1000.0);
+	}
+
+	return report;
+}
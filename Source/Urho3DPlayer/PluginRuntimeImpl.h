@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/RefCounted.h>
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Timer.h>
+
+#include "PluginBlackboard.h"
+#include "PluginDescriptor.h"
+#include "PluginLogWriter.h"
+#include "PluginMemory.h"
+#include "PluginScheduler.h"
+#include "PluginServices.h"
+
+using namespace Urho3D;
+
+/// Time spent in one section of plugin code.
+struct PluginProfileSection
+{
+	/// Section name.
+	String name_;
+	/// Number of calls.
+	unsigned calls_ = 0;
+	/// Total time in microseconds.
+	long long totalTime_ = 0;
+	/// Worst time of a single call in microseconds.
+	long long maxCallTime_ = 0;
+	/// Time during the current frame in microseconds.
+	long long frameTime_ = 0;
+	/// Worst time during a frame in microseconds.
+	long long maxFrameTime_ = 0;
+};
+
+/// Player side runtime of one plugin.
+class PluginRuntimeImpl : public RefCounted, public PluginRuntime
+{
+public:
+	/// Construct.
+	PluginRuntimeImpl(const String& name, PluginScheduler* scheduler, PluginLogWriter* logWriter, PluginBlackboard* blackboard,
+		PluginServices* services);
+	/// Destruct. Free the arena.
+	~PluginRuntimeImpl() override;
+
+	/// Record time spent in plugin code for a section. Called on the main thread.
+	void RecordTime(StringHash section, long long elapsedUSec) override;
+	/// Submit task to the plugin scheduler.
+	unsigned SubmitTask(PluginTaskFunction function, void* data, const unsigned* dependencies, unsigned numDependencies) override;
+	/// Return a new log ring on the plugin log channel. Called once per thread and channel.
+	PluginLogRing* AcquireLogRing() override;
+	/// Return slot of the player blackboard. Thread-safe.
+	void* AcquireBlackboardSlot(const char* name, unsigned size, unsigned alignment) override;
+	/// Return ring of the player blackboard. Thread-safe.
+	PluginRing* AcquireBlackboardRing(const char* name, unsigned elementSize, unsigned capacity, PluginRingMode mode) override;
+	/// Return slot of the player service registry. Thread-safe.
+	PluginServiceSlot* AcquireServiceSlot(const char* name, unsigned version) override;
+	/// Publish service of the plugin in the player service registry. Thread-safe.
+	bool PublishService(const char* name, unsigned version, void* service) override;
+	/// Allocate zeroed memory from the plugin arena. Thread-safe.
+	void* AllocateArena(unsigned size, unsigned alignment) override;
+	/// Credit the allocations of the calling thread to the plugin and return the previous tag.
+	unsigned BeginMemoryScope() override;
+	/// Restore the tag of the calling thread.
+	void EndMemoryScope(unsigned previousOwner) override;
+
+	/// Set function of the plugin library making this runtime current on a thread, used around the plugin tasks.
+	void SetBindFunction(PluginBindFunction bind) { bind_ = bind; }
+	/// Set name to report for a section.
+	void SetSectionName(StringHash section, const String& name);
+	/// Close the profiling frame.
+	void EndFrame();
+	/// Free the arena. Call once the plugin can no longer reference it.
+	void ReleaseArena();
+
+	/// Return plugin name.
+	const String& GetName() const { return name_; }
+	/// Return profiled sections.
+	const HashMap<StringHash, PluginProfileSection>& GetProfileSections() const { return sections_; }
+	/// Return profiling report as text.
+	String GetProfileReport() const;
+	/// Return memory tag of the plugin allocations.
+	unsigned GetMemoryTag() const { return memoryTag_; }
+	/// Return bytes allocated by the plugin and not freed yet, arena included.
+	long long GetMemoryUse() const { return PluginMemory::GetUse(memoryTag_); }
+	/// Return highest bytes allocated by the plugin at once.
+	long long GetMemoryPeak() const { return PluginMemory::GetPeak(memoryTag_); }
+
+private:
+	/// Plugin name.
+	String name_;
+	/// Profiled sections.
+	HashMap<StringHash, PluginProfileSection> sections_;
+	/// Scheduler running the plugin tasks.
+	WeakPtr<PluginScheduler> scheduler_;
+	/// Writer of the plugin log.
+	WeakPtr<PluginLogWriter> logWriter_;
+	/// Blackboard shared by the plugins.
+	WeakPtr<PluginBlackboard> blackboard_;
+	/// Services published between plugins.
+	WeakPtr<PluginServices> services_;
+	/// Memory tag of the plugin allocations.
+	unsigned memoryTag_;
+	/// Function of the plugin library making this runtime current on a thread.
+	PluginBindFunction bind_ = nullptr;
+	/// Arena blocks.
+	PODVector<unsigned char*> arenaBlocks_;
+	/// Next free byte in the last arena block.
+	size_t arenaPosition_ = 0;
+	/// End of the last arena block.
+	size_t arenaEnd_ = 0;
+	/// Total size of the arena blocks.
+	long long arenaSize_ = 0;
+	/// Mutex for the arena.
+	Mutex arenaMutex_;
+};
+
+/// Helper to attribute time and memory spent in a plugin entry point.
+class PluginTimeScope
+{
+public:
+	/// Construct, credit allocations to the plugin and start timing if the runtime is profiling.
+	PluginTimeScope(PluginRuntimeImpl* runtime, StringHash section) :
+		runtime_(runtime && runtime->profiling_ ? runtime : nullptr),
+		section_(section),
+		memoryScope_(runtime ? runtime->GetMemoryTag() : 0)
+	{
+	}
+
+	/// Destruct and record time.
+	~PluginTimeScope()
+	{
+		if (runtime_)
+			runtime_->RecordTime(section_, timer_.GetUSec(false));
+	}
+
+private:
+	/// Runtime to record, null if not profiling.
+	PluginRuntimeImpl* runtime_;
+	/// Section to record.
+	StringHash section_;
+	/// Timer.
+	HiresTimer timer_;
+	/// Memory tag of the calling thread during the scope.
+	PluginMemoryScope memoryScope_;
+};
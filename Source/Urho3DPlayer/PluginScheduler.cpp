@@ -0,0 +1,271 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/Log.h>
+
+#include <thread>
+
+#include "PluginMemory.h"
+#include "PluginScheduler.h"
+
+PluginScheduler::PluginScheduler(Context* context) :
+	Object(context),
+	activeTasks_(0),
+	readyTasks_(0),
+	shutDown_(false)
+{
+	// Main thread queue
+	queues_.Push(new TaskQueue());
+
+	SubscribeToEvent(E_POSTUPDATE, URHO3D_HANDLER(PluginScheduler, HandleJoin));
+	// Tasks submitted after post update are joined at the end of the frame at the latest
+	SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(PluginScheduler, HandleJoin));
+}
+
+PluginScheduler::~PluginScheduler()
+{
+	Join();
+
+	{
+		std::lock_guard<std::mutex> lock(sleepLock_);
+		shutDown_ = true;
+	}
+	wakeUp_.notify_all();
+
+	for (const SharedPtr<PluginSchedulerWorker>& worker : workers_)
+		worker->Stop();
+
+	for (TaskQueue* queue : queues_)
+		delete queue;
+}
+
+void PluginScheduler::CreateWorkers()
+{
+	workersCreated_ = true;
+
+	// Use as many threads as the engine work queue, none if worker threads are disabled (-nothreads)
+	auto* queue = GetSubsystem<WorkQueue>();
+	const unsigned numThreads = queue ? queue->GetNumThreads() : 0;
+
+	for (unsigned i = 0; i < numThreads; ++i)
+		queues_.Push(new TaskQueue());
+
+	for (unsigned i = 0; i < numThreads; ++i)
+	{
+		SharedPtr<PluginSchedulerWorker> worker(new PluginSchedulerWorker(this, i + 1));
+		worker->Run();
+		workers_.Push(worker);
+	}
+
+	URHO3D_LOGDEBUGF("Plugin scheduler created with %u worker threads", numThreads);
+}
+
+unsigned PluginScheduler::SubmitTask(PluginTaskFunction function, void* data, const unsigned* dependencies, unsigned numDependencies,
+	unsigned memoryTag, PluginBindFunction bind, PluginRuntime* runtime)
+{
+	if (!workersCreated_)
+		CreateWorkers();
+
+	auto* task = new Task();
+	tasks_.Push(task);
+	task->function_ = function;
+	task->data_ = data;
+	task->memoryTag_ = memoryTag;
+	task->bind_ = bind;
+	task->runtime_ = runtime;
+	task->completed_ = false;
+	// Hold one extra dependency while registering to not be released before the end
+	task->pendingDependencies_ = 1;
+
+	const unsigned id = firstTaskId_ + tasks_.Size() - 1;
+	++activeTasks_;
+
+	for (unsigned i = 0; i < numDependencies; ++i)
+	{
+		const unsigned dependency = dependencies[i];
+
+		// Tasks of a batch already joined are complete
+		if (dependency < firstTaskId_)
+			continue;
+		if (dependency >= id)
+		{
+			URHO3D_LOGWARNINGF("Plugin task %u depends on unknown task %u, dependency ignored", id, dependency);
+			continue;
+		}
+
+		Task* dependencyTask = tasks_[dependency - firstTaskId_];
+		std::lock_guard<std::mutex> lock(dependencyTask->lock_);
+		if (!dependencyTask->completed_)
+		{
+			++task->pendingDependencies_;
+			dependencyTask->dependents_.Push(task);
+		}
+	}
+
+	if (--task->pendingDependencies_ == 0)
+	{
+		PushReady(task, nextQueue_);
+		nextQueue_ = (nextQueue_ + 1) % queues_.Size();
+	}
+
+	return id;
+}
+
+void PluginScheduler::Join()
+{
+	if (tasks_.Empty())
+		return;
+
+	while (activeTasks_ > 0)
+	{
+		Task* task = PopReady(0);
+		if (task)
+			RunTask(task, 0);
+		else
+			std::this_thread::yield();
+	}
+
+	firstTaskId_ += tasks_.Size();
+	for (Task* task : tasks_)
+		delete task;
+	tasks_.Clear();
+	nextQueue_ = 0;
+}
+
+void PluginScheduler::PushReady(Task* task, unsigned queueIndex)
+{
+	TaskQueue& queue = *queues_[queueIndex];
+
+	{
+		std::lock_guard<std::mutex> lock(queue.lock_);
+		queue.tasks_.Push(task);
+	}
+
+	++readyTasks_;
+	if (!workers_.Empty())
+	{
+		// Take the sleep lock so a worker can not miss the signal between its check and its wait
+		{
+			std::lock_guard<std::mutex> lock(sleepLock_);
+		}
+		wakeUp_.notify_one();
+	}
+}
+
+PluginScheduler::Task* PluginScheduler::PopReady(unsigned queueIndex)
+{
+	if (readyTasks_ == 0)
+		return nullptr;
+
+	// Newest task of own queue first, it is the most likely to be hot in cache
+	{
+		TaskQueue& queue = *queues_[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.lock_);
+		if (queue.tasks_.Size() > queue.head_)
+		{
+			Task* task = queue.tasks_.Back();
+			queue.tasks_.Pop();
+			if (queue.tasks_.Size() == queue.head_)
+			{
+				queue.tasks_.Clear();
+				queue.head_ = 0;
+			}
+			--readyTasks_;
+			return task;
+		}
+	}
+
+	// Then steal the oldest task of another queue
+	for (unsigned i = 1; i < queues_.Size(); ++i)
+	{
+		TaskQueue& queue = *queues_[(queueIndex + i) % queues_.Size()];
+		std::lock_guard<std::mutex> lock(queue.lock_);
+		if (queue.tasks_.Size() > queue.head_)
+		{
+			Task* task = queue.tasks_[queue.head_++];
+			if (queue.tasks_.Size() == queue.head_)
+			{
+				queue.tasks_.Clear();
+				queue.head_ = 0;
+			}
+			--readyTasks_;
+			return task;
+		}
+	}
+
+	return nullptr;
+}
+
+void PluginScheduler::RunTask(Task* task, unsigned queueIndex)
+{
+	{
+		PluginMemoryScope memoryScope(task->memoryTag_);
+		if (task->bind_)
+		{
+			PluginRuntime* previous = task->bind_(task->runtime_);
+			task->function_(task->data_);
+			task->bind_(previous);
+		}
+		else
+			task->function_(task->data_);
+	}
+
+	PODVector<Task*> dependents;
+	{
+		std::lock_guard<std::mutex> lock(task->lock_);
+		task->completed_ = true;
+		dependents.Swap(task->dependents_);
+	}
+
+	// Released tasks go to this thread queue to keep the data chain on the same core
+	for (Task* dependent : dependents)
+	{
+		if (--dependent->pendingDependencies_ == 0)
+			PushReady(dependent, queueIndex);
+	}
+
+	--activeTasks_;
+}
+
+void PluginScheduler::WorkerLoop(unsigned queueIndex)
+{
+	while (!shutDown_)
+	{
+		Task* task = PopReady(queueIndex);
+		if (task)
+		{
+			RunTask(task, queueIndex);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepLock_);
+		wakeUp_.wait(lock, [this]() { return readyTasks_ > 0 || shutDown_; });
+	}
+}
+
+void PluginScheduler::HandleJoin(StringHash eventType, VariantMap& eventData)
+{
+	Join();
+}
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Container/Ptr.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "PluginDescriptor.h"
+
+using namespace Urho3D;
+
+class PluginSchedulerWorker;
+
+/// Scheduler running plugin tasks with dependencies on all cores. Each thread owns a queue of ready tasks and steals
+/// from the others when it runs out of work. All tasks submitted during a frame are joined before E_POSTUPDATE.
+class PluginScheduler : public Object
+{
+	URHO3D_OBJECT(PluginScheduler, Object);
+
+	friend class PluginSchedulerWorker;
+
+public:
+	/// Construct. Subscribe to frame events right away to join before other E_POSTUPDATE handlers.
+	explicit PluginScheduler(Context* context);
+	/// Destruct. Join pending tasks and stop worker threads.
+	~PluginScheduler() override;
+
+	/// Submit task running once its dependencies are complete and return its id. Its allocations are credited to the
+	/// memory tag, and the runtime is made current with the bind function of the plugin while it runs. Call on the
+	/// main thread only.
+	unsigned SubmitTask(PluginTaskFunction function, void* data, const unsigned* dependencies, unsigned numDependencies,
+		unsigned memoryTag = 0, PluginBindFunction bind = nullptr, PluginRuntime* runtime = nullptr);
+	/// Run pending tasks on the calling thread too and wait until all of them are complete.
+	void Join();
+
+	/// Return number of worker threads, not counting the main thread.
+	unsigned GetNumThreads() const { return workers_.Size(); }
+
+private:
+	/// Task with dependencies.
+	struct Task
+	{
+		/// Function to run.
+		PluginTaskFunction function_;
+		/// User data.
+		void* data_;
+		/// Memory tag of the submitting plugin.
+		unsigned memoryTag_;
+		/// Function making the runtime current in the submitting plugin, or null.
+		PluginBindFunction bind_;
+		/// Runtime of the submitting plugin instance.
+		PluginRuntime* runtime_;
+		/// Number of dependencies not complete yet.
+		std::atomic<unsigned> pendingDependencies_;
+		/// Tasks waiting for this one.
+		PODVector<Task*> dependents_;
+		/// Completion flag, protected by the lock with the dependents.
+		bool completed_;
+		/// Lock protecting dependents and completion flag.
+		std::mutex lock_;
+	};
+
+	/// Ready tasks of one thread. The owner pushes and pops at the back, thieves take from the front.
+	struct TaskQueue
+	{
+		/// Lock.
+		std::mutex lock_;
+		/// Tasks.
+		PODVector<Task*> tasks_;
+		/// Index of the first task not stolen.
+		unsigned head_ = 0;
+	};
+
+	/// Create worker threads on first use, once the engine work queue tells how many to use.
+	void CreateWorkers();
+	/// Push ready task to the queue of a thread and wake a sleeping worker.
+	void PushReady(Task* task, unsigned queueIndex);
+	/// Pop task from own queue or steal one from another. Return null if none is ready.
+	Task* PopReady(unsigned queueIndex);
+	/// Run task and release its dependents.
+	void RunTask(Task* task, unsigned queueIndex);
+	/// Worker thread loop.
+	void WorkerLoop(unsigned queueIndex);
+	/// Handle post update to join the frame tasks.
+	void HandleJoin(StringHash eventType, VariantMap& eventData);
+
+	/// Worker threads.
+	Vector<SharedPtr<PluginSchedulerWorker> > workers_;
+	/// Ready task queues, first one for the main thread.
+	PODVector<TaskQueue*> queues_;
+	/// Tasks of the current batch.
+	PODVector<Task*> tasks_;
+	/// Id of the first task of the current batch.
+	unsigned firstTaskId_ = 1;
+	/// Queue receiving the next task submitted by the main thread.
+	unsigned nextQueue_ = 0;
+	/// Number of submitted tasks not complete yet.
+	std::atomic<unsigned> activeTasks_;
+	/// Number of tasks in the ready queues.
+	std::atomic<unsigned> readyTasks_;
+	/// Lock for sleeping workers.
+	std::mutex sleepLock_;
+	/// Signal for sleeping workers.
+	std::condition_variable wakeUp_;
+	/// Flag to stop worker threads.
+	std::atomic<bool> shutDown_;
+	/// Flag whether workers have been created.
+	bool workersCreated_ = false;
+};
+
+/// Worker thread of the plugin scheduler.
+class PluginSchedulerWorker : public RefCounted, public Thread
+{
+public:
+	/// Construct.
+	PluginSchedulerWorker(PluginScheduler* owner, unsigned queueIndex) :
+		owner_(owner),
+		queueIndex_(queueIndex)
+	{
+	}
+
+	/// Process tasks until stopped.
+	void ThreadFunction() override { owner_->WorkerLoop(queueIndex_); }
+
+private:
+	/// Scheduler.
+	PluginScheduler* owner_;
+	/// Index of the thread queue.
+	unsigned queueIndex_;
+};
@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/IO/Log.h>
+
+#include "PluginMemory.h"
+#include "PluginServices.h"
+
+PluginServices::PluginServices(Context* context) :
+	Object(context)
+{
+}
+
+PluginServices::~PluginServices()
+{
+	for (HashMap<String, Entry>::Iterator i = entries_.Begin(); i != entries_.End(); ++i)
+		delete i->second_.slot_;
+}
+
+PluginServiceSlot* PluginServices::AcquireSlot(const String& name, unsigned version)
+{
+	MutexLock lock(mutex_);
+	return GetEntry(name, version).slot_;
+}
+
+bool PluginServices::Publish(const String& name, unsigned version, void* service, const void* provider)
+{
+	if (!service)
+	{
+		URHO3D_LOGERROR("Plugin service \"" + name + "\" published without implementation");
+		return false;
+	}
+
+	MutexLock lock(mutex_);
+
+	Entry& entry = GetEntry(name, version);
+	if (entry.provider_ && entry.provider_ != provider)
+	{
+		URHO3D_LOGERRORF("Plugin service \"%s\" version %u is published by another plugin already", name.CString(), version);
+		return false;
+	}
+
+	entry.provider_ = provider;
+	entry.slot_->service_.store(service, std::memory_order_release);
+	return true;
+}
+
+void PluginServices::Revoke(const void* provider)
+{
+	MutexLock lock(mutex_);
+
+	for (HashMap<String, Entry>::Iterator i = entries_.Begin(); i != entries_.End(); ++i)
+	{
+		Entry& entry = i->second_;
+		if (entry.provider_ != provider)
+			continue;
+
+		entry.slot_->service_.store(nullptr, std::memory_order_release);
+		entry.provider_ = nullptr;
+	}
+}
+
+PluginServices::Entry& PluginServices::GetEntry(const String& name, unsigned version)
+{
+	// Slots outlive the plugins acquiring them, so they are credited to the player
+	PluginMemoryScope memoryScope(0);
+
+	// Each version has its own slot, so users of another version never get an incompatible interface
+	Entry& entry = entries_[name + "@" + String(version)];
+	if (!entry.slot_)
+	{
+		entry.slot_ = new PluginServiceSlot();
+		entry.slot_->service_.store(nullptr, std::memory_order_relaxed);
+	}
+	return entry;
+}
@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Object.h>
+
+#include "PluginDescriptor.h"
+
+using namespace Urho3D;
+
+/// Versioned service interfaces published by plugins to each other. The slot of a service name and version is
+/// allocated on first request and freed only with the registry, so plugins resolve it once and keep its address.
+/// The slot empties when the publishing plugin goes away.
+class PluginServices : public Object
+{
+	URHO3D_OBJECT(PluginServices, Object);
+
+public:
+	/// Construct.
+	explicit PluginServices(Context* context);
+	/// Destruct and free all slots.
+	~PluginServices() override;
+
+	/// Return slot of a service version, created empty on first request. Thread-safe.
+	PluginServiceSlot* AcquireSlot(const String& name, unsigned version);
+	/// Publish service of a provider in its slot. Return false if another provider publishes it already. Thread-safe.
+	bool Publish(const String& name, unsigned version, void* service, const void* provider);
+	/// Empty the slots published by a provider. Call before the services are destroyed. Thread-safe.
+	void Revoke(const void* provider);
+
+	/// Return number of slots.
+	unsigned GetNumSlots() const { return entries_.Size(); }
+
+private:
+	/// Slot and its provider.
+	struct Entry
+	{
+		/// Slot given to the plugins.
+		PluginServiceSlot* slot_ = nullptr;
+		/// Provider of the published service, null if none.
+		const void* provider_ = nullptr;
+	};
+
+	/// Return entry of a service version, created on first request. Lock the mutex first.
+	Entry& GetEntry(const String& name, unsigned version);
+
+	/// Entries by name and version.
+	HashMap<String, Entry> entries_;
+	/// Mutex for the entries.
+	Mutex mutex_;
+};
@@ -0,0 +1,330 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifdef URHO3D_ANGELSCRIPT
+#include <Urho3D/AngelScript/Script.h>
+#include <Urho3D/AngelScript/ScriptFile.h>
+#include <AngelScript/angelscript.h>
+#endif
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#ifdef URHO3D_LUA
+#include <Urho3D/LuaScript/LuaScript.h>
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+}
+#endif
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "Info.h"
+#include "ScriptCache.h"
+#include "StartupTrace.h"
+
+#include <cstring>
+
+/// Identifier of the cache files.
+static const char* SCRIPT_CACHE_ID = "USSC";
+
+/// FNV-1a hash of a memory block.
+static unsigned long long HashCacheBytes(const void* data, unsigned size, unsigned long long hash)
+{
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	for (unsigned i = 0; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	return hash;
+}
+
+/// FNV-1a hash of a C string.
+static unsigned long long HashCacheString(const char* str, unsigned long long hash)
+{
+	return str ? HashCacheBytes(str, (unsigned)strlen(str), hash) : hash;
+}
+
+/// FNV-1a hash of an integer.
+static unsigned long long HashCacheValue(long long value, unsigned long long hash)
+{
+	return HashCacheBytes(&value, sizeof(value), hash);
+}
+
+/// Return hash of the player build, bytecode of another build is never reused.
+static unsigned long long HashPlayerBuild()
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = HashCacheString(GetUrhoVersion(), hash);
+	hash = HashCacheString(GetCompilerID(), hash);
+	hash = HashCacheString(GetCompilerVersion(), hash);
+	return HashCacheValue(sizeof(void*), hash);
+}
+
+#ifdef URHO3D_ANGELSCRIPT
+/// Return hash of everything registered to the script engine. Plugins adding bindings change it.
+static unsigned long long HashScriptAPI(asIScriptEngine* engine, unsigned long long hash)
+{
+	hash = HashCacheString(ANGELSCRIPT_VERSION_STRING, hash);
+
+	for (asUINT i = 0; i < engine->GetObjectTypeCount(); ++i)
+	{
+		asITypeInfo* type = engine->GetObjectTypeByIndex(i);
+		hash = HashCacheString(type->GetName(), hash);
+		for (asUINT j = 0; j < type->GetMethodCount(); ++j)
+			hash = HashCacheString(type->GetMethodByIndex(j)->GetDeclaration(), hash);
+		for (asUINT j = 0; j < type->GetPropertyCount(); ++j)
+			hash = HashCacheString(type->GetPropertyDeclaration(j), hash);
+	}
+
+	for (asUINT i = 0; i < engine->GetGlobalFunctionCount(); ++i)
+		hash = HashCacheString(engine->GetGlobalFunctionByIndex(i)->GetDeclaration(), hash);
+
+	for (asUINT i = 0; i < engine->GetGlobalPropertyCount(); ++i)
+	{
+		const char* name = nullptr;
+		int typeId = 0;
+		engine->GetGlobalPropertyByIndex(i, &name, nullptr, &typeId);
+		hash = HashCacheString(name, hash);
+		hash = HashCacheString(engine->GetTypeDeclaration(typeId), hash);
+	}
+
+	for (asUINT i = 0; i < engine->GetEnumCount(); ++i)
+	{
+		asITypeInfo* type = engine->GetEnumByIndex(i);
+		hash = HashCacheString(type->GetName(), hash);
+		for (asUINT j = 0; j < type->GetEnumValueCount(); ++j)
+		{
+			int value = 0;
+			hash = HashCacheString(type->GetEnumValueByIndex(j, &value), hash);
+			hash = HashCacheValue(value, hash);
+		}
+	}
+
+	for (asUINT i = 0; i < engine->GetFuncdefCount(); ++i)
+		hash = HashCacheString(engine->GetFuncdefByIndex(i)->GetFuncdefSignature()->GetDeclaration(), hash);
+
+	return hash;
+}
+#endif
+
+ScriptCache::ScriptCache(Context* context) :
+	Object(context),
+	enabled_(true)
+{
+	cacheDir_ = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "scriptcache");
+}
+
+#ifdef URHO3D_ANGELSCRIPT
+SharedPtr<ScriptFile> ScriptCache::GetScriptFile(const String& name)
+{
+	auto* cache = GetSubsystem<ResourceCache>();
+
+	unsigned long long key = HashPlayerBuild();
+	Vector<String> visited;
+	if (!enabled_ || cacheDir_.Empty() || !HashScriptSource(name, true, key, visited))
+		return SharedPtr<ScriptFile>(cache->GetResource<ScriptFile>(name));
+
+	{
+		StartupTraceScope scope("Hash script API");
+		key = HashScriptAPI(GetSubsystem<Script>()->GetScriptEngine(), key);
+	}
+
+	const String path = GetCachePath(name, ".asbc");
+	PODVector<unsigned char> byteCode;
+	if (ReadCache(path, key, byteCode))
+	{
+		StartupTraceScope scope("Load script bytecode", name);
+
+		SharedPtr<ScriptFile> scriptFile(new ScriptFile(context_));
+		scriptFile->SetName(name);
+		MemoryBuffer buffer(byteCode);
+		if (scriptFile->Load(buffer))
+		{
+			// Register as if loaded by the resource cache, a change of the source still reloads it
+			cache->AddManualResource(scriptFile);
+			URHO3D_LOGDEBUG("Loaded script " + name + " from bytecode cache");
+			return scriptFile;
+		}
+
+		URHO3D_LOGWARNING("Failed to load cached bytecode of script " + name + ", compiling from source");
+	}
+
+	SharedPtr<ScriptFile> scriptFile(cache->GetResource<ScriptFile>(name));
+	if (scriptFile)
+	{
+		VectorBuffer buffer;
+		if (scriptFile->SaveByteCode(buffer))
+			WriteCache(path, key, buffer.GetData(), buffer.GetSize());
+	}
+
+	return scriptFile;
+}
+#endif
+
+#ifdef URHO3D_LUA
+/// Lua writer appending dumped bytecode to a buffer.
+static int WriteLuaByteCode(lua_State* state, const void* data, size_t size, void* userData)
+{
+	static_cast<VectorBuffer*>(userData)->Write(data, (unsigned)size);
+	return 0;
+}
+
+bool ScriptCache::ExecuteLuaFile(LuaScript* luaScript, const String& name)
+{
+	// Precompiled scripts and scripts pulled by require are left to the Lua script subsystem
+	unsigned long long key = HashPlayerBuild();
+	Vector<String> visited;
+	if (!enabled_ || cacheDir_.Empty() || GetExtension(name) == ".luc" || !HashScriptSource(name, false, key, visited))
+		return luaScript->ExecuteFile(name);
+
+	lua_State* state = luaScript->GetState();
+	const String path = GetCachePath(name, ".luabc");
+
+	PODVector<unsigned char> byteCode;
+	bool loaded = false;
+	if (ReadCache(path, key, byteCode))
+	{
+		StartupTraceScope scope("Load script bytecode", name);
+		loaded = luaL_loadbuffer(state, reinterpret_cast<const char*>(&byteCode[0]), byteCode.Size(), name.CString()) == 0;
+		if (!loaded)
+		{
+			URHO3D_LOGWARNING("Failed to load cached bytecode of script " + name + ", compiling from source");
+			lua_pop(state, 1);
+		}
+	}
+
+	if (!loaded)
+	{
+		SharedPtr<File> file = GetSubsystem<ResourceCache>()->GetFile(name);
+		if (!file)
+			return false;
+
+		String source;
+		source.Resize(file->GetSize());
+		file->Read(&source[0], source.Length());
+		if (luaL_loadbuffer(state, source.CString(), source.Length(), name.CString()))
+		{
+			URHO3D_LOGERROR("Load Buffer failed for " + name + ": " + String(lua_tostring(state, -1)));
+			lua_pop(state, 1);
+			return false;
+		}
+
+		VectorBuffer buffer;
+		if (lua_dump(state, WriteLuaByteCode, &buffer) == 0)
+			WriteCache(path, key, buffer.GetData(), buffer.GetSize());
+	}
+
+	if (lua_pcall(state, 0, 0, 0))
+	{
+		URHO3D_LOGERROR("Execute Lua file failed for " + name + ": " + String(lua_tostring(state, -1)));
+		lua_pop(state, 1);
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+bool ScriptCache::HashScriptSource(const String& name, bool followIncludes, unsigned long long& hash, Vector<String>& visited) const
+{
+	if (visited.Contains(name))
+		return true;
+	visited.Push(name);
+
+	auto* cache = GetSubsystem<ResourceCache>();
+	SharedPtr<File> file = cache->GetFile(name, false);
+	if (!file)
+		return false;
+
+	String source;
+	source.Resize(file->GetSize());
+	if (file->Read(&source[0], source.Length()) != source.Length())
+		return false;
+
+	hash = HashCacheString(name.CString(), hash);
+	hash = HashCacheBytes(source.CString(), source.Length(), hash);
+
+	if (!followIncludes)
+		return true;
+
+	// Follow the includes the way ScriptFile does
+	const Vector<String> lines = source.Split('\n');
+	for (const String& rawLine : lines)
+	{
+		const String line = rawLine.Trimmed();
+		if (!line.StartsWith("#include"))
+			continue;
+
+		String includeFile = line.Substring(8).Replaced("\"", "").Trimmed();
+		if (includeFile.Empty())
+			continue;
+
+		// If not found as specified, try also relative to the including file
+		if (!cache->Exists(includeFile))
+			includeFile = GetPath(name) + includeFile;
+
+		if (!HashScriptSource(includeFile, true, hash, visited))
+			return false;
+	}
+
+	return true;
+}
+
+bool ScriptCache::ReadCache(const String& path, unsigned long long key, PODVector<unsigned char>& byteCode) const
+{
+	if (!GetSubsystem<FileSystem>()->FileExists(path))
+		return false;
+
+	File file(context_, path);
+	if (!file.IsOpen() || file.ReadFileID() != SCRIPT_CACHE_ID || file.ReadUInt64() != key)
+		return false;
+
+	byteCode.Resize(file.GetSize() - file.GetPosition());
+	return !byteCode.Empty() && file.Read(&byteCode[0], byteCode.Size()) == byteCode.Size();
+}
+
+void ScriptCache::WriteCache(const String& path, unsigned long long key, const void* byteCode, unsigned size) const
+{
+	// Write aside and rename, a concurrent launch never reads a partial file
+	const String tempPath = path + ".tmp";
+	{
+		File file(context_);
+		if (!file.Open(tempPath, FILE_WRITE))
+			return;
+
+		file.WriteFileID(SCRIPT_CACHE_ID);
+		file.WriteUInt64(key);
+		file.Write(byteCode, size);
+	}
+
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	fileSystem->Delete(path);
+	if (!fileSystem->Rename(tempPath, path))
+		URHO3D_LOGWARNING("Failed to write script cache " + path);
+}
+
+String ScriptCache::GetCachePath(const String& name, const char* extension) const
+{
+	return cacheDir_ + GetFileName(name) + "_" + ToString("%08X", StringHash(name).Value()) + extension;
+}
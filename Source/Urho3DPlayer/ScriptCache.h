@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+namespace Urho3D
+{
+
+class LuaScript;
+class ScriptFile;
+
+}
+
+using namespace Urho3D;
+
+/// Persistent cache of the compiled entry script, in the preferences directory. The bytecode is keyed by a hash of
+/// the script source, of all its includes and of the registered script API, any mismatch falls back to the source.
+class ScriptCache : public Object
+{
+	URHO3D_OBJECT(ScriptCache, Object);
+
+public:
+	/// Construct.
+	explicit ScriptCache(Context* context);
+
+	/// Enable or disable the cache. When disabled scripts are always compiled from source.
+	void SetEnabled(bool enable) { enabled_ = enable; }
+	/// Return whether the cache is enabled.
+	bool IsEnabled() const { return enabled_; }
+
+#ifdef URHO3D_ANGELSCRIPT
+	/// Return AngelScript file, loaded from its cached bytecode if up to date, otherwise compiled and cached.
+	/// Call once all the script API is registered, including the plugin bindings.
+	SharedPtr<ScriptFile> GetScriptFile(const String& name);
+#endif
+
+#ifdef URHO3D_LUA
+	/// Execute Lua file from its cached bytecode if up to date, otherwise from source and cache it.
+	bool ExecuteLuaFile(LuaScript* luaScript, const String& name);
+#endif
+
+private:
+	/// Hash a script source and the sources it includes, recursively. Return false if a file is missing.
+	bool HashScriptSource(const String& name, bool followIncludes, unsigned long long& hash, Vector<String>& visited) const;
+	/// Return cached bytecode, without header, if its key matches.
+	bool ReadCache(const String& path, unsigned long long key, PODVector<unsigned char>& byteCode) const;
+	/// Write bytecode with its key.
+	void WriteCache(const String& path, unsigned long long key, const void* byteCode, unsigned size) const;
+	/// Return cache file path for a script.
+	String GetCachePath(const String& name, const char* extension) const;
+
+	/// Cache directory.
+	String cacheDir_;
+	/// Enabled flag.
+	bool enabled_;
+};
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include <atomic>
+#include <cstdio>
+
+#include "StartupTrace.h"
+
+/// Recorded span.
+struct StartupTraceSpan
+{
+	/// Name.
+	const char* name_;
+	/// Detail, such as a plugin name.
+	String detail_;
+	/// Index of the recording thread, 0 for the main thread.
+	unsigned threadIndex_;
+	/// Start time in microseconds.
+	long long start_;
+	/// Duration in microseconds.
+	long long duration_;
+};
+
+static std::atomic<bool> traceActive(false);
+static std::atomic<unsigned> traceNumThreads(1);
+static thread_local unsigned traceThreadIndex = M_MAX_UNSIGNED;
+static Mutex traceMutex;
+static Vector<StartupTraceSpan> traceSpans;
+static String traceFileName;
+static HiresTimer traceTimer;
+
+/// Return trace index of the calling thread.
+static unsigned GetTraceThreadIndex()
+{
+	if (traceThreadIndex == M_MAX_UNSIGNED)
+		traceThreadIndex = Thread::IsMainThread() ? 0 : traceNumThreads.fetch_add(1);
+	return traceThreadIndex;
+}
+
+/// Return string escaped for JSON.
+static String EscapeTraceString(const String& str)
+{
+	String result;
+	result.Reserve(str.Length());
+	for (unsigned i = 0; i < str.Length(); ++i)
+	{
+		const char c = str[i];
+		if (c == '"' || c == '\\')
+			result += '\\';
+		if ((unsigned char)c >= 0x20)
+			result += c;
+	}
+	return result;
+}
+
+void StartupTrace::Enable(const String& fileName)
+{
+	MutexLock lock(traceMutex);
+	traceFileName = fileName;
+	traceSpans.Clear();
+	traceTimer.Reset();
+	traceActive = true;
+}
+
+bool StartupTrace::IsActive()
+{
+	return traceActive.load(std::memory_order_relaxed);
+}
+
+long long StartupTrace::GetTime()
+{
+	return traceTimer.GetUSec(false);
+}
+
+void StartupTrace::AddSpan(const char* name, const String& detail, long long startUSec, long long endUSec)
+{
+	const unsigned threadIndex = GetTraceThreadIndex();
+
+	MutexLock lock(traceMutex);
+	if (!traceActive)
+		return;
+
+	StartupTraceSpan span;
+	span.name_ = name;
+	span.detail_ = detail;
+	span.threadIndex_ = threadIndex;
+	span.start_ = startUSec;
+	span.duration_ = endUSec - startUSec;
+	traceSpans.Push(span);
+}
+
+bool StartupTrace::Finish()
+{
+	MutexLock lock(traceMutex);
+	if (!traceActive)
+		return false;
+
+	traceActive = false;
+
+	FILE* file = fopen(traceFileName.CString(), "w");
+	if (!file)
+	{
+		URHO3D_LOGERROR("Failed to write startup trace " + traceFileName);
+		traceSpans.Clear();
+		return false;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+	// Name the threads first
+	const unsigned numThreads = traceNumThreads.load();
+	for (unsigned i = 0; i < numThreads; ++i)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			i ? ",\n" : "", i, i ? ToString("Worker %u", i).CString() : "Main");
+	}
+
+	for (unsigned i = 0; i < traceSpans.Size(); ++i)
+	{
+		const StartupTraceSpan& span = traceSpans[i];
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld",
+			EscapeTraceString(span.name_).CString(), span.threadIndex_, span.start_, span.duration_);
+		if (!span.detail_.Empty())
+			fprintf(file, ",\"args\":{\"detail\":\"%s\"}", EscapeTraceString(span.detail_).CString());
+		fputc('}', file);
+	}
+
+	fputs("\n]}\n", file);
+	fclose(file);
+
+	URHO3D_LOGINFO(ToString("Startup trace written to %s (%u spans)", traceFileName.CString(), traceSpans.Size()));
+	traceSpans.Clear();
+	return true;
+}
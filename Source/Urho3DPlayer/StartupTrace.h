@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Container/Str.h>
+
+using namespace Urho3D;
+
+/// Recorder of startup phases, written as a Chrome trace-event file (chrome://tracing, Perfetto). Spans can be
+/// recorded from any thread and nest by time. Recording does nothing until enabled and after the trace is written.
+class StartupTrace
+{
+public:
+	/// Start recording, the trace is written to the file by Finish.
+	static void Enable(const String& fileName);
+	/// Return whether spans are recorded.
+	static bool IsActive();
+	/// Return microseconds since tracing was enabled.
+	static long long GetTime();
+	/// Record a span. Thread-safe.
+	static void AddSpan(const char* name, const String& detail, long long startUSec, long long endUSec);
+	/// Write the trace file and stop recording. Return true on success.
+	static bool Finish();
+};
+
+/// Helper to record a span for the lifetime of a scope.
+class StartupTraceScope
+{
+public:
+	/// Construct and start the span if tracing is active.
+	explicit StartupTraceScope(const char* name, const String& detail = String::EMPTY) :
+		name_(StartupTrace::IsActive() ? name : nullptr),
+		detail_(name_ ? detail : String::EMPTY),
+		start_(name_ ? StartupTrace::GetTime() : 0)
+	{
+	}
+
+	/// Destruct and record the span.
+	~StartupTraceScope()
+	{
+		if (name_)
+			StartupTrace::AddSpan(name_, detail_, start_, StartupTrace::GetTime());
+	}
+
+private:
+	/// Span name, null if not tracing.
+	const char* name_;
+	/// Span detail, such as a plugin name.
+	String detail_;
+	/// Start time in microseconds.
+	long long start_;
+};
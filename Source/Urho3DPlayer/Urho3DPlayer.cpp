@@ -1,496 +1,1043 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-
-#ifdef URHO3D_ANGELSCRIPT
-#include <Urho3D/AngelScript/ScriptFile.h>
-#include <Urho3D/AngelScript/Script.h>
-#endif
-#include <Urho3D/Core/Main.h>
-#include <Urho3D/Engine/Engine.h>
-#include <Urho3D/Engine/EngineDefs.h>
-#include <Urho3D/IO/FileSystem.h>
-#include <Urho3D/IO/Log.h>
-#include <Urho3D/Graphics/Graphics.h>
-#include <Urho3D/Graphics/Renderer.h>
-#include <Urho3D/Audio/Audio.h>
-#include <Urho3D/Input/Input.h>
-#include <Urho3D/Core/EventProfiler.h>
-#ifdef URHO3D_NETWORK
-#include <Urho3D/Network/Network.h>
-#endif
-#ifdef URHO3D_LUA
-#include <Urho3D/LuaScript/LuaScript.h>
-#endif
-#include <Urho3D/Resource/ResourceCache.h>
-#include <Urho3D/Resource/ResourceEvents.h>
-
-#include "PluginAPI.h"
-#include "Urho3DPlayer.h"
-#include "SDL/SDL.h"
-
-#include <Urho3D/DebugNew.h>
-
-URHO3D_DEFINE_APPLICATION_MAIN(Urho3DPlayer);
-
-Urho3DPlayer::Urho3DPlayer(Context* context) :
-    Application(context),
-    commandLineRead_(false)
-{
-	plugin_ = new Plugin(context_);
-	context_->RegisterSubsystem(plugin_);
-}
-
-void Urho3DPlayer::Setup()
-{
-
-    // Web platform depends on the resource system to read any data files. Skip parsing the command line file now
-    // and try later when the resource system is live
-#ifndef __EMSCRIPTEN__
-    // Read command line from a file if no arguments given. This is primarily intended for mobile platforms.
-    // Note that the command file name uses a hardcoded path that does not utilize the resource system
-    // properly (including resource path prefix), as the resource system is not yet initialized at this point
-    auto* filesystem = GetSubsystem<FileSystem>();
-    const String commandFileName = filesystem->GetProgramDir() + "Data/CommandLine.txt";
-    if (GetArguments().Empty() && filesystem->FileExists(commandFileName))
-    {
-        SharedPtr<File> commandFile(new File(context_, commandFileName));
-        if (commandFile->IsOpen())
-        {
-            commandLineRead_ = true;
-            String commandLine = commandFile->ReadLine();
-            commandFile->Close();
-            ParseArguments(commandLine, false);
-            // Reparse engine startup parameters now
-            engineParameters_ = Engine::ParseParameters(GetArguments());
-        }
-    }
-#endif
-
-    // Check for script file name from the arguments
-    GetScriptFileName();
-
-	// Get plugin's name and path to load dynamic library soon
-	GetPluginsName();
-
-#ifndef __EMSCRIPTEN__
-    // Show usage if not found
-    if ((GetArguments().Size() || commandLineRead_) && scriptFileName_.Empty())
-    {
-        ErrorExit("Usage: Urho3DPlayer <scriptfile> [options]\n\n"
-            "The script file should implement the function void Start() for initializing the "
-            "application and subscribing to all necessary events, such as the frame update.\n"
-            #ifndef _WIN32
-            "\nCommand line options:\n"
-            "-x <res>     Horizontal resolution\n"
-            "-y <res>     Vertical resolution\n"
-            "-m <level>   Enable hardware multisampling\n"
-            "-v           Enable vertical sync\n"
-            "-t           Enable triple buffering\n"
-            "-w           Start in windowed mode\n"
-            "-s           Enable resizing when in windowed mode\n"
-            "-q           Enable quiet mode which does not log to standard output stream\n"
-            "-b <length>  Sound buffer length in milliseconds\n"
-            "-r <freq>    Sound mixing frequency in Hz\n"
-            "-pp <paths>  Resource prefix path(s), separated by semicolons, default to executable path\n"
-            "The resource prefix paths can also be defined using URHO3D_PREFIX_PATH env - var\n"
-            "When both are defined, the paths set by -pp takes higher precedence\n"
-            "-p <paths>   Resource path(s) to use, separated by semicolons, default to 'Data;CoreData'\n"
-            "-pf <files>  Resource package file to use, separated by semicolons, default to none\n"
-            "-ap <paths>  Resource autoload path(s), separated by semicolons, default to 'AutoLoad'\n"
-            "-log <level> Change the log level, valid 'level' values: 'debug', 'info', 'warning', 'error'\n"
-            "-ds <file>   Dump used shader variations to a file for precaching\n"
-            "-mq <level>  Material quality level, default 2 (high)\n"
-            "-tq <level>  Texture quality level, default 2 (high)\n"
-            "-tf <level>  Texture filter mode, default 2 (trilinear)\n"
-            "-af <level>  Texture anisotropy level, default 4. Also sets anisotropic filter mode\n"
-            "-gl2         Force OpenGL 2 use even if OpenGL 3 is available\n"
-            "-flushgpu    Flush GPU command queue each frame. Effective only on Direct3D\n"
-            "-borderless  Borderless window mode\n"
-            "-lowdpi      Force low DPI mode on Retina display\n"
-            "-headless    Headless mode. No application window will be created\n"
-            "-landscape   Use landscape orientations (iOS only, default)\n"
-            "-portrait    Use portrait orientations (iOS only)\n"
-            "-monitor <num> Monitor number to use\n"
-            "-hz <freq>   Monitor refresh rate to use\n"
-            "-prepass     Use light pre-pass rendering\n"
-            "-deferred    Use deferred rendering\n"
-            "-renderpath <name> Use the named renderpath (must enter full resource name)\n"
-            "-lqshadows   Use low-quality (1-sample) shadow filtering\n"
-            "-noshadows   Disable shadow rendering\n"
-            "-nolimit     Disable frame limiter\n"
-            "-nothreads   Disable worker threads\n"
-            "-nosound     Disable sound output\n"
-            "-noip        Disable sound mixing interpolation\n"
-            "-touch       Touch emulation on desktop platform\n"
-			"-plugin <name> Named plugin to load (must enter relative path but not necessary to enter extension)\n"
-            #endif
-        );
-    }
-    else
-    {
-        // Use the script file name as the base name for the log file
-        engineParameters_[EP_LOG_NAME] = filesystem->GetAppPreferencesDir("urho3d", "logs") + GetFileNameAndExtension(scriptFileName_) + ".log";
-    }
-#else
-    // On Web platform setup a default windowed resolution similar to the executable samples
-    engineParameters_[EP_FULL_SCREEN]  = false;
-#endif
-
-    // Construct a search path to find the resource prefix with two entries:
-    // The first entry is an empty path which will be substituted with program/bin directory -- this entry is for binary when it is still in build tree
-    // The second and third entries are possible relative paths from the installed program/bin directory to the asset directory -- these entries are for binary when it is in the Urho3D SDK installation location
-    if (!engineParameters_.Contains(EP_RESOURCE_PREFIX_PATHS))
-        engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";../share/Resources;../share/Urho3D/Resources";
-	
-}
-
-void Urho3DPlayer::Start()
-{
-	// First load plugin on start ( on setup we have obcure crash because the engine not initialized yet )
-	// Call setup plugin and force to reinitialize engine in case if some parameters update.
-	for (String pluginName : pluginsName_)
-		plugin_->Load(pluginName);
-
-	VariantMap newParameters;
-	plugin_->Setup(newParameters);
-
-	if(!plugin_->Empty() && newParameters.Size() > 0)
-		Reinitialize(newParameters);
-
-	plugin_->Start();
-
-    // Reattempt reading the command line from the resource system now if not read before
-    // Note that the engine can not be reconfigured at this point; only the script name can be specified
-    if (GetArguments().Empty() && !commandLineRead_)
-    {
-        SharedPtr<File> commandFile = GetSubsystem<ResourceCache>()->GetFile("CommandLine.txt", false);
-        if (commandFile)
-        {
-            String commandLine = commandFile->ReadLine();
-            commandFile->Close();
-            ParseArguments(commandLine, false);
-        }
-
-        GetScriptFileName();
-    }
-
-    if (scriptFileName_.Empty())
-    {
-        ErrorExit("Script file name not specified; cannot proceed");
-        return;
-    }
-
-    String extension = GetExtension(scriptFileName_);
-    if (extension != ".lua" && extension != ".luc")
-    {
-#ifdef URHO3D_ANGELSCRIPT
-        // Instantiate and register the AngelScript subsystem
-		Script* script = new Script(context_);
-        context_->RegisterSubsystem(script);
-		RegisterPlugin(context_, script->GetScriptEngine());
-
-		plugin_->OnScriptBinding("Angelscript", script->GetImmediateContext());
-
-        // Hold a shared pointer to the script file to make sure it is not unloaded during runtime
-        scriptFile_ = GetSubsystem<ResourceCache>()->GetResource<ScriptFile>(scriptFileName_);
-
-        /// \hack If we are running the editor, also instantiate Lua subsystem to enable editing Lua ScriptInstances
-#ifdef URHO3D_LUA
-        if (scriptFileName_.Contains("Editor.as", false))
-		{
-			auto* luaScript = new LuaScript(context_);
-            context_->RegisterSubsystem(luaScript);
-
-			plugin_->OnScriptBinding("Lua", luaScript->GetState());
-		}
-#endif
-        // If script loading is successful, proceed to main loop
-        if (scriptFile_ && scriptFile_->Execute("void Start()"))
-        {	
-            // Subscribe to script's reload event to allow live-reload of the application
-            SubscribeToEvent(scriptFile_, E_RELOADSTARTED, URHO3D_HANDLER(Urho3DPlayer, HandleScriptReloadStarted));
-            SubscribeToEvent(scriptFile_, E_RELOADFINISHED, URHO3D_HANDLER(Urho3DPlayer, HandleScriptReloadFinished));
-            SubscribeToEvent(scriptFile_, E_RELOADFAILED, URHO3D_HANDLER(Urho3DPlayer, HandleScriptReloadFailed));
-            return;
-        }
-#else
-        ErrorExit("AngelScript is not enabled!");
-        return;
-#endif
-    }
-    else
-    {
-#ifdef URHO3D_LUA
-        // Instantiate and register the Lua script subsystem
-        auto* luaScript = new LuaScript(context_);
-        context_->RegisterSubsystem(luaScript);
-
-		plugin_->OnScriptBinding("Lua", luaScript->GetState());
-
-        // If script loading is successful, proceed to main loop
-        if (luaScript->ExecuteFile(scriptFileName_))
-        {
-            luaScript->ExecuteFunction("Start");
-            return;
-        }
-#else
-        ErrorExit("Lua is not enabled!");
-        return;
-#endif
-    }
-
-    // The script was not successfully loaded. Show the last error message and do not run the main loop
-    ErrorExit();
-}
-
-void Urho3DPlayer::Stop()
-{
-#ifdef URHO3D_ANGELSCRIPT
-    if (scriptFile_)
-    {
-        // Execute the optional stop function
-        if (scriptFile_->GetFunction("void Stop()"))
-            scriptFile_->Execute("void Stop()");
-    }
-#else
-    if (false)
-    {
-    }
-#endif
-
-#ifdef URHO3D_LUA
-    else
-    {
-        auto* luaScript = GetSubsystem<LuaScript>();
-        if (luaScript && luaScript->GetFunction("Stop", true))
-            luaScript->ExecuteFunction("Stop");
-    }
-#endif
-
-	plugin_->Stop();
-}
-
-void Urho3DPlayer::HandleScriptReloadStarted(StringHash eventType, VariantMap& eventData)
-{
-#ifdef URHO3D_ANGELSCRIPT
-    if (scriptFile_->GetFunction("void Stop()"))
-        scriptFile_->Execute("void Stop()");
-#endif
-}
-
-void Urho3DPlayer::HandleScriptReloadFinished(StringHash eventType, VariantMap& eventData)
-{
-#ifdef URHO3D_ANGELSCRIPT
-    // Restart the script application after reload
-    if (!scriptFile_->Execute("void Start()"))
-    {
-        scriptFile_.Reset();
-        ErrorExit();
-    }
-#endif
-}
-
-void Urho3DPlayer::HandleScriptReloadFailed(StringHash eventType, VariantMap& eventData)
-{
-#ifdef URHO3D_ANGELSCRIPT
-    scriptFile_.Reset();
-    ErrorExit();
-#endif
-}
-
-void Urho3DPlayer::GetScriptFileName()
-{
-    const Vector<String>& arguments = GetArguments();
-    if (arguments.Size() && arguments[0][0] != '-')
-        scriptFileName_ = GetInternalPath(arguments[0]);
-}
-
-void Urho3DPlayer::GetPluginsName()
-{
-	const Vector<String>& arguments = GetArguments();
-	for (unsigned i = 0; i < arguments.Size(); ++i)
-	{
-		if (arguments[i].Length() > 1 && arguments[i][0] == '-')
-		{
-			String argument = arguments[i].Substring(1).ToLower();
-			String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
-
-			if (argument == "plugin")
-				pluginsName_.Push(value);
-		}
-	}
-}
-
-void Urho3DPlayer::Reinitialize(VariantMap& parameters)
-{
-
-	auto* log = GetSubsystem<Log>();
-	if (log)
-	{
-		if (engine_->HasParameter(parameters, EP_LOG_LEVEL))
-			log->SetLevel(engine_->GetParameter(parameters, EP_LOG_LEVEL).GetInt());
-		if (engine_->HasParameter(parameters, EP_LOG_QUIET))
-			log->SetQuiet(engine_->GetParameter(parameters, EP_LOG_QUIET, false).GetBool());
-		if (engine_->HasParameter(parameters, EP_LOG_NAME))
-			log->Open(engine_->GetParameter(parameters, EP_LOG_NAME).GetString());
-	}
-
-	// Configure max FPS
-	if(engine_->HasParameter(parameters, EP_FRAME_LIMITER) && 
-		engine_->GetParameter(parameters, EP_FRAME_LIMITER, true) == false)
-	engine_->SetMaxFps(0);
-
-	// Add resource paths
-	bool reinitializeResourceCache = false;
-
-	if (engine_->HasParameter(parameters, EP_RESOURCE_PREFIX_PATHS))
-		reinitializeResourceCache = true;
-	else
-		parameters[EP_RESOURCE_PREFIX_PATHS] = engine_->GetParameter(engineParameters_, EP_RESOURCE_PREFIX_PATHS, String::EMPTY);
-	if (engine_->HasParameter(parameters, EP_RESOURCE_PATHS))
-		reinitializeResourceCache = true;
-	else
-		parameters[EP_RESOURCE_PATHS] = engine_->GetParameter(engineParameters_, EP_RESOURCE_PATHS, "Data;CoreData");
-	if (engine_->HasParameter(parameters, EP_RESOURCE_PACKAGES))
-		reinitializeResourceCache = true;
-	else
-		parameters[EP_RESOURCE_PACKAGES] = engineParameters_[EP_RESOURCE_PACKAGES];
-	if (engine_->HasParameter(parameters, EP_AUTOLOAD_PATHS))
-		reinitializeResourceCache = true;
-	else
-		parameters[EP_AUTOLOAD_PATHS] = parameters[EP_RESOURCE_PATHS] = engine_->GetParameter(engineParameters_, EP_AUTOLOAD_PATHS, "Autoload");
-
-	if(reinitializeResourceCache)
-		engine_->InitializeResourceCache(parameters);
-
-	auto* graphics = GetSubsystem<Graphics>();
-	auto* renderer = GetSubsystem<Renderer>();
-	auto* cache = GetSubsystem<ResourceCache>();
-
-	if (engine_->HasParameter(parameters, EP_EXTERNAL_WINDOW))
-		graphics->SetExternalWindow(engine_->GetParameter(parameters, EP_EXTERNAL_WINDOW).GetVoidPtr());
-	if (engine_->HasParameter(parameters, EP_WINDOW_TITLE))
-		graphics->SetWindowTitle(engine_->GetParameter(parameters, EP_WINDOW_TITLE).GetString());
-	if (engine_->HasParameter(parameters, EP_WINDOW_ICON))
-		graphics->SetWindowIcon(cache->GetResource<Image>(engine_->GetParameter(parameters, EP_WINDOW_ICON).GetString()));
-	if (engine_->HasParameter(parameters, EP_FLUSH_GPU))
-		graphics->SetFlushGPU(engine_->GetParameter(parameters, EP_FLUSH_GPU).GetBool());
-	if (engine_->HasParameter(parameters, EP_ORIENTATIONS))
-		graphics->SetOrientations(engine_->GetParameter(parameters, EP_ORIENTATIONS).GetString());
-	if (engine_->HasParameter(parameters, EP_WINDOW_POSITION_X) && engine_->HasParameter(parameters, EP_WINDOW_POSITION_Y))
-		graphics->SetWindowPosition(engine_->GetParameter(parameters, EP_WINDOW_POSITION_X).GetInt(),
-			engine_->GetParameter(parameters, EP_WINDOW_POSITION_Y).GetInt());
-
-#ifdef URHO3D_OPENGL
-	if (engine_->HasParameter(parameters, EP_FORCE_GL2))
-		graphics->SetForceGL2(engine_->GetParameter(parameters, EP_FORCE_GL2).GetBool());
-#endif
-
-	if (!engine_->HasParameter(parameters, EP_WINDOW_WIDTH))
-		parameters[EP_WINDOW_WIDTH] = engine_->GetParameter(engineParameters_, EP_WINDOW_WIDTH, 0);
-	if (!engine_->HasParameter(parameters, EP_WINDOW_HEIGHT))
-		parameters[EP_WINDOW_HEIGHT] = engine_->GetParameter(engineParameters_, EP_WINDOW_HEIGHT, 0);
-	if(!engine_->HasParameter(parameters, EP_FULL_SCREEN))
-		parameters[EP_FULL_SCREEN] = engine_->GetParameter(engineParameters_, EP_FULL_SCREEN, true);
-	if(!engine_->HasParameter(parameters, EP_BORDERLESS))
-		parameters[EP_BORDERLESS] = engine_->GetParameter(engineParameters_, EP_BORDERLESS, false);
-	if(!engine_->HasParameter(parameters, EP_WINDOW_RESIZABLE))
-		parameters[EP_WINDOW_RESIZABLE] = engine_->GetParameter(engineParameters_, EP_WINDOW_RESIZABLE, false);
-	if(!engine_->HasParameter(parameters, EP_HIGH_DPI))
-		parameters[EP_HIGH_DPI] = engine_->GetParameter(engineParameters_, EP_HIGH_DPI, true);
-	if(!engine_->HasParameter(parameters, EP_VSYNC))
-		parameters[EP_VSYNC] = engine_->GetParameter(engineParameters_, EP_VSYNC, false);
-	if(!engine_->HasParameter(parameters, EP_TRIPLE_BUFFER))
-		parameters[EP_TRIPLE_BUFFER] = engine_->GetParameter(engineParameters_, EP_TRIPLE_BUFFER, false);
-	if(!engine_->HasParameter(parameters, EP_MULTI_SAMPLE))
-		parameters[EP_MULTI_SAMPLE] = engine_->GetParameter(engineParameters_, EP_MULTI_SAMPLE, 1);
-	if(!engine_->HasParameter(parameters, EP_MONITOR))
-		parameters[EP_MONITOR] = engine_->GetParameter(engineParameters_, EP_MONITOR, 0);
-	if(!engine_->HasParameter(parameters, EP_REFRESH_RATE))
-		parameters[EP_REFRESH_RATE] = engine_->GetParameter(engineParameters_, EP_REFRESH_RATE, 0);
-
-	graphics->SetMode(
-		engine_->GetParameter(parameters, EP_WINDOW_WIDTH).GetInt(),
-		engine_->GetParameter(parameters, EP_WINDOW_HEIGHT).GetInt(),
-		engine_->GetParameter(parameters, EP_FULL_SCREEN).GetBool(),
-		engine_->GetParameter(parameters, EP_BORDERLESS).GetBool(),
-		engine_->GetParameter(parameters, EP_WINDOW_RESIZABLE).GetBool(),
-		engine_->GetParameter(parameters, EP_HIGH_DPI).GetBool(),
-		engine_->GetParameter(parameters, EP_VSYNC).GetBool(),
-		engine_->GetParameter(parameters, EP_TRIPLE_BUFFER).GetBool(),
-		engine_->GetParameter(parameters, EP_MULTI_SAMPLE).GetInt(),
-		engine_->GetParameter(parameters, EP_MONITOR).GetInt(),
-		engine_->GetParameter(parameters, EP_REFRESH_RATE).GetInt());
-
-	if (engine_->HasParameter(parameters, EP_SHADER_CACHE_DIR))
-		graphics->SetShaderCacheDir(engine_->GetParameter(parameters, EP_SHADER_CACHE_DIR).GetString());
-	if (engine_->HasParameter(parameters, EP_DUMP_SHADERS))
-		graphics->BeginDumpShaders(engine_->GetParameter(parameters, EP_DUMP_SHADERS).GetString());
-	if (engine_->HasParameter(parameters, EP_RENDER_PATH))
-		renderer->SetDefaultRenderPath(cache->GetResource<XMLFile>(engine_->GetParameter(parameters, EP_RENDER_PATH).GetString()));
-
-	if (engine_->HasParameter(parameters, EP_SHADOWS))
-		renderer->SetDrawShadows(engine_->GetParameter(parameters, EP_SHADOWS, true).GetBool());
-	if (renderer->GetDrawShadows() && 
-		engine_->HasParameter(parameters, EP_LOW_QUALITY_SHADOWS) && 
-		engine_->GetParameter(parameters, EP_LOW_QUALITY_SHADOWS, false).GetBool())
-		renderer->SetShadowQuality(SHADOWQUALITY_SIMPLE_16BIT);
-
-	if(engine_->HasParameter(parameters, EP_MATERIAL_QUALITY))
-		renderer->SetMaterialQuality(engine_->GetParameter(parameters, EP_MATERIAL_QUALITY).GetInt());
-	if(engine_->HasParameter(parameters, EP_TEXTURE_QUALITY))
-		renderer->SetTextureQuality(engine_->GetParameter(parameters, EP_TEXTURE_QUALITY).GetInt());
-	if (engine_->HasParameter(parameters, EP_TEXTURE_FILTER_MODE))
-		renderer->SetTextureFilterMode((TextureFilterMode)engine_->GetParameter(parameters, EP_TEXTURE_FILTER_MODE).GetInt());
-	if (engine_->HasParameter(parameters, EP_TEXTURE_ANISOTROPY))
-		renderer->SetTextureAnisotropy(engine_->GetParameter(parameters, EP_TEXTURE_ANISOTROPY).GetInt());
-
-	if (engine_->GetParameter(parameters, EP_SOUND, true).GetBool())
-	{
-		GetSubsystem<Audio>()->SetMode(
-			engine_->GetParameter(parameters, EP_SOUND_BUFFER, 100).GetInt(),
-			engine_->GetParameter(parameters, EP_SOUND_MIX_RATE, 44100).GetInt(),
-			engine_->GetParameter(parameters, EP_SOUND_STEREO, true).GetBool(),
-			engine_->GetParameter(parameters, EP_SOUND_INTERPOLATION, true).GetBool()
-		);
-
-	}
-
-	// Initialize input
-	if (engine_->HasParameter(parameters, EP_TOUCH_EMULATION))
-		GetSubsystem<Input>()->SetTouchEmulation(engine_->GetParameter(parameters, EP_TOUCH_EMULATION).GetBool());
-
-	// Initialize network
-#ifdef URHO3D_NETWORK
-	if (engine_->HasParameter(parameters, EP_PACKAGE_CACHE_DIR))
-		GetSubsystem<Network>()->SetPackageCacheDir(engine_->GetParameter(parameters, EP_PACKAGE_CACHE_DIR).GetString());
-#endif
-
-#ifdef URHO3D_PROFILING
-	if (engine_->HasParameter(parameters, EP_EVENT_PROFILER) &&
-		engine_->GetParameter(parameters, EP_EVENT_PROFILER).GetBool())
-	{
-		EventProfiler::SetActive(true);
-	}
-
-#endif
-}
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifdef URHO3D_ANGELSCRIPT
+#include <Urho3D/AngelScript/ScriptFile.h>
+#include <Urho3D/AngelScript/Script.h>
+#endif
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Audio/Audio.h>
+#include <Urho3D/Input/Input.h>
+#include <Urho3D/Core/EventProfiler.h>
+#ifdef URHO3D_NETWORK
+#include <Urho3D/Network/Network.h>
+#endif
+#ifdef URHO3D_LUA
+#include <Urho3D/LuaScript/LuaScript.h>
+#endif
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/ResourceEvents.h>
+
+#include "PluginAPI.h"
+#include "PluginMemory.h"
+#include "ScriptCache.h"
+#include "StartupTrace.h"
+#include "Urho3DPlayer.h"
+#include "SDL/SDL.h"
+
+#include <Urho3D/DebugNew.h>
+
+/// Run the player, or several isolated players in the same process with -instances.
+static int RunPlayers()
+{
+	unsigned numInstances = 1;
+#if !defined(IOS) && !defined(TVOS) && !defined(__EMSCRIPTEN__)
+	const Vector<String>& arguments = GetArguments();
+	for (unsigned i = 0; i + 1 < arguments.Size(); ++i)
+	{
+		if (arguments[i].ToLower() == "-instances")
+			numInstances = Max(ToUInt(arguments[i + 1]), 1U);
+	}
+#endif
+
+	if (numInstances == 1)
+	{
+		SharedPtr<Context> context(new Context());
+		SharedPtr<Urho3DPlayer> application(new Urho3DPlayer(context));
+		return application->Run();
+	}
+
+	// Each player has its own Context, engine, scene, script engine and plugin instances. The engine accepts events
+	// from a single main thread per process, so the players run their frames in turn on it, while their plugin tasks
+	// and work items run on their own worker threads.
+	Vector<SharedPtr<Context> > contexts;
+	Vector<SharedPtr<Urho3DPlayer> > players;
+	for (unsigned i = 0; i < numInstances; ++i)
+	{
+		contexts.Push(SharedPtr<Context>(new Context()));
+		players.Push(SharedPtr<Urho3DPlayer>(new Urho3DPlayer(contexts.Back())));
+		players.Back()->SetInstance(i, numInstances);
+	}
+
+	int exitCode = EXIT_SUCCESS;
+	PODVector<Urho3DPlayer*> running;
+	for (Urho3DPlayer* player : players)
+	{
+		if (player->Initialize())
+			running.Push(player);
+		else
+			exitCode = EXIT_FAILURE;
+	}
+
+	while (!running.Empty())
+	{
+		for (unsigned i = 0; i < running.Size();)
+		{
+			if (running[i]->RunFrame())
+			{
+				++i;
+				continue;
+			}
+
+			const int playerExitCode = running[i]->Finish();
+			if (playerExitCode != EXIT_SUCCESS)
+				exitCode = playerExitCode;
+			running.Erase(i);
+		}
+	}
+
+	// Players reference their Context until destructed
+	players.Clear();
+	contexts.Clear();
+	return exitCode;
+}
+
+URHO3D_DEFINE_MAIN(RunPlayers());
+
+Urho3DPlayer::Urho3DPlayer(Context* context) :
+    Application(context),
+	pluginHostDeadline_(1.0f),
+    commandLineRead_(false),
+    pluginWatch_(false),
+    pluginProfile_(false),
+    scriptCacheEnabled_(true),
+    benchmarkFrames_(0),
+    benchmarkWarmupFrames_(10),
+    engineInitStart_(0),
+    firstFrameStart_(0),
+    instanceIndex_(0),
+    numInstances_(1)
+{
+	// Enabled first thing to account the whole launch
+	const Vector<String>& arguments = GetArguments();
+	for (unsigned i = 0; i + 1 < arguments.Size(); ++i)
+	{
+		if (arguments[i].ToLower() == "-tracestartup")
+			StartupTrace::Enable(arguments[i + 1]);
+	}
+
+	plugin_ = new Plugin(context_);
+	context_->RegisterSubsystem(plugin_);
+}
+
+void Urho3DPlayer::Setup()
+{
+	StartupTraceScope setupScope("Urho3DPlayer::Setup");
+
+	// Mount the deployment bundle first, it may provide the command line
+	if (!OpenBundle())
+		return;
+
+    // Web platform depends on the resource system to read any data files. Skip parsing the command line file now
+    // and try later when the resource system is live
+#ifndef __EMSCRIPTEN__
+    // Read command line from a file if no arguments given. This is primarily intended for mobile platforms.
+    // Note that the command file name uses a hardcoded path that does not utilize the resource system
+    // properly (including resource path prefix), as the resource system is not yet initialized at this point
+    auto* filesystem = GetSubsystem<FileSystem>();
+    const String commandFileName = filesystem->GetProgramDir() + "Data/CommandLine.txt";
+    if (GetArguments().Empty() && filesystem->FileExists(commandFileName))
+    {
+        SharedPtr<File> commandFile(new File(context_, commandFileName));
+        if (commandFile->IsOpen())
+        {
+            commandLineRead_ = true;
+            String commandLine = commandFile->ReadLine();
+            commandFile->Close();
+            ParseArguments(commandLine, false);
+            // Reparse engine startup parameters now
+            engineParameters_ = Engine::ParseParameters(GetArguments());
+        }
+    }
+#endif
+
+    {
+        StartupTraceScope scope("Parse arguments");
+
+        // Check for script file name from the arguments
+        GetScriptFileName();
+
+        // Get plugin's name and path to load dynamic library soon
+        GetPluginsName();
+    }
+
+#ifndef __EMSCRIPTEN__
+    // Show usage if not found
+    if ((GetArguments().Size() || commandLineRead_) && scriptFileName_.Empty())
+    {
+        ErrorExit("Usage: Urho3DPlayer <scriptfile> [options]\n\n"
+            "The script file should implement the function void Start() for initializing the "
+            "application and subscribing to all necessary events, such as the frame update.\n"
+            #ifndef _WIN32
+            "\nCommand line options:\n"
+            "-x <res>     Horizontal resolution\n"
+            "-y <res>     Vertical resolution\n"
+            "-m <level>   Enable hardware multisampling\n"
+            "-v           Enable vertical sync\n"
+            "-t           Enable triple buffering\n"
+            "-w           Start in windowed mode\n"
+            "-s           Enable resizing when in windowed mode\n"
+            "-q           Enable quiet mode which does not log to standard output stream\n"
+            "-b <length>  Sound buffer length in milliseconds\n"
+            "-r <freq>    Sound mixing frequency in Hz\n"
+            "-pp <paths>  Resource prefix path(s), separated by semicolons, default to executable path\n"
+            "The resource prefix paths can also be defined using URHO3D_PREFIX_PATH env - var\n"
+            "When both are defined, the paths set by -pp takes higher precedence\n"
+            "-p <paths>   Resource path(s) to use, separated by semicolons, default to 'Data;CoreData'\n"
+            "-pf <files>  Resource package file to use, separated by semicolons, default to none\n"
+            "-ap <paths>  Resource autoload path(s), separated by semicolons, default to 'AutoLoad'\n"
+            "-log <level> Change the log level, valid 'level' values: 'debug', 'info', 'warning', 'error'\n"
+            "-ds <file>   Dump used shader variations to a file for precaching\n"
+            "-mq <level>  Material quality level, default 2 (high)\n"
+            "-tq <level>  Texture quality level, default 2 (high)\n"
+            "-tf <level>  Texture filter mode, default 2 (trilinear)\n"
+            "-af <level>  Texture anisotropy level, default 4. Also sets anisotropic filter mode\n"
+            "-gl2         Force OpenGL 2 use even if OpenGL 3 is available\n"
+            "-flushgpu    Flush GPU command queue each frame. Effective only on Direct3D\n"
+            "-borderless  Borderless window mode\n"
+            "-lowdpi      Force low DPI mode on Retina display\n"
+            "-headless    Headless mode. No application window will be created\n"
+            "-landscape   Use landscape orientations (iOS only, default)\n"
+            "-portrait    Use portrait orientations (iOS only)\n"
+            "-monitor <num> Monitor number to use\n"
+            "-hz <freq>   Monitor refresh rate to use\n"
+            "-prepass     Use light pre-pass rendering\n"
+            "-deferred    Use deferred rendering\n"
+            "-renderpath <name> Use the named renderpath (must enter full resource name)\n"
+            "-lqshadows   Use low-quality (1-sample) shadow filtering\n"
+            "-noshadows   Disable shadow rendering\n"
+            "-nolimit     Disable frame limiter\n"
+            "-nothreads   Disable worker threads\n"
+            "-nosound     Disable sound output\n"
+            "-noip        Disable sound mixing interpolation\n"
+            "-touch       Touch emulation on desktop platform\n"
+			"-plugin <name> Named plugin to load (must enter relative path but not necessary to enter extension)\n"
+			"-lazyplugin <name>[@<event>] Named plugin to load on first request, or when the named event is sent\n"
+			"-pluginhost <name> Named plugin to run in a PluginHost process, isolated from the main loop\n"
+			"-pluginhostdeadline <ms> Longest wait for the frame of a plugin host, 1 ms by default\n"
+			"-pluginwatch Hot reload the plugins when their library is rebuilt\n"
+			"-pluginprofile Account time spent in each plugin, logged on exit\n"
+			"-bundle <file> Mount a deployment bundle holding the script, resources and plugins\n"
+			"-noscriptcache Always compile the script from source, without the bytecode cache\n"
+			"-tracestartup <file> Write the startup phases up to the first frame as Chrome trace JSON\n"
+			"-benchmark <frames> Run the given number of frames with a fixed timestep, then exit with a JSON report\n"
+			"-benchmarkwarmup <frames> Frames run before measuring in benchmark mode, 10 by default\n"
+			"-benchmarkreport <file> Write the benchmark report to a file instead of the standard output\n"
+			"-instances <count> Run isolated headless players in the same process, each with its own scene, scripts and plugins\n"
+			"-record <file> Record the timestep, input events and plugin changes of each frame\n"
+			"-replay <file> Replay a recording headless, then exit\n"
+            #endif
+        );
+    }
+    else
+    {
+        // Use the script file name as the base name for the log file
+        engineParameters_[EP_LOG_NAME] = filesystem->GetAppPreferencesDir("urho3d", "logs") + GetFileNameAndExtension(scriptFileName_) + ".log";
+    }
+#else
+    // On Web platform setup a default windowed resolution similar to the executable samples
+    engineParameters_[EP_FULL_SCREEN]  = false;
+#endif
+
+    // Construct a search path to find the resource prefix with two entries:
+    // The first entry is an empty path which will be substituted with program/bin directory -- this entry is for binary when it is still in build tree
+    // The second and third entries are possible relative paths from the installed program/bin directory to the asset directory -- these entries are for binary when it is in the Urho3D SDK installation location
+    if (!engineParameters_.Contains(EP_RESOURCE_PREFIX_PATHS))
+        engineParameters_[EP_RESOURCE_PREFIX_PATHS] = ";../share/Resources;../share/Urho3D/Resources";
+
+	// Bundle resources are searched first. Loose resource directories are used only if given explicitly.
+	if (bundle_)
+	{
+		String packages = bundle_->GetFileName();
+		const String otherPackages = Engine::GetParameter(engineParameters_, EP_RESOURCE_PACKAGES, String::EMPTY).GetString();
+		if (!otherPackages.Empty())
+			packages += ";" + otherPackages;
+		engineParameters_[EP_RESOURCE_PACKAGES] = packages;
+
+		if (!engineParameters_.Contains(EP_RESOURCE_PATHS))
+			engineParameters_[EP_RESOURCE_PATHS] = String::EMPTY;
+	}
+
+	// Players sharing the process have no window nor audio device, and keep their log files apart
+	if (numInstances_ > 1)
+	{
+		const String suffix = "." + String(instanceIndex_);
+		engineParameters_[EP_HEADLESS] = true;
+		engineParameters_[EP_SOUND] = false;
+		if (engineParameters_.Contains(EP_LOG_NAME))
+			engineParameters_[EP_LOG_NAME] = ReplaceExtension(engineParameters_[EP_LOG_NAME].GetString(), suffix + ".log");
+		if (!benchmarkReportName_.Empty())
+			benchmarkReportName_ = ReplaceExtension(benchmarkReportName_, suffix + GetExtension(benchmarkReportName_, false));
+		if (!recordFileName_.Empty())
+			recordFileName_ = ReplaceExtension(recordFileName_, suffix + GetExtension(recordFileName_, false));
+		if (!replayFileName_.Empty())
+			replayFileName_ = ReplaceExtension(replayFileName_, suffix + GetExtension(replayFileName_, false));
+		plugin_->SetFileSuffix(suffix);
+	}
+
+	// Replayed frames run back to back with their recorded timestep. Recorded input is sent as events, the
+	// libraries are not rebuilt, and the replay sets the timesteps the benchmark would.
+	if (!replayFileName_.Empty())
+	{
+		engineParameters_[EP_HEADLESS] = true;
+		engineParameters_[EP_SOUND] = false;
+		engineParameters_[EP_FRAME_LIMITER] = false;
+		pluginWatch_ = false;
+		if (benchmarkFrames_)
+		{
+			URHO3D_LOGWARNING("Benchmark is not run while replaying");
+			benchmarkFrames_ = 0;
+		}
+	}
+
+	// Benchmark frames run back to back, without waiting for the display or the audio device
+	if (benchmarkFrames_)
+	{
+		engineParameters_[EP_FRAME_LIMITER] = false;
+		engineParameters_[EP_VSYNC] = false;
+		engineParameters_[EP_SOUND] = false;
+	}
+
+	// Resolve plugin libraries and let them adjust the engine parameters now, so graphics, audio and resource
+	// cache are created once with the final settings
+	plugin_->SetProfiling(pluginProfile_);
+	{
+		StartupTraceScope scope("Plugin::Configure");
+		plugin_->Configure(pluginsName_, engineParameters_);
+	}
+
+	// Plugin hosts load and set up their plugin while the engine initializes
+	plugin_->SetHostDeadline(pluginHostDeadline_);
+	for (const String& hostedPluginName : hostedPluginsName_)
+		plugin_->LoadHosted(hostedPluginName);
+
+	// Engine is initialized between Setup and Start
+	engineInitStart_ = StartupTrace::GetTime();
+}
+
+void Urho3DPlayer::Start()
+{
+	if (StartupTrace::IsActive())
+	{
+		StartupTrace::AddSpan("Engine::Initialize", String::EMPTY, engineInitStart_, StartupTrace::GetTime());
+		SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Urho3DPlayer, HandleStartupTraceFrame));
+		SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Urho3DPlayer, HandleStartupTraceFrame));
+	}
+
+	StartupTraceScope startScope("Urho3DPlayer::Start");
+
+	// Runtimes of the configured plugins were created before the engine applied the log level
+	auto* log = GetSubsystem<Log>();
+	if (log)
+		plugin_->SetLogLevel(log->GetLevel());
+
+	// Plugin applications are constructed once the engine is initialized, from the libraries resolved in Setup,
+	// in command line order. Parameters set by Setup of the plugins are still applied by Reinitialize, only the
+	// ones differing from the configured parameters are.
+	{
+		StartupTraceScope scope("Plugin::LoadAll");
+		plugin_->LoadAll(pluginsName_);
+	}
+
+	VariantMap newParameters;
+	{
+		StartupTraceScope scope("Plugin::Setup");
+		plugin_->Setup(newParameters);
+	}
+
+	if(!plugin_->Empty() && newParameters.Size() > 0)
+	{
+		StartupTraceScope scope("Reinitialize");
+		Reinitialize(newParameters);
+	}
+
+	{
+		StartupTraceScope scope("Plugin::Start");
+		plugin_->Start();
+	}
+
+	// Register plugins loaded on demand, from script or when their activation event is sent
+	for (const String& lazyPluginName : lazyPluginsName_)
+	{
+		const unsigned separator = lazyPluginName.FindLast('@');
+		if (separator != String::NPOS)
+			plugin_->Register(lazyPluginName.Substring(0, separator), StringHash(lazyPluginName.Substring(separator + 1)));
+		else
+			plugin_->Register(lazyPluginName);
+	}
+
+	if (pluginWatch_)
+		plugin_->SetHotReload(true);
+
+	// Measured from the first frame, subscribed before the script so the phases include all of its handlers
+	if (benchmarkFrames_)
+		benchmark_ = new Benchmark(context_, benchmarkFrames_, benchmarkWarmupFrames_, 1.0f / 60.0f, benchmarkReportName_);
+
+	// Recorded and replayed from the first frame, after the command line plugins are loaded
+	if (!recordFileName_.Empty())
+		frameRecorder_ = new FrameRecorder(context_, recordFileName_);
+	if (!replayFileName_.Empty())
+	{
+		frameReplayer_ = new FrameReplayer(context_, replayFileName_);
+		if (!frameReplayer_->IsLoaded())
+		{
+			ErrorExit("Frame recording " + replayFileName_ + " can not be replayed");
+			return;
+		}
+	}
+
+    // Reattempt reading the command line from the resource system now if not read before
+    // Note that the engine can not be reconfigured at this point; only the script name can be specified
+    if (GetArguments().Empty() && !commandLineRead_)
+    {
+        SharedPtr<File> commandFile = GetSubsystem<ResourceCache>()->GetFile("CommandLine.txt", false);
+        if (commandFile)
+        {
+            String commandLine = commandFile->ReadLine();
+            commandFile->Close();
+            ParseArguments(commandLine, false);
+        }
+
+        GetScriptFileName();
+    }
+
+    if (scriptFileName_.Empty())
+    {
+        ErrorExit("Script file name not specified; cannot proceed");
+        return;
+    }
+
+    String extension = GetExtension(scriptFileName_);
+    if (extension != ".lua" && extension != ".luc")
+    {
+#ifdef URHO3D_ANGELSCRIPT
+        // Instantiate and register the AngelScript subsystem
+		Script* script;
+		{
+			StartupTraceScope scope("Script subsystem");
+			script = new Script(context_);
+			context_->RegisterSubsystem(script);
+		}
+		{
+			StartupTraceScope scope("RegisterPlugin");
+			RegisterPlugin(context_, script->GetScriptEngine());
+		}
+		{
+			StartupTraceScope scope("Plugin::OnScriptBinding", "Angelscript");
+			plugin_->OnScriptBinding("Angelscript", script->GetImmediateContext());
+		}
+
+        // Hold a shared pointer to the script file to make sure it is not unloaded during runtime
+        {
+            StartupTraceScope scope("Compile script", scriptFileName_);
+            scriptFile_ = GetScriptCache()->GetScriptFile(scriptFileName_);
+        }
+
+        /// \hack If we are running the editor, also instantiate Lua subsystem to enable editing Lua ScriptInstances
+#ifdef URHO3D_LUA
+        if (scriptFileName_.Contains("Editor.as", false))
+		{
+			auto* luaScript = new LuaScript(context_);
+            context_->RegisterSubsystem(luaScript);
+
+			plugin_->OnScriptBinding("Lua", luaScript->GetState());
+		}
+#endif
+        // If script loading is successful, proceed to main loop
+        bool started = false;
+        if (scriptFile_)
+        {
+            StartupTraceScope scope("Script Start()");
+            started = scriptFile_->Execute("void Start()");
+        }
+
+        if (started)
+        {	
+            // Subscribe to script's reload event to allow live-reload of the application
+            SubscribeToEvent(scriptFile_, E_RELOADSTARTED, URHO3D_HANDLER(Urho3DPlayer, HandleScriptReloadStarted));
+            SubscribeToEvent(scriptFile_, E_RELOADFINISHED, URHO3D_HANDLER(Urho3DPlayer, HandleScriptReloadFinished));
+            SubscribeToEvent(scriptFile_, E_RELOADFAILED, URHO3D_HANDLER(Urho3DPlayer, HandleScriptReloadFailed));
+            return;
+        }
+#else
+        ErrorExit("AngelScript is not enabled!");
+        return;
+#endif
+    }
+    else
+    {
+#ifdef URHO3D_LUA
+        // Instantiate and register the Lua script subsystem
+        LuaScript* luaScript;
+        {
+            StartupTraceScope scope("Script subsystem");
+            luaScript = new LuaScript(context_);
+            context_->RegisterSubsystem(luaScript);
+        }
+        {
+            StartupTraceScope scope("Plugin::OnScriptBinding", "Lua");
+            plugin_->OnScriptBinding("Lua", luaScript->GetState());
+        }
+
+        // If script loading is successful, proceed to main loop
+        bool executed;
+        {
+            StartupTraceScope scope("Compile script", scriptFileName_);
+            executed = GetScriptCache()->ExecuteLuaFile(luaScript, scriptFileName_);
+        }
+
+        if (executed)
+        {
+            StartupTraceScope scope("Script Start()");
+            luaScript->ExecuteFunction("Start");
+            return;
+        }
+#else
+        ErrorExit("Lua is not enabled!");
+        return;
+#endif
+    }
+
+    // The script was not successfully loaded. Show the last error message and do not run the main loop
+    ErrorExit();
+}
+
+void Urho3DPlayer::Stop()
+{
+	// Keep what was traced if no frame was ever presented
+	StartupTrace::Finish();
+
+	// Only frames are recorded, not the stop
+	frameRecorder_.Reset();
+	frameReplayer_.Reset();
+
+#ifdef URHO3D_ANGELSCRIPT
+    if (scriptFile_)
+    {
+        // Execute the optional stop function
+        if (scriptFile_->GetFunction("void Stop()"))
+            scriptFile_->Execute("void Stop()");
+    }
+#else
+    if (false)
+    {
+    }
+#endif
+
+#ifdef URHO3D_LUA
+    else
+    {
+        auto* luaScript = GetSubsystem<LuaScript>();
+        if (luaScript && luaScript->GetFunction("Stop", true))
+            luaScript->ExecuteFunction("Stop");
+    }
+#endif
+
+	plugin_->Stop();
+
+	if (plugin_->GetProfiling())
+		URHO3D_LOGINFO("Plugin profiling:\n" + plugin_->GetProfileReport());
+	if (PluginMemory::IsEnabled())
+		URHO3D_LOGINFO("Plugin memory:\n" + plugin_->GetMemoryReport());
+}
+
+void Urho3DPlayer::SetInstance(unsigned index, unsigned numInstances)
+{
+	instanceIndex_ = index;
+	numInstances_ = numInstances;
+}
+
+bool Urho3DPlayer::Initialize()
+{
+	// Same steps as Application::Run before the main loop
+	Setup();
+	if (exitCode_)
+		return false;
+
+	if (!engine_->Initialize(engineParameters_))
+	{
+		ErrorExit();
+		return false;
+	}
+
+	Start();
+	return !exitCode_;
+}
+
+bool Urho3DPlayer::RunFrame()
+{
+	if (engine_->IsExiting())
+		return false;
+
+	engine_->RunFrame();
+	return true;
+}
+
+int Urho3DPlayer::Finish()
+{
+	Stop();
+	return exitCode_;
+}
+
+void Urho3DPlayer::HandleScriptReloadStarted(StringHash eventType, VariantMap& eventData)
+{
+#ifdef URHO3D_ANGELSCRIPT
+    if (scriptFile_->GetFunction("void Stop()"))
+        scriptFile_->Execute("void Stop()");
+#endif
+}
+
+void Urho3DPlayer::HandleScriptReloadFinished(StringHash eventType, VariantMap& eventData)
+{
+#ifdef URHO3D_ANGELSCRIPT
+    // Restart the script application after reload
+    if (!scriptFile_->Execute("void Start()"))
+    {
+        scriptFile_.Reset();
+        ErrorExit();
+    }
+#endif
+}
+
+void Urho3DPlayer::HandleScriptReloadFailed(StringHash eventType, VariantMap& eventData)
+{
+#ifdef URHO3D_ANGELSCRIPT
+    scriptFile_.Reset();
+    ErrorExit();
+#endif
+}
+
+bool Urho3DPlayer::OpenBundle()
+{
+	const Vector<String> arguments = GetArguments();
+	String bundleName;
+	for (unsigned i = 0; i + 1 < arguments.Size(); ++i)
+	{
+		if (arguments[i].ToLower() == "-bundle")
+			bundleName = arguments[i + 1];
+	}
+
+	if (bundleName.Empty())
+		return true;
+
+	StartupTraceScope scope("Open bundle", bundleName);
+
+	bundle_ = new Bundle(context_);
+	if (!bundle_->Open(GetInternalPath(bundleName)))
+	{
+		ErrorExit("Could not open bundle " + bundleName);
+		return false;
+	}
+
+	plugin_->SetBundle(bundle_);
+
+	// Without script on the command line, use the one of the bundle. Given options come after its own.
+	const String bundleCommandLine = bundle_->ReadCommandLine();
+	if (!bundleCommandLine.Empty() && (arguments.Empty() || arguments[0][0] == '-'))
+	{
+		String commandLine = bundleCommandLine;
+		for (const String& argument : arguments)
+			commandLine += argument.Contains(' ') ? " \"" + argument + "\"" : " " + argument;
+
+		commandLineRead_ = true;
+		ParseArguments(commandLine, false);
+		// Reparse engine startup parameters now
+		engineParameters_ = Engine::ParseParameters(GetArguments());
+	}
+
+	return true;
+}
+
+ScriptCache* Urho3DPlayer::GetScriptCache()
+{
+	if (!scriptCache_)
+	{
+		scriptCache_ = new ScriptCache(context_);
+		scriptCache_->SetEnabled(scriptCacheEnabled_);
+	}
+
+	return scriptCache_;
+}
+
+void Urho3DPlayer::HandleStartupTraceFrame(StringHash eventType, VariantMap& eventData)
+{
+	if (eventType == E_BEGINFRAME)
+	{
+		firstFrameStart_ = StartupTrace::GetTime();
+		UnsubscribeFromEvent(E_BEGINFRAME);
+		return;
+	}
+
+	// Trace is complete once the first frame is presented
+	const long long now = StartupTrace::GetTime();
+	StartupTrace::AddSpan("First frame", String::EMPTY, firstFrameStart_, now);
+	StartupTrace::AddSpan("Time to first frame", String::EMPTY, 0, now);
+	StartupTrace::Finish();
+	UnsubscribeFromEvent(E_ENDFRAME);
+}
+
+void Urho3DPlayer::GetScriptFileName()
+{
+    const Vector<String>& arguments = GetArguments();
+    if (arguments.Size() && arguments[0][0] != '-')
+        scriptFileName_ = GetInternalPath(arguments[0]);
+}
+
+void Urho3DPlayer::GetPluginsName()
+{
+	const Vector<String>& arguments = GetArguments();
+	for (unsigned i = 0; i < arguments.Size(); ++i)
+	{
+		if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+		{
+			String argument = arguments[i].Substring(1).ToLower();
+			String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+			if (argument == "plugin")
+				pluginsName_.Push(value);
+			else if (argument == "lazyplugin")
+				lazyPluginsName_.Push(value);
+			else if (argument == "pluginhost")
+				hostedPluginsName_.Push(value);
+			else if (argument == "pluginhostdeadline")
+				pluginHostDeadline_ = ToFloat(value);
+			else if (argument == "pluginwatch")
+				pluginWatch_ = true;
+			else if (argument == "pluginprofile")
+				pluginProfile_ = true;
+			else if (argument == "noscriptcache")
+				scriptCacheEnabled_ = false;
+			else if (argument == "benchmark")
+				benchmarkFrames_ = ToUInt(value);
+			else if (argument == "benchmarkwarmup")
+				benchmarkWarmupFrames_ = ToUInt(value);
+			else if (argument == "benchmarkreport")
+				benchmarkReportName_ = value;
+			else if (argument == "record")
+				recordFileName_ = value;
+			else if (argument == "replay")
+				replayFileName_ = value;
+		}
+	}
+}
+
+void Urho3DPlayer::Reinitialize(VariantMap& parameters)
+{
+	// Keep only the parameters which differ from the ones the engine was initialized with
+	VariantMap changes;
+	for (VariantMap::ConstIterator i = parameters.Begin(); i != parameters.End(); ++i)
+	{
+		VariantMap::ConstIterator current = engineParameters_.Find(i->first_);
+		if (current == engineParameters_.End() || current->second_ != i->second_)
+			changes[i->first_] = i->second_;
+	}
+
+	if (changes.Empty())
+	{
+		URHO3D_LOGDEBUG("Plugin parameters match engine parameters, nothing to reinitialize");
+		return;
+	}
+
+	auto* log = GetSubsystem<Log>();
+	if (log)
+	{
+		if (changes.Contains(EP_LOG_LEVEL))
+		{
+			log->SetLevel(changes[EP_LOG_LEVEL].GetInt());
+			plugin_->SetLogLevel(log->GetLevel());
+		}
+		if (changes.Contains(EP_LOG_QUIET))
+			log->SetQuiet(changes[EP_LOG_QUIET].GetBool());
+		if (changes.Contains(EP_LOG_NAME))
+			log->Open(changes[EP_LOG_NAME].GetString());
+	}
+
+	// Configure max FPS
+	if (changes.Contains(EP_FRAME_LIMITER) && !changes[EP_FRAME_LIMITER].GetBool())
+		engine_->SetMaxFps(0);
+
+	UpdateResourceCache(changes);
+
+	auto* graphics = GetSubsystem<Graphics>();
+	auto* renderer = GetSubsystem<Renderer>();
+	auto* cache = GetSubsystem<ResourceCache>();
+
+	if (graphics)
+	{
+		if (changes.Contains(EP_EXTERNAL_WINDOW))
+			graphics->SetExternalWindow(changes[EP_EXTERNAL_WINDOW].GetVoidPtr());
+		if (changes.Contains(EP_WINDOW_TITLE))
+			graphics->SetWindowTitle(changes[EP_WINDOW_TITLE].GetString());
+		if (changes.Contains(EP_WINDOW_ICON))
+			graphics->SetWindowIcon(cache->GetResource<Image>(changes[EP_WINDOW_ICON].GetString()));
+		if (changes.Contains(EP_FLUSH_GPU))
+			graphics->SetFlushGPU(changes[EP_FLUSH_GPU].GetBool());
+		if (changes.Contains(EP_ORIENTATIONS))
+			graphics->SetOrientations(changes[EP_ORIENTATIONS].GetString());
+		if (changes.Contains(EP_WINDOW_POSITION_X) || changes.Contains(EP_WINDOW_POSITION_Y))
+		{
+			const IntVector2 position = graphics->GetWindowPosition();
+			graphics->SetWindowPosition(Engine::GetParameter(changes, EP_WINDOW_POSITION_X, position.x_).GetInt(),
+				Engine::GetParameter(changes, EP_WINDOW_POSITION_Y, position.y_).GetInt());
+		}
+
+#ifdef URHO3D_OPENGL
+		if (changes.Contains(EP_FORCE_GL2))
+			graphics->SetForceGL2(changes[EP_FORCE_GL2].GetBool());
+#endif
+
+		// Recreate the device only if the requested mode differs from the live one, a zero size or refresh rate
+		// keeps the current one
+		int width = Engine::GetParameter(changes, EP_WINDOW_WIDTH, graphics->GetWidth()).GetInt();
+		int height = Engine::GetParameter(changes, EP_WINDOW_HEIGHT, graphics->GetHeight()).GetInt();
+		int refreshRate = Engine::GetParameter(changes, EP_REFRESH_RATE, graphics->GetRefreshRate()).GetInt();
+		if (!width)
+			width = graphics->GetWidth();
+		if (!height)
+			height = graphics->GetHeight();
+		if (!refreshRate)
+			refreshRate = graphics->GetRefreshRate();
+
+		const bool fullscreen = Engine::GetParameter(changes, EP_FULL_SCREEN, graphics->GetFullscreen()).GetBool();
+		const bool borderless = Engine::GetParameter(changes, EP_BORDERLESS, graphics->GetBorderless()).GetBool();
+		const bool resizable = Engine::GetParameter(changes, EP_WINDOW_RESIZABLE, graphics->GetResizable()).GetBool();
+		const bool highDPI = Engine::GetParameter(changes, EP_HIGH_DPI, graphics->GetHighDPI()).GetBool();
+		const bool vsync = Engine::GetParameter(changes, EP_VSYNC, graphics->GetVSync()).GetBool();
+		const bool tripleBuffer = Engine::GetParameter(changes, EP_TRIPLE_BUFFER, graphics->GetTripleBuffer()).GetBool();
+		const int multiSample = Engine::GetParameter(changes, EP_MULTI_SAMPLE, graphics->GetMultiSample()).GetInt();
+		const int monitor = Engine::GetParameter(changes, EP_MONITOR, graphics->GetMonitor()).GetInt();
+
+		if (width != graphics->GetWidth() || height != graphics->GetHeight() || fullscreen != graphics->GetFullscreen() ||
+			borderless != graphics->GetBorderless() || resizable != graphics->GetResizable() || highDPI != graphics->GetHighDPI() ||
+			vsync != graphics->GetVSync() || tripleBuffer != graphics->GetTripleBuffer() ||
+			multiSample != graphics->GetMultiSample() || monitor != graphics->GetMonitor() || refreshRate != graphics->GetRefreshRate())
+		{
+			graphics->SetMode(width, height, fullscreen, borderless, resizable, highDPI, vsync, tripleBuffer, multiSample,
+				monitor, refreshRate);
+		}
+
+		if (changes.Contains(EP_SHADER_CACHE_DIR))
+			graphics->SetShaderCacheDir(changes[EP_SHADER_CACHE_DIR].GetString());
+		if (changes.Contains(EP_DUMP_SHADERS))
+			graphics->BeginDumpShaders(changes[EP_DUMP_SHADERS].GetString());
+	}
+
+	if (renderer)
+	{
+		if (changes.Contains(EP_RENDER_PATH))
+			renderer->SetDefaultRenderPath(cache->GetResource<XMLFile>(changes[EP_RENDER_PATH].GetString()));
+
+		if (changes.Contains(EP_SHADOWS))
+			renderer->SetDrawShadows(changes[EP_SHADOWS].GetBool());
+		if (renderer->GetDrawShadows() && changes.Contains(EP_LOW_QUALITY_SHADOWS) && changes[EP_LOW_QUALITY_SHADOWS].GetBool())
+			renderer->SetShadowQuality(SHADOWQUALITY_SIMPLE_16BIT);
+
+		if (changes.Contains(EP_MATERIAL_QUALITY))
+			renderer->SetMaterialQuality(changes[EP_MATERIAL_QUALITY].GetInt());
+		if (changes.Contains(EP_TEXTURE_QUALITY))
+			renderer->SetTextureQuality(changes[EP_TEXTURE_QUALITY].GetInt());
+		if (changes.Contains(EP_TEXTURE_FILTER_MODE))
+			renderer->SetTextureFilterMode((TextureFilterMode)changes[EP_TEXTURE_FILTER_MODE].GetInt());
+		if (changes.Contains(EP_TEXTURE_ANISOTROPY))
+			renderer->SetTextureAnisotropy(changes[EP_TEXTURE_ANISOTROPY].GetInt());
+	}
+
+	// Reopen audio output only if one of its settings changed
+	auto* audio = GetSubsystem<Audio>();
+	if (audio && (changes.Contains(EP_SOUND) || changes.Contains(EP_SOUND_BUFFER) || changes.Contains(EP_SOUND_MIX_RATE) ||
+		changes.Contains(EP_SOUND_STEREO) || changes.Contains(EP_SOUND_INTERPOLATION)))
+	{
+		VariantMap sound = engineParameters_;
+		for (VariantMap::ConstIterator i = changes.Begin(); i != changes.End(); ++i)
+			sound[i->first_] = i->second_;
+
+		if (Engine::GetParameter(sound, EP_SOUND, true).GetBool())
+		{
+			audio->SetMode(
+				Engine::GetParameter(sound, EP_SOUND_BUFFER, 100).GetInt(),
+				Engine::GetParameter(sound, EP_SOUND_MIX_RATE, 44100).GetInt(),
+				Engine::GetParameter(sound, EP_SOUND_STEREO, true).GetBool(),
+				Engine::GetParameter(sound, EP_SOUND_INTERPOLATION, true).GetBool()
+			);
+		}
+		else
+			audio->Close();
+	}
+
+	// Initialize input
+	if (changes.Contains(EP_TOUCH_EMULATION))
+		GetSubsystem<Input>()->SetTouchEmulation(changes[EP_TOUCH_EMULATION].GetBool());
+
+	// Initialize network
+#ifdef URHO3D_NETWORK
+	if (changes.Contains(EP_PACKAGE_CACHE_DIR))
+		GetSubsystem<Network>()->SetPackageCacheDir(changes[EP_PACKAGE_CACHE_DIR].GetString());
+#endif
+
+#ifdef URHO3D_PROFILING
+	if (changes.Contains(EP_EVENT_PROFILER) && changes[EP_EVENT_PROFILER].GetBool())
+		EventProfiler::SetActive(true);
+#endif
+
+	// Remember what is applied for the next reinitialization
+	for (VariantMap::ConstIterator i = changes.Begin(); i != changes.End(); ++i)
+		engineParameters_[i->first_] = i->second_;
+}
+
+void Urho3DPlayer::UpdateResourceCache(const VariantMap& changes)
+{
+	const bool prefixPathsChanged = changes.Contains(EP_RESOURCE_PREFIX_PATHS);
+	const bool pathsChanged = changes.Contains(EP_RESOURCE_PATHS);
+	const bool packagesChanged = changes.Contains(EP_RESOURCE_PACKAGES);
+	const bool autoloadPathsChanged = changes.Contains(EP_AUTOLOAD_PATHS);
+	if (!prefixPathsChanged && !pathsChanged && !packagesChanged && !autoloadPathsChanged)
+		return;
+
+	const String oldPathsString = Engine::GetParameter(engineParameters_, EP_RESOURCE_PATHS, "Data;CoreData").GetString();
+	const String oldPackagesString = Engine::GetParameter(engineParameters_, EP_RESOURCE_PACKAGES, String::EMPTY).GetString();
+	const String oldAutoloadPathsString = Engine::GetParameter(engineParameters_, EP_AUTOLOAD_PATHS, "Autoload").GetString();
+
+	const Vector<String> oldPaths = oldPathsString.Split(';');
+	const Vector<String> oldPackages = oldPackagesString.Split(';');
+	const Vector<String> oldAutoloadPaths = oldAutoloadPathsString.Split(';');
+	const Vector<String> paths = Engine::GetParameter(changes, EP_RESOURCE_PATHS, oldPathsString).GetString().Split(';');
+	const Vector<String> packages = Engine::GetParameter(changes, EP_RESOURCE_PACKAGES, oldPackagesString).GetString().Split(';');
+	const Vector<String> autoloadPaths = Engine::GetParameter(changes, EP_AUTOLOAD_PATHS, oldAutoloadPathsString).GetString().Split(';');
+
+	// Prefix paths change where everything is found, and autoloaded directories can not be told apart from the
+	// others once added: only these cases need the cache to be set up again from scratch
+	bool autoloadPathRemoved = false;
+	for (const String& path : oldAutoloadPaths)
+		autoloadPathRemoved |= !autoloadPaths.Contains(path);
+
+	if (prefixPathsChanged || autoloadPathRemoved)
+	{
+		VariantMap parameters = engineParameters_;
+		for (VariantMap::ConstIterator i = changes.Begin(); i != changes.End(); ++i)
+			parameters[i->first_] = i->second_;
+		engine_->InitializeResourceCache(parameters);
+		return;
+	}
+
+	auto* cache = GetSubsystem<ResourceCache>();
+	auto* fileSystem = GetSubsystem<FileSystem>();
+	const Vector<String> prefixPaths = GetResourcePrefixPaths();
+
+	for (const String& path : oldPaths)
+	{
+		if (!paths.Contains(path))
+			cache->RemoveResourceDir(FindResourcePath(prefixPaths, path, false));
+	}
+	for (const String& path : paths)
+	{
+		if (oldPaths.Contains(path))
+			continue;
+
+		const String resolvedPath = FindResourcePath(prefixPaths, path, false);
+		if (resolvedPath.Empty())
+			URHO3D_LOGERROR("Failed to add resource path '" + path + "', check the documentation on how to set the 'resource prefix path'");
+		else
+			cache->AddResourceDir(resolvedPath);
+	}
+
+	for (const String& package : oldPackages)
+	{
+		if (!packages.Contains(package))
+			cache->RemovePackageFile(FindResourcePath(prefixPaths, package, true));
+	}
+	for (const String& package : packages)
+	{
+		if (oldPackages.Contains(package))
+			continue;
+
+		const String resolvedPackage = FindResourcePath(prefixPaths, package, true);
+		if (resolvedPackage.Empty())
+			URHO3D_LOGERROR("Failed to add resource package '" + package + "', check the documentation on how to set the 'resource prefix path'");
+		else
+			cache->AddPackageFile(resolvedPackage);
+	}
+
+	// Add the directories and packages of the new autoload paths, under every prefix path as the engine does
+	for (const String& autoloadPath : autoloadPaths)
+	{
+		if (oldAutoloadPaths.Contains(autoloadPath))
+			continue;
+
+		for (const String& prefixPath : prefixPaths)
+		{
+			const String path = AddTrailingSlash(IsAbsolutePath(autoloadPath) ? autoloadPath : prefixPath + autoloadPath);
+			if (!fileSystem->DirExists(path))
+				continue;
+
+			Vector<String> entries;
+			fileSystem->ScanDir(entries, path, "*", SCAN_DIRS, false);
+			for (const String& entry : entries)
+			{
+				if (!entry.StartsWith("."))
+					cache->AddResourceDir(path + entry);
+			}
+
+			fileSystem->ScanDir(entries, path, "*.pak", SCAN_FILES, false);
+			for (const String& entry : entries)
+				cache->AddPackageFile(path + entry);
+
+			if (IsAbsolutePath(autoloadPath))
+				break;
+		}
+	}
+}
+
+Vector<String> Urho3DPlayer::GetResourcePrefixPaths() const
+{
+	auto* fileSystem = GetSubsystem<FileSystem>();
+
+	// Same resolution as the engine, relative prefix paths start from the program directory
+	Vector<String> prefixPaths = Engine::GetParameter(engineParameters_, EP_RESOURCE_PREFIX_PATHS, String::EMPTY).GetString().Split(';', true);
+	for (String& prefixPath : prefixPaths)
+		prefixPath = AddTrailingSlash(IsAbsolutePath(prefixPath) ? prefixPath : fileSystem->GetProgramDir() + prefixPath);
+
+	return prefixPaths;
+}
+
+String Urho3DPlayer::FindResourcePath(const Vector<String>& prefixPaths, const String& path, bool isPackage) const
+{
+	auto* fileSystem = GetSubsystem<FileSystem>();
+
+	if (IsAbsolutePath(path))
+		return (isPackage ? fileSystem->FileExists(path) : fileSystem->DirExists(path)) ? path : String::EMPTY;
+
+	for (const String& prefixPath : prefixPaths)
+	{
+		const String candidate = prefixPath + path;
+		if (isPackage ? fileSystem->FileExists(candidate) : fileSystem->DirExists(candidate))
+			return candidate;
+	}
+
+	return String::EMPTY;
+}
@@ -1,72 +1,138 @@
-//
-// Copyright (c) 2008-2018 the Urho3D project.
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy
-// of this software and associated documentation files (the "Software"), to deal
-// in the Software without restriction, including without limitation the rights
-// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-// copies of the Software, and to permit persons to whom the Software is
-// furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in
-// all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-// THE SOFTWARE.
-//
-#pragma once
-
-#include <Urho3D/Engine/Application.h>
-#include "Plugin.h"
-
-using namespace Urho3D;
-
-/// Urho3DPlayer application runs a script specified on the command line.
-class Urho3DPlayer : public Application
-{
-    URHO3D_OBJECT(Urho3DPlayer, Application);
-
-public:
-    /// Construct.
-    explicit Urho3DPlayer(Context* context);
-
-    /// Setup before engine initialization. Verify that a script file has been specified.
-    void Setup() override;
-    /// Setup after engine initialization. Load the script and execute its start function.
-    void Start() override;
-    /// Cleanup after the main loop. Run the script's stop function if it exists.
-    void Stop() override;
-
-private:
-    /// Handle reload start of the script file.
-    void HandleScriptReloadStarted(StringHash eventType, VariantMap& eventData);
-    /// Handle reload success of the script file.
-    void HandleScriptReloadFinished(StringHash eventType, VariantMap& eventData);
-    /// Handle reload failure of the script file.
-    void HandleScriptReloadFailed(StringHash eventType, VariantMap& eventData);
-    /// Parse script file name from the first argument.
-    void GetScriptFileName();
-	/// Parse script file name and get plugin's name
-	void GetPluginsName();
-	/// Renitialize engine in case for plugin setup
-	void Reinitialize(VariantMap& parameters);
-
-    /// Script file name.
-    String scriptFileName_;
-	/// Group plugin's name to load
-	Vector<String> pluginsName_;
-    /// Flag whether CommandLine.txt was already successfully read.
-    bool commandLineRead_;
-	/// Plugin system.
-	Plugin* plugin_;
-
-#ifdef URHO3D_ANGELSCRIPT
-    /// Script file.
-    SharedPtr<ScriptFile> scriptFile_;
-#endif
-};
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#pragma once
+
+#include <Urho3D/Engine/Application.h>
+#include "Benchmark.h"
+#include "FrameRecording.h"
+#include "Plugin.h"
+#include "ScriptCache.h"
+
+using namespace Urho3D;
+
+/// Urho3DPlayer application runs a script specified on the command line.
+class Urho3DPlayer : public Application
+{
+    URHO3D_OBJECT(Urho3DPlayer, Application);
+
+public:
+    /// Construct.
+    explicit Urho3DPlayer(Context* context);
+
+    /// Setup before engine initialization. Verify that a script file has been specified.
+    void Setup() override;
+    /// Setup after engine initialization. Load the script and execute its start function.
+    void Start() override;
+    /// Cleanup after the main loop. Run the script's stop function if it exists.
+    void Stop() override;
+
+	/// Set index of the player among the ones running in the same process. Players sharing the process run headless
+	/// and write their own log files.
+	void SetInstance(unsigned index, unsigned numInstances);
+	/// Setup, initialize the engine and start without entering the main loop, to step the player from outside.
+	/// Return false if the player can not run.
+	bool Initialize();
+	/// Run one frame. Return false once the engine is exiting.
+	bool RunFrame();
+	/// Cleanup after the last frame and return the exit code.
+	int Finish();
+
+private:
+    /// Handle reload start of the script file.
+    void HandleScriptReloadStarted(StringHash eventType, VariantMap& eventData);
+    /// Handle reload success of the script file.
+    void HandleScriptReloadFinished(StringHash eventType, VariantMap& eventData);
+    /// Handle reload failure of the script file.
+    void HandleScriptReloadFailed(StringHash eventType, VariantMap& eventData);
+	/// Open the deployment bundle given on the command line. Return false if it can not be opened.
+	bool OpenBundle();
+	/// Return compiled script cache, created on first use.
+	ScriptCache* GetScriptCache();
+	/// Handle first frame to close and write the startup trace.
+	void HandleStartupTraceFrame(StringHash eventType, VariantMap& eventData);
+    /// Parse script file name from the first argument.
+    void GetScriptFileName();
+	/// Parse script file name and get plugin's name
+	void GetPluginsName();
+	/// Renitialize engine in case for plugin setup. Only the parameters differing from the engine ones are applied.
+	void Reinitialize(VariantMap& parameters);
+	/// Add and remove changed resource paths and packages without resetting the resource cache when possible.
+	void UpdateResourceCache(const VariantMap& changes);
+	/// Return resource prefix paths resolved as the engine does.
+	Vector<String> GetResourcePrefixPaths() const;
+	/// Return resource directory or package found under the prefix paths, or empty if not found.
+	String FindResourcePath(const Vector<String>& prefixPaths, const String& path, bool isPackage) const;
+
+    /// Script file name.
+    String scriptFileName_;
+	/// Group plugin's name to load
+	Vector<String> pluginsName_;
+	/// Group plugin's name to load on demand
+	Vector<String> lazyPluginsName_;
+	/// Group plugin's name to load in a plugin host process
+	Vector<String> hostedPluginsName_;
+	/// Longest wait for the frame of a plugin host in milliseconds.
+	float pluginHostDeadline_;
+    /// Flag whether CommandLine.txt was already successfully read.
+    bool commandLineRead_;
+	/// Flag whether plugins are hot reloaded when rebuilt.
+	bool pluginWatch_;
+	/// Flag whether time spent in plugins is accounted.
+	bool pluginProfile_;
+	/// Flag whether compiled scripts are cached.
+	bool scriptCacheEnabled_;
+	/// Compiled script cache.
+	SharedPtr<ScriptCache> scriptCache_;
+	/// Number of frames to benchmark, 0 to run normally.
+	unsigned benchmarkFrames_;
+	/// Number of frames run before benchmarking.
+	unsigned benchmarkWarmupFrames_;
+	/// Benchmark report file name, empty to print it.
+	String benchmarkReportName_;
+	/// Running benchmark.
+	SharedPtr<Benchmark> benchmark_;
+	/// File to record the frames to, empty to not record.
+	String recordFileName_;
+	/// File to replay the frames from, empty to run normally.
+	String replayFileName_;
+	/// Running frame recorder.
+	SharedPtr<FrameRecorder> frameRecorder_;
+	/// Running frame replayer.
+	SharedPtr<FrameReplayer> frameReplayer_;
+	/// Deployment bundle.
+	SharedPtr<Bundle> bundle_;
+	/// Startup trace time when Setup returned to the engine initialization.
+	long long engineInitStart_;
+	/// Startup trace time when the first frame began.
+	long long firstFrameStart_;
+	/// Plugin system.
+	Plugin* plugin_;
+	/// Index of the player among the ones running in the same process.
+	unsigned instanceIndex_;
+	/// Number of players running in the same process.
+	unsigned numInstances_;
+
+#ifdef URHO3D_ANGELSCRIPT
+    /// Script file.
+    SharedPtr<ScriptFile> scriptFile_;
+#endif
+};